@@ -11,8 +11,37 @@
 #include "AviSynthStream.h"
 
 #include <mmreg.h>
+#include <mutex>
 
-const AVS_Linkage* AVS_linkage = NULL;
+// AVS_linkage is a process-wide pointer used by all inline methods of the AviSynth+ C++ API
+// (AVSValue, PVideoFrame, VideoInfo, ...). All script environments created from the same
+// Avisynth.dll return the same linkage table, so the pointer is set by the first CAviSynthFile
+// and cleared only when the last one is destroyed. This allows several independent instances
+// to be created, used and destroyed concurrently from different threads.
+const AVS_Linkage* AVS_linkage = nullptr;
+
+static std::mutex s_LinkageMutex;
+static unsigned   s_LinkageRefs = 0;
+
+static void AcquireAVSLinkage(const AVS_Linkage* linkage)
+{
+	std::lock_guard<std::mutex> lock(s_LinkageMutex);
+
+	if (s_LinkageRefs++ == 0) {
+		AVS_linkage = linkage;
+	}
+	ASSERT(AVS_linkage == linkage);
+}
+
+static void ReleaseAVSLinkage()
+{
+	std::lock_guard<std::mutex> lock(s_LinkageMutex);
+
+	ASSERT(s_LinkageRefs > 0);
+	if (--s_LinkageRefs == 0) {
+		AVS_linkage = nullptr;
+	}
+}
 
 std::wstring ConvertUtf8OrAnsiLinesToWide(const std::string_view sv)
 {
@@ -50,7 +79,9 @@ std::wstring ConvertUtf8OrAnsiLinesToWide(const std::string_view sv)
 // CAviSynthFile
 //
 
-CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
+CAviSynthFile::CAviSynthFile(const WCHAR* name, const Settings_t& settings, CSource* pParent, HRESULT* phr)
+	: m_Settings(settings)
+	, m_pHashManifest(settings.bFrameHashes ? new CHashManifest : nullptr)
 {
 	try {
 		m_hAviSynthDll = LoadLibraryW(L"Avisynth.dll");
@@ -70,7 +101,8 @@ CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
 			throw std::exception("A newer AviSynth+ version is required");
 		}
 
-		AVS_linkage = m_Linkage = m_ScriptEnvironment->GetAVSLinkage();
+		m_Linkage = m_ScriptEnvironment->GetAVSLinkage();
+		AcquireAVSLinkage(m_Linkage);
 	}
 	catch ([[maybe_unused]] const std::exception& e) {
 		DLog(ConvertAnsiToWide(e.what()));
@@ -100,6 +132,15 @@ CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
 		auto Clip = m_AVSValue.AsClip();
 		auto VInfo = Clip->GetVideoInfo();
 
+		if (!pParent) {
+			// a secondary instance without pins for the thumbnails and the command line tools
+			if (!VInfo.HasVideo() && !VInfo.HasAudio()) {
+				throw std::exception("AviSynth+ script does not return video or audio");
+			}
+			*phr = S_OK;
+			return;
+		}
+
 		if (VInfo.HasVideo()) {
 			auto& Format = GetFormatParamsAviSynth(VInfo.pixel_type);
 			if (Format.fourcc == DWORD(-1)) {
@@ -115,6 +156,7 @@ CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
 			else {
 				m_FileInfo.append(pVideoStream->GetInfo());
 				m_FileInfo += (L'\n');
+				m_pVideoStream = pVideoStream;
 			}
 		}
 
@@ -135,7 +177,7 @@ CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
 		hr = E_FAIL;
 		DLog(ConvertAnsiToWide(e.what()));
 
-		if (error.length()) {
+		if (error.length() && pParent) {
 			DLog(error);
 			new CAviSynthVideoStream(error, pParent, &hr);
 			if (SUCCEEDED(hr)) {
@@ -149,8 +191,6 @@ CAviSynthFile::CAviSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
 
 CAviSynthFile::~CAviSynthFile()
 {
-	AVS_linkage = m_Linkage;
-
 	m_AVSValue = 0;
 
 	if (m_ScriptEnvironment) {
@@ -158,21 +198,89 @@ CAviSynthFile::~CAviSynthFile()
 		m_ScriptEnvironment = nullptr;
 	}
 
-	AVS_linkage = nullptr;
-	m_Linkage = nullptr;
+	if (m_Linkage) {
+		ReleaseAVSLinkage();
+		m_Linkage = nullptr;
+	}
 
 	if (m_hAviSynthDll) {
 		FreeLibrary(m_hAviSynthDll);
 	}
 }
 
+int64_t CAviSynthFile::GetDroppedFrames() const
+{
+	return m_pVideoStream ? m_pVideoStream->GetDroppedFrames() : 0;
+}
+
+std::wstring CAviSynthFile::GetHashManifest() const
+{
+	return m_pHashManifest ? m_pHashManifest->GetText() : std::wstring();
+}
+
+void CAviSynthFile::EnablePrefetch(const bool enable)
+{
+	if (m_pVideoStream) {
+		m_pVideoStream->EnablePrefetch(enable);
+	}
+}
+
+HRESULT CAviSynthFile::Step(const DWORD frames)
+{
+	return m_pVideoStream ? m_pVideoStream->Step(frames) : E_NOTIMPL;
+}
+
+HRESULT CAviSynthFile::CanStep() const
+{
+	return m_pVideoStream ? m_pVideoStream->CanStep() : S_FALSE;
+}
+
+HRESULT CAviSynthFile::CancelStep()
+{
+	return m_pVideoStream ? m_pVideoStream->CancelStep() : S_FALSE;
+}
+
+const CLatencyStats* CAviSynthFile::GetStepLatency() const
+{
+	return m_pVideoStream ? &m_pVideoStream->GetStepLatency() : nullptr;
+}
+
+int CAviSynthFile::GetFrameNumber(const REFERENCE_TIME rt) const
+{
+	return m_pVideoStream ? m_pVideoStream->GetFrameNumber(rt) : -1;
+}
+
 //
 // CAviSynthVideoStream
 //
 
+static void GetFrameProps(IScriptEnvironment* env, const PVideoFrame& frame, FrameProps_t& props)
+{
+	auto& avsMap = frame->getConstProperties();
+	const int numKeys = env->propNumKeys(&avsMap);
+	for (int i = 0; i < numKeys; i++) {
+		const char* keyName = env->propGetKey(&avsMap, i);
+		const FrameProp id = keyName ? GetFramePropId(keyName) : FP_Unknown;
+		int err = 0;
+		switch (id) {
+		case FP_Unknown:
+			break;
+		case FP_PictType:
+			if (const char* pictType = env->propGetData(&avsMap, keyName, 0, &err); !err && pictType) {
+				props.pictType = pictType[0];
+			}
+			break;
+		default:
+			if (const int64_t value = env->propGetInt(&avsMap, keyName, 0, &err); !err) {
+				props.SetInt(id, value);
+			}
+		}
+	}
+}
+
 CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource* pParent, HRESULT* phr)
 	: CSourceStream(L"Video", phr, pParent, L"Video")
-	, CSourceSeeking(L"Video", (IPin*)this, phr, &m_cSharedState)
+	, CStreamSeeking(L"Video", (IPin*)this, phr, &m_cSharedState, TIME_FORMAT_FRAME)
 	, m_pAviSynthFile(pAviSynthFile)
 {
 	CAutoLock cAutoLock(&m_cSharedState);
@@ -203,18 +311,12 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 		m_fpsDen = VInfo.fps_denominator;
 		m_NumFrames = VInfo.num_frames;
 		m_AvgTimePerFrame = UNITS * m_fpsDen / m_fpsNum; // no need any MulDiv here
-		m_rtDuration = m_rtStop = llMulDiv(UNITS * m_NumFrames, m_fpsDen, m_fpsNum, 0);
 
 		if (VInfo.IsPlanar()) {
 			if (VInfo.IsYUV() || VInfo.IsYUVA()) {
 				m_Planes[0] = PLANAR_Y;
-				if (VInfo.IsYV12() || VInfo.IsYV16() || VInfo.IsYV24()) {
-					m_Planes[1] = PLANAR_V;
-					m_Planes[2] = PLANAR_U;
-				} else {
-					m_Planes[1] = PLANAR_U;
-					m_Planes[2] = PLANAR_V;
-				}
+				m_Planes[1] = PLANAR_U;
+				m_Planes[2] = PLANAR_V;
 			}
 			else if (VInfo.IsRGB()) {
 				m_Planes[0] = PLANAR_G;
@@ -240,7 +342,18 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 			has_at_least_v8 = false;
 		}
 
+		bool has_durations = false;
+		HdrMetadata_t hdr;
+
 		if (has_at_least_v8) {
+			FrameProps_t props;
+			GetFrameProps(m_pAviSynthFile->m_ScriptEnvironment, VFrame, props);
+			// a clip may start at the nominal rate and change later, the runs of a constant clip collapse into one
+			has_durations = props.HasDuration();
+
+			m_Props = props.mediaType;
+			m_bFrameProps = true;
+
 			auto& avsMap = VFrame->getConstProperties();
 			int numKeys = m_pAviSynthFile->m_ScriptEnvironment->propNumKeys(&avsMap);
 			if (numKeys > 0) {
@@ -255,6 +368,7 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 					const char* val_Data = 0;
 					int err = 0;
 					const char keyType = m_pAviSynthFile->m_ScriptEnvironment->propGetType(&avsMap, keyName);
+					const FrameProp id = GetFramePropId(keyName);
 
 					m_StreamInfo += std::format(L"\n{:>2}: <{}> '{}'", i, keyType, A2WStr(keyName));
 
@@ -263,14 +377,15 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 						val_Int = m_pAviSynthFile->m_ScriptEnvironment->propGetInt(&avsMap, keyName, 0, &err);
 						if (!err) {
 							m_StreamInfo += std::format(L" = {}", val_Int);
-							if (strcmp(keyName, "_SARNum") == 0) {
-								m_Sar.num = val_Int;
-							}
-							else if (strcmp(keyName, "_SARDen") == 0) {
-								m_Sar.den = val_Int;
-							}
-							else {
-								SetColorInfoFromFrameFrops(color_info, keyName, val_Int);
+							switch (id) {
+							case FP_SARNum: m_Sar.num = val_Int; break;
+							case FP_SARDen: m_Sar.den = val_Int; break;
+							case FP_ContentLightLevelMax:
+							case FP_ContentLightLevelAverage:
+								SetHdrMetadataFromFrameProp(hdr, id, 0, (double)val_Int);
+								break;
+							default:
+								SetColorInfoFromFrameProp(color_info, id, val_Int);
 							}
 						}
 						break;
@@ -278,6 +393,15 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 						val_Float = m_pAviSynthFile->m_ScriptEnvironment->propGetFloat(&avsMap, keyName, 0, &err);
 						if (!err) {
 							m_StreamInfo += std::format(L" = {:.3f}", val_Float);
+							if (id != FP_Unknown) {
+								const int numElements = m_pAviSynthFile->m_ScriptEnvironment->propNumElements(&avsMap, keyName);
+								for (int k = 0; k < numElements; k++) {
+									val_Float = m_pAviSynthFile->m_ScriptEnvironment->propGetFloat(&avsMap, keyName, k, &err);
+									if (!err) {
+										SetHdrMetadataFromFrameProp(hdr, id, k, val_Float);
+									}
+								}
+							}
 						}
 						break;
 					case PROPTYPE_DATA:
@@ -285,7 +409,7 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 						if (!err) {
 							const int dataSize = m_pAviSynthFile->m_ScriptEnvironment->propGetDataSize(&avsMap, keyName, 0, &err);
 							if (!err) {
-								if (dataSize == 1 && strcmp(keyName, "_PictType") == 0) {
+								if (dataSize == 1 && id == FP_PictType) {
 									m_StreamInfo += std::format(L" = {}", val_Data[0]);
 								} else {
 									m_StreamInfo += std::format(L", {} bytes", dataSize);
@@ -296,13 +420,53 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 					}
 				}
 			}
+
+			if (hdr.IsValid()) {
+				m_StreamInfo += L"\n" + hdr.GetInfo();
+			}
 		}
 
 		if (color_info) {
 			m_ColorInfo = color_info | (AMCONTROL_USED | AMCONTROL_COLORINFO_PRESENT);
 		}
 
-		InitVideoMediaType();
+		if (has_durations) {
+			// the frames may have their own durations, the clip frame rate is only nominal
+			m_Timeline.InitVariable(m_NumFrames, m_fpsNum, m_fpsDen, [this](const int frame, int64_t& num, int64_t& den) {
+				return ReadFrameDuration(frame, num, den);
+			});
+		} else {
+			m_Timeline.Init(m_NumFrames, m_fpsNum, m_fpsDen);
+		}
+		m_rtDuration = m_rtStop = m_Timeline.GetDuration();
+
+		m_Prefetch.Start(m_NumFrames, m_pAviSynthFile->m_Settings.iPrefetchFrames, [this](const int frame, PVideoFrame& out) {
+			CAutoLock cAutoLock(&m_csGetFrame);
+			try {
+				out = m_pAviSynthFile->m_AVSValue.AsClip()->GetFrame(frame, m_pAviSynthFile->m_ScriptEnvironment);
+				return true;
+			}
+			catch ([[maybe_unused]] const AvisynthError& e) {
+				return false;
+			}
+		});
+		m_FrameRequest.Start([this](const int frame, PVideoFrame& out) {
+			CAutoLock cAutoLock(&m_csGetFrame);
+			try {
+				out = m_pAviSynthFile->m_AVSValue.AsClip()->GetFrame(frame, m_pAviSynthFile->m_ScriptEnvironment);
+				return true;
+			}
+			catch ([[maybe_unused]] const AvisynthError& e) {
+				DLog(L"IClip::GetFrame threw an exception: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
+				return false;
+			}
+		});
+
+		m_OutputFormats = GetOutputFormats(m_Format, m_pAviSynthFile->m_Settings.iDitherMode);
+		m_OutFormat = m_Format;
+		m_TransferFrame = m_OutFormat.copyFrame;
+		m_bOutputAlpha = (m_Format.planes == 4);
+		InitVideoMediaType(m_mt, m_OutFormat);
 
 		DLog(m_StreamInfo);
 
@@ -324,7 +488,7 @@ CAviSynthVideoStream::CAviSynthVideoStream(CAviSynthFile* pAviSynthFile, CSource
 
 CAviSynthVideoStream::CAviSynthVideoStream(std::wstring_view error_str, CSource* pParent, HRESULT* phr)
 	: CSourceStream(L"Video", phr, pParent, L"Video")
-	, CSourceSeeking(L"Video", (IPin*)this, phr, &m_cSharedState)
+	, CStreamSeeking(L"Video", (IPin*)this, phr, &m_cSharedState, TIME_FORMAT_FRAME)
 	, m_pAviSynthFile(nullptr)
 {
 	m_Format = GetFormatParamsAviSynth(VideoInfo::CS_BGR32);
@@ -340,14 +504,17 @@ CAviSynthVideoStream::CAviSynthVideoStream(std::wstring_view error_str, CSource*
 	m_fpsDen = 1;
 	m_NumFrames = 10;
 	m_AvgTimePerFrame = UNITS;
-	m_rtDuration = m_rtStop = UNITS * m_NumFrames;
+	m_Timeline.Init(m_NumFrames, m_fpsNum, m_fpsDen);
+	m_rtDuration = m_rtStop = m_Timeline.GetDuration();
 
 	std::wstring str(error_str);
 	m_BitmapError = GetBitmapWithText(str, m_Width, m_Height);
 
 	if (m_BitmapError) {
 		*phr = S_FALSE;
-		InitVideoMediaType();
+		m_OutputFormats = { m_Format };
+		m_OutFormat = m_Format;
+		InitVideoMediaType(m_mt, m_OutFormat);
 	} else {
 		*phr = E_FAIL;
 	}
@@ -355,6 +522,9 @@ CAviSynthVideoStream::CAviSynthVideoStream(std::wstring_view error_str, CSource*
 
 CAviSynthVideoStream::~CAviSynthVideoStream()
 {
+	m_FrameRequest.Stop();
+	m_Prefetch.Stop();
+	m_Timeline.StopIndex();
 }
 
 STDMETHODIMP CAviSynthVideoStream::NonDelegatingQueryInterface(REFIID riid, void** ppv)
@@ -370,7 +540,8 @@ HRESULT CAviSynthVideoStream::OnThreadCreate()
 	CAutoLock cAutoLockShared(&m_cSharedState);
 
 	m_FrameCounter = 0;
-	m_CurrentFrame = (int)llMulDiv(m_rtStart, m_fpsNum, m_fpsDen * UNITS, 0); // round down
+	m_CurrentFrame = (int)std::min<int64_t>(m_StartUnit, m_NumFrames);
+	m_LastFrame = -1;
 
 	return CSourceStream::OnThreadCreate();
 }
@@ -378,6 +549,7 @@ HRESULT CAviSynthVideoStream::OnThreadCreate()
 HRESULT CAviSynthVideoStream::OnThreadStartPlay()
 {
 	m_bDiscontinuity = TRUE;
+	m_QualityControl.Reset();
 	return DeliverNewSegment(m_rtStart, m_rtStop, m_dRateSeeking);
 }
 
@@ -392,8 +564,11 @@ void CAviSynthVideoStream::UpdateFromSeek()
 		m_bFlushing = TRUE;
 
 		DeliverBeginFlush();
+		// the delivery thread does not wait for the frame it is rendering
+		m_FrameRequest.Cancel();
 		// make sure we have stopped pushing
 		Stop();
+		m_FrameRequest.Reset();
 		// complete the flush
 		DeliverEndFlush();
 
@@ -404,16 +579,70 @@ void CAviSynthVideoStream::UpdateFromSeek()
 	}
 }
 
+bool CAviSynthVideoStream::ReadFrameDuration(const int frame, int64_t& num, int64_t& den)
+{
+	// the lock is held for one frame, so the delivery waits for one frame at most
+	CAutoLock cAutoLock(&m_csGetFrame);
+
+	try {
+		auto VFrame = m_pAviSynthFile->m_AVSValue.AsClip()->GetFrame(frame, m_pAviSynthFile->m_ScriptEnvironment);
+
+		FrameProps_t props;
+		GetFrameProps(m_pAviSynthFile->m_ScriptEnvironment, VFrame, props);
+		num = props.durNum;
+		den = props.durDen;
+
+		return props.HasDuration();
+	}
+	catch ([[maybe_unused]] const AvisynthError& e) {
+		return false;
+	}
+}
+
+void CAviSynthVideoStream::UpdateFromFrameProps(const MediaTypeProps_t& props, const int frame, IMediaSample* pSample)
+{
+	const UINT colorInfo = props.GetColorInfo();
+	const int64_t sarNum = props.GetSarNum();
+	const int64_t sarDen = props.GetSarDen();
+	if (colorInfo == m_ColorInfo && sarNum == m_Sar.num && sarDen == m_Sar.den) {
+		return;
+	}
+
+	CMediaType mt(m_mt);
+	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mt.Format();
+	vih2->dwControlFlags = colorInfo;
+	SetPictAspectRatio(vih2, sarNum, sarDen);
+
+	// the values describe the current media type, a rejected change leaves them as they are
+	if (m_Connected && m_Connected->QueryAccept(&mt) == S_OK && SUCCEEDED(pSample->SetMediaType(&mt))) {
+		DLog(L"CAviSynthVideoStream: media type changed at frame {}", frame);
+		m_ColorInfo = colorInfo;
+		m_Sar.num = sarNum;
+		m_Sar.den = sarDen;
+		m_mt = mt;
+	}
+}
+
 HRESULT CAviSynthVideoStream::SetRate(double dRate)
 {
-	if (dRate <= 0) {
+	if (dRate == 0) {
 		return E_INVALIDARG;
 	}
 
+	const bool bReverse = dRate < 0;
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
+		if (bReverse != (m_dRateSeeking < 0)) {
+			// the playback turns around at the shown frame
+			if (m_LastFrame >= 0) {
+				m_CurrentFrame = m_LastFrame + (bReverse ? -1 : 1);
+			}
+			m_FrameCounter = 0;
+			m_SeekGeneration++;
+		}
 		m_dRateSeeking = dRate;
 	}
+	m_Prefetch.SetReverse(bReverse);
 
 	UpdateFromSeek();
 
@@ -425,14 +654,40 @@ HRESULT CAviSynthVideoStream::ChangeStart()
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
 		m_FrameCounter = 0;
-		m_CurrentFrame = (int)llMulDiv(m_rtStart, m_fpsNum, m_fpsDen * UNITS, 0); // round down
+		m_CurrentFrame = (int)std::min<int64_t>(m_StartUnit, m_NumFrames);
+		m_LastFrame = -1;
+		m_StepFrame = -1;
+		m_SeekGeneration++;
+		// the frames around the new position may already be in the window
+		m_Prefetch.MoveCursor(m_CurrentFrame);
 	}
+	m_QualityControl.Reset();
 
 	UpdateFromSeek();
 
 	return S_OK;
 }
 
+REFERENCE_TIME CAviSynthVideoStream::UnitsToTime(const int64_t units) const
+{
+	return m_Timeline.GetFrameTime((int)std::clamp<int64_t>(units, 0, m_NumFrames));
+}
+
+int64_t CAviSynthVideoStream::TimeToUnits(const REFERENCE_TIME rt) const
+{
+	return m_Timeline.GetFrameNumber(rt);
+}
+
+void CAviSynthVideoStream::WaitStartPosition(const LONGLONG position, const bool bUnits)
+{
+	// the seek lands on the exact time of the frame, the delivery waits on m_pLock meanwhile
+	if (bUnits) {
+		m_Timeline.WaitIndexedFrame((int)std::clamp<int64_t>(position, 0, m_NumFrames));
+	} else {
+		m_Timeline.WaitIndexedTime(position);
+	}
+}
+
 HRESULT CAviSynthVideoStream::ChangeStop()
 {
 	{
@@ -448,39 +703,35 @@ HRESULT CAviSynthVideoStream::ChangeStop()
 	return S_OK;
 }
 
-void CAviSynthVideoStream::InitVideoMediaType()
+void CAviSynthVideoStream::InitVideoMediaType(CMediaType& mt, const FmtParams_t& format)
 {
-	m_mt.InitMediaType();
-	m_mt.SetType(&MEDIATYPE_Video);
-	m_mt.SetSubtype(&m_Format.subtype);
-	m_mt.SetFormatType(&FORMAT_VideoInfo2);
-	m_mt.SetTemporalCompression(FALSE);
-	m_mt.SetSampleSize(m_BufferSize);
-
-	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)m_mt.AllocFormatBuffer(sizeof(VIDEOINFOHEADER2));
+	// the buffer width in pixels is the source pitch
+	const UINT widthBuff = m_Pitch / m_Format.Packsize;
+	const UINT bufferSize = GetOutputPitch(format, widthBuff) * m_Height * format.buffCoeff / 2;
+
+	mt.InitMediaType();
+	mt.SetType(&MEDIATYPE_Video);
+	mt.SetSubtype(format.subtype);
+	mt.SetFormatType(&FORMAT_VideoInfo2);
+	mt.SetTemporalCompression(FALSE);
+	mt.SetSampleSize(bufferSize);
+
+	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mt.AllocFormatBuffer(sizeof(VIDEOINFOHEADER2));
 	ZeroMemory(vih2, sizeof(VIDEOINFOHEADER2));
 	vih2->rcSource = { 0, 0, (long)m_Width, (long)m_Height };
 	vih2->rcTarget = vih2->rcSource;
 	vih2->AvgTimePerFrame         = m_AvgTimePerFrame;
 	vih2->bmiHeader.biSize        = sizeof(vih2->bmiHeader);
-	vih2->bmiHeader.biWidth       = m_PitchBuff / m_Format.Packsize;
-	vih2->bmiHeader.biHeight      = (m_Format.fourcc == BI_RGB) ? -(long)m_Height : m_Height;
+	vih2->bmiHeader.biWidth       = widthBuff;
+	vih2->bmiHeader.biHeight      = (format.fourcc == BI_RGB) ? -(long)m_Height : m_Height;
 	vih2->bmiHeader.biPlanes      = 1;
-	vih2->bmiHeader.biBitCount    = m_Format.bitCount;
-	vih2->bmiHeader.biCompression = m_Format.fourcc;
-	vih2->bmiHeader.biSizeImage   = m_BufferSize;
+	vih2->bmiHeader.biBitCount    = format.bitCount;
+	vih2->bmiHeader.biCompression = format.fourcc;
+	vih2->bmiHeader.biSizeImage   = bufferSize;
 
 	vih2->dwControlFlags = m_ColorInfo;
 
-	if (m_Sar.num > 0 && m_Sar.den > 0 && m_Sar.num < INT16_MAX && m_Sar.den < INT16_MAX) {
-		auto parX = m_Sar.num * m_Width;
-		auto parY = m_Sar.den * m_Height;
-		const auto gcd = std::gcd(parX, parY);
-		parX /= gcd;
-		parY /= gcd;
-		vih2->dwPictAspectRatioX = parX;
-		vih2->dwPictAspectRatioY = parY;
-	}
+	SetPictAspectRatio(vih2, m_Sar.num, m_Sar.den);
 }
 
 HRESULT CAviSynthVideoStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pProperties)
@@ -505,44 +756,77 @@ HRESULT CAviSynthVideoStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_
 	}
 	ASSERT(Actual.cBuffers == pProperties->cBuffers);
 
+	m_SampleCache.Clear(); // a new allocator
+
 	return NOERROR;
 }
 
 HRESULT CAviSynthVideoStream::FillBuffer(IMediaSample* pSample)
 {
+	// The position is taken under the seeking lock, but the frame is rendered without it,
+	// so IMediaSeeking calls do not wait for the script. A seek during the render changes
+	// m_SeekGeneration, then the sample is flushed and the position of the seek is kept.
+	bool bReverse;
+	double rate;
+	int step;
+	int currentFrame;
+	int frameCounter;
+	uint64_t seekGeneration;
 	{
 		CAutoLock cAutoLockShared(&m_cSharedState);
 
-		if (m_CurrentFrame >= m_NumFrames) {
-			return S_FALSE;
-		}
+		// negative rates play backwards
+		bReverse = m_dRateSeeking < 0;
+		rate = std::abs(m_dRateSeeking);
 
-		AM_MEDIA_TYPE* pmt;
-		if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
-			CMediaType mt(*pmt);
-			SetMediaType(&mt);
-			DeleteMediaType(pmt);
+		if (bReverse && m_CurrentFrame >= m_NumFrames) {
+			m_CurrentFrame = m_NumFrames - 1; // started from the end
 		}
-
-		if (m_mt.formattype != FORMAT_VideoInfo2) {
+		if (bReverse ? m_CurrentFrame < 0 : m_CurrentFrame >= m_NumFrames) {
 			return S_FALSE;
 		}
 
-		BYTE* dst_data = nullptr;
-		HRESULT hr = pSample->GetPointer(&dst_data);
-		if (FAILED(hr) || !dst_data) {
-			return S_FALSE;
-		}
+		// fast forward renders only the frames needed for the display rate
+		step = m_BitmapError ? 1 : GetDecimationStep(rate, m_fpsNum, m_fpsDen, m_pAviSynthFile->m_Settings.iMaxRenderFps);
 
-		long buffSize = pSample->GetSize();
-		if (buffSize < (long)m_BufferSize) {
-			return S_FALSE;
-		}
+		currentFrame   = m_CurrentFrame;
+		frameCounter   = m_FrameCounter;
+		seekGeneration = m_SeekGeneration;
+	}
+	const int dir = bReverse ? -1 : 1;
+
+	AM_MEDIA_TYPE* pmt;
+	if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
+		CMediaType mt(*pmt);
+		SetMediaType(&mt);
+		DeleteMediaType(pmt);
+	}
+
+	if (m_mt.formattype != FORMAT_VideoInfo2) {
+		return S_FALSE;
+	}
+
+	BYTE* dst_data = nullptr;
+	HRESULT hr = pSample->GetPointer(&dst_data);
+	if (FAILED(hr) || !dst_data) {
+		return S_FALSE;
+	}
 
-		UINT DataLength = 0;
+	long buffSize = pSample->GetSize();
+	if (buffSize < (long)m_BufferSize) {
+		return S_FALSE;
+	}
+
+	UINT DataLength = 0;
+	PVideoFrame VFrame;
 
-		if (m_BitmapError) {
+	if (m_BitmapError) {
+		// the bitmap does not change, a buffer that already holds it is not copied again
+		const uint64_t key = (uint64_t)(uintptr_t)m_BitmapError.get();
+		DataLength = m_SampleCache.Find(dst_data, key);
+		if (!DataLength) {
 			DataLength = m_PitchBuff * m_Height;
+			m_SampleCache.Set(dst_data, key, DataLength, nullptr);
 
 			const BYTE* src_data = m_BitmapError.get();
 			if (m_Pitch == m_PitchBuff) {
@@ -557,63 +841,155 @@ HRESULT CAviSynthVideoStream::FillBuffer(IMediaSample* pSample)
 				}
 			}
 		}
-		else {
-			auto Clip = m_pAviSynthFile->m_AVSValue.AsClip();
-			PVideoFrame VFrame;
-			try {
-				VFrame = Clip->GetFrame(m_CurrentFrame, m_pAviSynthFile->m_ScriptEnvironment);
-			}
-			catch ([[maybe_unused]] const AvisynthError& e) {
-				DLog(L"IClip::GetFrame threw an exception: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
-				return E_FAIL;
-			}
-
-			const int num_planes = m_Format.planes;
-			for (int i = 0; i < num_planes; i++) {
-				const int plane = m_Planes[i];
-				const BYTE* src_data = VFrame->GetReadPtr(plane);
-				int src_pitch = VFrame->GetPitch(plane);
-				const UINT height = VFrame->GetHeight(plane);
-				UINT dst_pitch = m_PitchBuff;
-				if ((i == 1 || i == 2) && (m_Format.ASformat & VideoInfo::CS_Sub_Width_Mask) == VideoInfo::CS_Sub_Width_2) {
-					dst_pitch /= 2;
+	}
+	else {
+		// catch up with the renderer, the sample times stay relative to the first frame
+		const REFERENCE_TIME frameDuration = (REFERENCE_TIME)(m_AvgTimePerFrame * step / rate);
+		const int framesLeft = bReverse ? currentFrame : m_NumFrames - 1 - currentFrame;
+		const int skip = step * m_QualityControl.GetFramesToSkip(frameDuration, framesLeft / step);
+		frameCounter += skip;
+		currentFrame += dir * skip;
+
+		FrameProps_t props;
+		for (;;) {
+			if (!m_Prefetch.Get(currentFrame, VFrame)) {
+				hr = m_FrameRequest.Get(currentFrame, VFrame);
+				if (hr == E_ABORT) {
+					// the stream is flushed, the sample is discarded
+					pSample->SetActualDataLength(0);
+					return S_OK;
 				}
-
-				if (m_Format.fourcc == BI_RGB || m_Format.fourcc == MAKEFOURCC('B','G','R',48) || m_Format.fourcc == MAKEFOURCC('B','R','A',64)) {
-					src_data += src_pitch * (height - 1);
-					src_pitch = -src_pitch;
+				if (FAILED(hr)) {
+					return E_FAIL;
 				}
+			}
 
-				if (src_pitch == dst_pitch) {
-					memcpy(dst_data, src_data, dst_pitch * height);
-					dst_data += dst_pitch * height;
-				}
-				else {
-					UINT linesize = std::min((UINT)abs(src_pitch), dst_pitch);
-					for (UINT y = 0; y < height; y++) {
-						memcpy(dst_data, src_data, linesize);
-						src_data += src_pitch;
-						dst_data += dst_pitch;
-					}
-				}
-				DataLength += dst_pitch * height;
+			props = {};
+			if (m_bFrameProps) {
+				GetFrameProps(m_pAviSynthFile->m_ScriptEnvironment, VFrame, props);
 			}
+
+			if ((bReverse ? currentFrame > 0 : currentFrame + 1 < m_NumFrames)
+					&& m_QualityControl.CanDropCheapFrame(frameDuration)
+					&& props.IsCheapToSkip()) {
+				m_QualityControl.OnFrameDropped(frameDuration);
+				frameCounter++;
+				currentFrame += dir;
+				continue;
+			}
+			break;
+		}
+
+		if (!m_Timeline.IsIndexed(currentFrame)) {
+			// sequential playback helps the index
+			m_Timeline.AddFrameDuration(currentFrame, props.durNum, props.durDen);
 		}
 
-		pSample->SetActualDataLength(DataLength);
+		if (m_bFrameProps) {
+			if (props.mediaType != m_Props) {
+				m_Props = props.mediaType;
+				UpdateFromFrameProps(props.mediaType, currentFrame, pSample);
+			}
+		}
 
-		// Sample time
-		REFERENCE_TIME rtStart = llMulDiv(UNITS * m_FrameCounter, m_fpsDen, m_fpsNum, 0);
-		REFERENCE_TIME rtStop  = llMulDiv(UNITS * (m_FrameCounter+1), m_fpsDen, m_fpsNum, 0);
-		// The sample times are modified by the current rate.
-		if (m_dRateSeeking != 1.0) {
-			rtStart = static_cast<REFERENCE_TIME>(rtStart / m_dRateSeeking);
-			rtStop  = static_cast<REFERENCE_TIME>(rtStop / m_dRateSeeking);
+		const BYTE* src_data[4] = {};
+		int src_pitch[4] = {};
+		const int planes = m_bOutputAlpha ? m_Format.planes : std::min(m_Format.planes, 3);
+		for (int i = 0; i < planes; i++) {
+			src_data[i]  = VFrame->GetReadPtr(m_Planes[i]);
+			src_pitch[i] = VFrame->GetPitch(m_Planes[i]);
 		}
-		pSample->SetTime(&rtStart, &rtStop);
 
-		m_FrameCounter++;
-		m_CurrentFrame++;
+		// a repeated frame is not copied again into a buffer that already holds it
+		const int duplicateFrames = m_pAviSynthFile->m_Settings.iDuplicateFrames;
+		uint64_t key = 0;
+		if (duplicateFrames == DUPLICATE_FRAME) {
+			key = (uint64_t)(uintptr_t)(void*)VFrame;
+		}
+		else if (duplicateFrames == DUPLICATE_HASH) {
+			int rowSize[4] = {};
+			int rows[4] = {};
+			for (int i = 0; i < planes; i++) {
+				rowSize[i] = VFrame->GetRowSize(m_Planes[i]);
+				rows[i]    = VFrame->GetHeight(m_Planes[i]);
+			}
+			key = GetPlanesHash(planes, src_data, src_pitch, rowSize, rows);
+		}
+
+		DataLength = key ? m_SampleCache.Find(dst_data, key) : 0;
+		if (!DataLength) {
+			DataLength = m_TransferFrame(dst_data, m_PitchBuff, src_data, src_pitch, m_Width, m_Height);
+			if (key) {
+				// the reference keeps the frame address unique while the buffer holds its content
+				m_SampleCache.Set(dst_data, key, DataLength, (duplicateFrames == DUPLICATE_FRAME) ? std::make_shared<PVideoFrame>(VFrame) : nullptr);
+			} else {
+				m_SampleCache.Reset(dst_data);
+			}
+		}
+		if (m_pAviSynthFile->m_pHashManifest) {
+			m_pAviSynthFile->m_pHashManifest->AddVideo(currentFrame, m_OutFormat, dst_data, m_PitchBuff, m_Width, m_Height);
+		}
+	}
+
+	pSample->SetActualDataLength(DataLength);
+
+	// Sample time
+	REFERENCE_TIME rtStart;
+	REFERENCE_TIME rtStop;
+	if (bReverse) {
+		// the frames are shown from the end of the first frame backwards
+		const int firstFrame = currentFrame + frameCounter;
+		const int nextFrame = std::max(currentFrame - step, -1);
+		const REFERENCE_TIME rtFirst = m_Timeline.GetSegmentTime(seekGeneration, firstFrame + 1);
+		rtStart = rtFirst - m_Timeline.GetFrameTime(currentFrame + 1);
+		rtStop  = rtFirst - m_Timeline.GetFrameTime(nextFrame + 1);
+	}
+	else {
+		const int firstFrame = currentFrame - frameCounter;
+		const int nextFrame = std::min(currentFrame + step, m_NumFrames);
+		const REFERENCE_TIME rtFirst = m_Timeline.GetSegmentTime(seekGeneration, firstFrame);
+		rtStart = m_Timeline.GetFrameTime(currentFrame) - rtFirst;
+		rtStop  = m_Timeline.GetFrameTime(nextFrame) - rtFirst;
+	}
+	// The sample times are modified by the current rate.
+	if (rate != 1.0) {
+		rtStart = static_cast<REFERENCE_TIME>(rtStart / rate);
+		rtStop  = static_cast<REFERENCE_TIME>(rtStop / rate);
+	}
+	pSample->SetTime(&rtStart, &rtStop);
+
+	bool bStepComplete = false;
+	{
+		CAutoLock cAutoLockShared(&m_cSharedState);
+
+		if (seekGeneration == m_SeekGeneration) {
+			if (VFrame) {
+				m_Prefetch.SetCursor(currentFrame, VFrame);
+			}
+
+			m_LastFrame = currentFrame;
+			m_LastFrameCounter = frameCounter;
+			if (m_StepFrame >= 0 && (bReverse ? currentFrame <= m_StepFrame : currentFrame >= m_StepFrame)) {
+				const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_StepStart);
+				m_StepLatency.Add(latency.count() * 10);
+				m_StepFrame = -1;
+				bStepComplete = true;
+			}
+
+			m_FrameCounter = frameCounter + step;
+			m_CurrentFrame = currentFrame + dir * step;
+		}
+
+		if (m_Timeline.IsVariable()) {
+			// the duration is exact once the index is complete
+			const REFERENCE_TIME rtDuration = m_Timeline.GetDuration();
+			if (rtDuration != m_rtDuration) {
+				if (m_rtStop == m_rtDuration) {
+					m_rtStop = rtDuration;
+				}
+				m_rtDuration = rtDuration;
+			}
+		}
 	}
 
 	pSample->SetSyncPoint(TRUE);
@@ -623,14 +999,18 @@ HRESULT CAviSynthVideoStream::FillBuffer(IMediaSample* pSample)
 		m_bDiscontinuity = FALSE;
 	}
 
+	if (bStepComplete) {
+		m_pFilter->NotifyEvent(EC_STEP_COMPLETE, FALSE, 0);
+	}
+
 	return S_OK;
 }
 
 HRESULT CAviSynthVideoStream::CheckMediaType(const CMediaType* pmt)
 {
 	if (pmt->majortype == MEDIATYPE_Video
-		&& pmt->subtype == m_Format.subtype
-		&& pmt->formattype == FORMAT_VideoInfo2) {
+		&& pmt->formattype == FORMAT_VideoInfo2
+		&& FindOutputFormat(m_OutputFormats, *pmt) >= 0) {
 
 		VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)pmt->Format();
 		if (vih2->bmiHeader.biWidth >= (long)m_Width && abs(vih2->bmiHeader.biHeight) == (long)m_Height) {
@@ -643,13 +1023,22 @@ HRESULT CAviSynthVideoStream::CheckMediaType(const CMediaType* pmt)
 
 HRESULT CAviSynthVideoStream::SetMediaType(const CMediaType* pMediaType)
 {
+	const int iFormat = FindOutputFormat(m_OutputFormats, *pMediaType);
+	if (iFormat < 0) {
+		return E_INVALIDARG;
+	}
+
 	HRESULT hr = __super::SetMediaType(pMediaType);
 
 	if (SUCCEEDED(hr)) {
+		m_OutFormat = m_OutputFormats[iFormat];
 		VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)pMediaType->Format();
-		m_PitchBuff = m_Format.Packsize * vih2->bmiHeader.biWidth;
-		ASSERT(m_PitchBuff >= m_Pitch);
-		m_BufferSize = m_PitchBuff * abs(vih2->bmiHeader.biHeight) * m_Format.buffCoeff / 2;
+		ASSERT(vih2->bmiHeader.biWidth >= (long)m_Width);
+		m_PitchBuff = GetOutputPitch(m_OutFormat, vih2->bmiHeader.biWidth);
+		m_BufferSize = m_PitchBuff * abs(vih2->bmiHeader.biHeight) * m_OutFormat.buffCoeff / 2;
+		m_TransferFrame = m_OutFormat.copyFrame;
+		m_bOutputAlpha = (m_Format.planes == 4 && IsOutputWithAlpha(m_OutFormat));
+		m_SampleCache.Clear();
 
 		DLog(L"SetMediaType with subtype {}", GUIDtoWString(m_mt.subtype));
 	}
@@ -664,22 +1053,101 @@ HRESULT CAviSynthVideoStream::GetMediaType(int iPosition, CMediaType* pmt)
 	if (iPosition < 0) {
 		return E_INVALIDARG;
 	}
-	if (iPosition >= 1) {
+	if (iPosition >= (int)m_OutputFormats.size()) {
 		return VFW_S_NO_MORE_ITEMS;
 	}
 
-	*pmt = m_mt;
+	InitVideoMediaType(*pmt, m_OutputFormats[iPosition]);
+
+	return S_OK;
+}
+
+// IQualityControl
 
+STDMETHODIMP CAviSynthVideoStream::Notify(IBaseFilter* pSender, Quality q)
+{
+	m_QualityControl.Notify(q);
 	return S_OK;
 }
 
+// IVideoFrameStep of the filter
+
+HRESULT CAviSynthVideoStream::Step(const DWORD frames)
+{
+	if (m_BitmapError) {
+		return E_NOTIMPL;
+	}
+	if (!frames) {
+		return E_INVALIDARG;
+	}
+
+	FILTER_STATE state = State_Stopped;
+	m_pFilter->GetState(0, &state);
+	if (state != State_Paused || !ThreadExists()) {
+		return VFW_E_WRONG_STATE;
+	}
+
+	{
+		CAutoLock lock(CSourceSeeking::m_pLock);
+
+		// steps follow the playback direction
+		const bool bReverse = m_dRateSeeking < 0;
+		const int shownFrame = (m_LastFrame >= 0) ? m_LastFrame : m_CurrentFrame + (bReverse ? 1 : -1);
+		const int frame = bReverse
+			? (int)std::max<int64_t>((int64_t)shownFrame - frames, 0)
+			: (int)std::min<int64_t>((int64_t)shownFrame + frames, m_NumFrames - 1);
+		if (frame == shownFrame) {
+			return S_FALSE; // at the end
+		}
+
+		// the frame takes the place of the shown frame, so the stream time goes on from it
+		if (m_LastFrame >= 0) {
+			m_FrameCounter = m_LastFrameCounter;
+		}
+		m_CurrentFrame = frame;
+		m_StepFrame = frame;
+		m_StepStart = std::chrono::steady_clock::now();
+		m_SeekGeneration++;
+	}
+
+	// the delivery thread is blocked by the paused renderer
+	UpdateFromSeek();
+
+	return S_OK;
+}
+
+HRESULT CAviSynthVideoStream::CanStep() const
+{
+	return m_BitmapError ? S_FALSE : S_OK;
+}
+
+HRESULT CAviSynthVideoStream::CancelStep()
+{
+	CAutoLock lock(CSourceSeeking::m_pLock);
+
+	if (m_StepFrame < 0) {
+		return S_FALSE;
+	}
+	m_StepFrame = -1;
+
+	return S_OK;
+}
+
+int CAviSynthVideoStream::GetFrameNumber(const REFERENCE_TIME rt) const
+{
+	if (m_NumFrames <= 0) {
+		return -1;
+	}
+	return std::clamp(m_Timeline.GetFrameNumber(std::max<REFERENCE_TIME>(rt, 0)), 0, m_NumFrames - 1);
+}
+
 //
 // CAviSynthAudioStream
 //
 
 CAviSynthAudioStream::CAviSynthAudioStream(CAviSynthFile* pAviSynthFile, CSource* pParent, HRESULT* phr)
 	: CSourceStream(L"Audio", phr, pParent, L"Audio")
-	, CSourceSeeking(L"Audio", (IPin*)this, phr, &m_cSharedState)
+	, CStreamSeeking(L"Audio", (IPin*)this, phr, &m_cSharedState, TIME_FORMAT_SAMPLE)
 	, m_pAviSynthFile(pAviSynthFile)
 {
 	CAutoLock cAutoLock(&m_cSharedState);
@@ -731,16 +1199,7 @@ CAviSynthAudioStream::CAviSynthAudioStream(CAviSynthFile* pAviSynthFile, CSource
 
 			if (channelLayout) {
 				WAVEFORMATEXTENSIBLE* wfex = (WAVEFORMATEXTENSIBLE*)m_mt.AllocFormatBuffer(sizeof(WAVEFORMATEXTENSIBLE));
-				wfex->Format.wFormatTag           = WAVE_FORMAT_EXTENSIBLE;
-				wfex->Format.nChannels            = m_Channels;
-				wfex->Format.nSamplesPerSec       = m_SampleRate;
-				wfex->Format.nAvgBytesPerSec      = m_BytesPerSample * m_SampleRate;
-				wfex->Format.nBlockAlign          = m_BytesPerSample;
-				wfex->Format.wBitsPerSample       = m_BitDepth;
-				wfex->Format.cbSize               = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX); // 22
-				wfex->Samples.wValidBitsPerSample = m_BitDepth;
-				wfex->dwChannelMask               = channelLayout;
-				wfex->SubFormat                   = m_Subtype;
+				SetWaveFormatExtensible(wfex, m_Channels, m_SampleRate, m_BytesPerSample, m_BitDepth, m_BitDepth, m_Subtype, channelLayout);
 			}
 			else {
 				WAVEFORMATEX* wfe = (WAVEFORMATEX*)m_mt.AllocFormatBuffer(sizeof(WAVEFORMATEX));
@@ -792,7 +1251,7 @@ HRESULT CAviSynthAudioStream::OnThreadCreate()
 	CAutoLock cAutoLockShared(&m_cSharedState);
 
 	m_SampleCounter = 0;
-	m_CurrentSample = (int)llMulDiv(m_rtStart, m_SampleRate, UNITS, 0); // round down
+	m_CurrentSample = std::min(m_StartUnit, m_NumSamples);
 
 	return CSourceStream::OnThreadCreate();
 }
@@ -828,7 +1287,7 @@ void CAviSynthAudioStream::UpdateFromSeek()
 
 HRESULT CAviSynthAudioStream::SetRate(double dRate)
 {
-	if (dRate <= 0) {
+	if (dRate == 0) {
 		return E_INVALIDARG;
 	}
 
@@ -847,7 +1306,8 @@ HRESULT CAviSynthAudioStream::ChangeStart()
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
 		m_SampleCounter = 0;
-		m_CurrentSample = (int)llMulDiv(m_rtStart, m_SampleRate, UNITS, 0); // round down
+		m_CurrentSample = std::min(m_StartUnit, m_NumSamples);
+		m_SeekGeneration++;
 	}
 
 	UpdateFromSeek();
@@ -855,6 +1315,16 @@ HRESULT CAviSynthAudioStream::ChangeStart()
 	return S_OK;
 }
 
+REFERENCE_TIME CAviSynthAudioStream::UnitsToTime(const int64_t units) const
+{
+	return llMulDiv(units, UNITS, m_SampleRate, 0);
+}
+
+int64_t CAviSynthAudioStream::TimeToUnits(const REFERENCE_TIME rt) const
+{
+	return llMulDiv(rt, m_SampleRate, UNITS, 0); // round down
+}
+
 HRESULT CAviSynthAudioStream::ChangeStop()
 {
 	{
@@ -897,59 +1367,88 @@ HRESULT CAviSynthAudioStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_
 
 HRESULT CAviSynthAudioStream::FillBuffer(IMediaSample* pSample)
 {
+	// the audio is rendered without the seeking lock, see CAviSynthVideoStream::FillBuffer
+	bool bReverse;
+	double rate;
+	int64_t currentSample;
+	int64_t sampleCounter;
+	uint64_t seekGeneration;
 	{
 		CAutoLock cAutoLockShared(&m_cSharedState);
 
-		if (m_CurrentSample >= m_NumSamples) {
+		// negative rates play backwards
+		bReverse = m_dRateSeeking < 0;
+		rate = std::abs(m_dRateSeeking);
+
+		if (bReverse ? m_CurrentSample <= 0 : m_CurrentSample >= m_NumSamples) {
 			return S_FALSE;
 		}
 
-		AM_MEDIA_TYPE* pmt;
-		if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
-			CMediaType mt(*pmt);
-			SetMediaType(&mt);
-			DeleteMediaType(pmt);
-		}
+		currentSample  = m_CurrentSample;
+		sampleCounter  = m_SampleCounter;
+		seekGeneration = m_SeekGeneration;
+	}
 
-		if (m_mt.formattype != FORMAT_WaveFormatEx) {
-			return S_FALSE;
-		}
+	AM_MEDIA_TYPE* pmt;
+	if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
+		CMediaType mt(*pmt);
+		SetMediaType(&mt);
+		DeleteMediaType(pmt);
+	}
 
-		BYTE* dst_data = nullptr;
-		HRESULT hr = pSample->GetPointer(&dst_data);
-		if (FAILED(hr) || !dst_data) {
-			return S_FALSE;
-		}
+	if (m_mt.formattype != FORMAT_WaveFormatEx) {
+		return S_FALSE;
+	}
 
-		long buffSize = pSample->GetSize();
-		if (buffSize < (long)(m_BufferSamples * m_BytesPerSample)) {
-			return S_FALSE;
-		}
+	BYTE* dst_data = nullptr;
+	HRESULT hr = pSample->GetPointer(&dst_data);
+	if (FAILED(hr) || !dst_data) {
+		return S_FALSE;
+	}
 
-		auto Clip = m_pAviSynthFile->m_AVSValue.AsClip();
-		int64_t count = std::min<int64_t>(m_BufferSamples, m_NumSamples - m_CurrentSample);
+	long buffSize = pSample->GetSize();
+	if (buffSize < (long)(m_BufferSamples * m_BytesPerSample)) {
+		return S_FALSE;
+	}
+
+	auto Clip = m_pAviSynthFile->m_AVSValue.AsClip();
+	int64_t count = std::min<int64_t>(m_BufferSamples, bReverse ? currentSample : m_NumSamples - currentSample);
+	if (bReverse || rate > 1.0) {
+		// fast forward and reverse playback are muted, the script audio is not rendered
+		memset(dst_data, (m_BitDepth == 8) ? 0x80 : 0, (size_t)(count * m_BytesPerSample));
+	}
+	else {
 		try {
-			Clip->GetAudio(dst_data, m_CurrentSample, count, m_pAviSynthFile->m_ScriptEnvironment);
+			Clip->GetAudio(dst_data, currentSample, count, m_pAviSynthFile->m_ScriptEnvironment);
 		}
 		catch ([[maybe_unused]] const AvisynthError& e) {
 			DLog(L"IClip::GetAudio threw an exception: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
 			return E_FAIL;
 		}
+		if (m_pAviSynthFile->m_pHashManifest) {
+			m_pAviSynthFile->m_pHashManifest->AddAudio(currentSample, dst_data, (size_t)(count * m_BytesPerSample));
+		}
+	}
 
-		pSample->SetActualDataLength(count * m_BytesPerSample);
+	pSample->SetActualDataLength(count * m_BytesPerSample);
 
-		// Sample time
-		REFERENCE_TIME rtStart = llMulDiv(m_SampleCounter, UNITS, m_SampleRate, 0);
-		REFERENCE_TIME rtStop  = llMulDiv(m_SampleCounter + count, UNITS, m_SampleRate, 0);
-		// The sample times are modified by the current rate.
-		if (m_dRateSeeking != 1.0) {
-			rtStart = static_cast<REFERENCE_TIME>(rtStart / m_dRateSeeking);
-			rtStop  = static_cast<REFERENCE_TIME>(rtStop / m_dRateSeeking);
-		}
-		pSample->SetTime(&rtStart, &rtStop);
+	// Sample time
+	REFERENCE_TIME rtStart = llMulDiv(sampleCounter, UNITS, m_SampleRate, 0);
+	REFERENCE_TIME rtStop  = llMulDiv(sampleCounter + count, UNITS, m_SampleRate, 0);
+	// The sample times are modified by the current rate.
+	if (rate != 1.0) {
+		rtStart = static_cast<REFERENCE_TIME>(rtStart / rate);
+		rtStop  = static_cast<REFERENCE_TIME>(rtStop / rate);
+	}
+	pSample->SetTime(&rtStart, &rtStop);
+
+	{
+		CAutoLock cAutoLockShared(&m_cSharedState);
 
-		m_SampleCounter += count;
-		m_CurrentSample += count;
+		if (seekGeneration == m_SeekGeneration) {
+			m_SampleCounter = sampleCounter + count;
+			m_CurrentSample = currentSample + (bReverse ? -count : count);
+		}
 	}
 
 	pSample->SetSyncPoint(TRUE);
@@ -1006,3 +1505,262 @@ HRESULT CAviSynthAudioStream::GetMediaType(int iPosition, CMediaType* pmt)
 
 	return S_OK;
 }
+
+//
+// CAviSynthThumbnailRenderer
+//
+
+CAviSynthThumbnailRenderer::CAviSynthThumbnailRenderer(const WCHAR* filepath, const Settings_t& settings, const UINT width, HRESULT* phr)
+{
+	HRESULT hr = E_FAIL;
+	m_pAviSynthFile.reset(new(std::nothrow) CAviSynthFile(filepath, settings, nullptr, &hr));
+	if (!m_pAviSynthFile || hr != S_OK || !m_pAviSynthFile->m_AVSValue.AsClip()->GetVideoInfo().HasVideo()) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	IScriptEnvironment* env = m_pAviSynthFile->m_ScriptEnvironment;
+
+	try {
+		AVSValue clip = m_pAviSynthFile->m_AVSValue;
+		const VideoInfo VInfo = clip.AsClip()->GetVideoInfo();
+
+		m_Width  = std::max(std::min<UINT>(width, VInfo.width) & ~1u, 2u);
+		m_Height = GetThumbnailHeight(m_Width, VInfo.width, VInfo.height);
+		m_NumFrames = VInfo.num_frames;
+
+		// downscale first, the conversion is cheaper on the small frame
+		AVSValue resizeArgs[3] = { clip, (int)m_Width, (int)m_Height };
+		clip = env->Invoke("BilinearResize", AVSValue(resizeArgs, 3));
+
+		if (VInfo.BitsPerComponent() != 8) {
+			AVSValue bitsArgs[2] = { clip, 8 };
+			clip = env->Invoke("ConvertBits", AVSValue(bitsArgs, 2));
+		}
+		if (!VInfo.IsRGB32()) {
+			clip = env->Invoke("ConvertToRGB32", clip);
+		}
+
+		m_Clip = clip.AsClip();
+		*phr = S_OK;
+	}
+	catch ([[maybe_unused]] const AvisynthError& e) {
+		DLog(L"CAviSynthThumbnailRenderer: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
+		*phr = E_FAIL;
+	}
+}
+
+CAviSynthThumbnailRenderer::~CAviSynthThumbnailRenderer()
+{
+	m_Clip = nullptr; // must be released before the script environment
+	m_pAviSynthFile.reset();
+}
+
+bool CAviSynthThumbnailRenderer::Render(const int frame, BYTE* dst)
+{
+	try {
+		PVideoFrame Frame = m_Clip->GetFrame(frame, m_pAviSynthFile->m_ScriptEnvironment);
+
+		// RGB32 frames are bottom-up
+		const int pitch = Frame->GetPitch();
+		const BYTE* src = Frame->GetReadPtr() + (ptrdiff_t)pitch * (m_Height - 1);
+		const UINT rowSize = m_Width * 4;
+
+		for (UINT y = 0; y < m_Height; y++) {
+			memcpy(dst, src, rowSize);
+			dst += rowSize;
+			src -= pitch;
+		}
+
+		return true;
+	}
+	catch ([[maybe_unused]] const AvisynthError& e) {
+		DLog(L"CAviSynthThumbnailRenderer: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
+		return false;
+	}
+}
+
+//
+// CAviSynthReader
+//
+
+CAviSynthReader::CAviSynthReader(const WCHAR* filepath, const Settings_t& settings, const int lookahead, HRESULT* phr)
+{
+	HRESULT hr = E_FAIL;
+	m_pAviSynthFile.reset(new(std::nothrow) CAviSynthFile(filepath, settings, nullptr, &hr));
+	if (!m_pAviSynthFile || hr != S_OK || !m_pAviSynthFile->m_AVSValue.AsClip()->GetVideoInfo().HasVideo()) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	IScriptEnvironment* env = m_pAviSynthFile->m_ScriptEnvironment;
+	m_Clip = m_pAviSynthFile->m_AVSValue.AsClip();
+	const VideoInfo& VInfo = m_Clip->GetVideoInfo();
+
+	auto& vi = m_VideoInfo;
+	vi.format = GetFormatParamsAviSynth(VInfo.pixel_type);
+	if (vi.format.fourcc == DWORD(-1)) {
+		DLog(L"CAviSynthReader: unsuported pixel_type {:#010x}", (uint32_t)VInfo.pixel_type);
+		*phr = E_FAIL;
+		return;
+	}
+
+	vi.width     = VInfo.width;
+	vi.height    = VInfo.height;
+	vi.numFrames = VInfo.num_frames;
+	vi.fpsNum    = VInfo.fps_numerator;
+	vi.fpsDen    = VInfo.fps_denominator;
+	vi.bitDepth  = VInfo.BitsPerComponent();
+	vi.bFloat    = VInfo.ComponentSize() == 4;
+	vi.bYUV      = VInfo.IsYUV() || VInfo.IsYUVA();
+	vi.bGray     = VInfo.IsY();
+
+	if (VInfo.IsPlanar()) {
+		if (vi.bGray) {
+			m_Planes[0] = PLANAR_Y;
+			vi.planes = 1;
+		}
+		else {
+			if (vi.bYUV) {
+				m_Planes[0] = PLANAR_Y;
+				m_Planes[1] = PLANAR_U;
+				m_Planes[2] = PLANAR_V;
+				vi.subsamplingW = VInfo.GetPlaneWidthSubsampling(PLANAR_U);
+				vi.subsamplingH = VInfo.GetPlaneHeightSubsampling(PLANAR_U);
+			} else {
+				m_Planes[0] = PLANAR_G;
+				m_Planes[1] = PLANAR_B;
+				m_Planes[2] = PLANAR_R;
+			}
+			m_Planes[3] = PLANAR_A;
+			vi.planes = (VInfo.IsYUVA() || VInfo.IsPlanarRGBA()) ? 4 : 3;
+		}
+	} else {
+		vi.planes = 1;
+	}
+
+	try {
+		env->CheckVersion(8);
+		m_bFrameProps = true;
+	}
+	catch (const AvisynthError&) {
+		m_bFrameProps = false;
+	}
+
+	m_Prefetch.Start(vi.numFrames, lookahead, [this](const int frame, PVideoFrame& out) {
+		return GetFrame(frame, out);
+	});
+	m_Prefetch.Enable(true);
+
+	*phr = S_OK;
+}
+
+CAviSynthReader::~CAviSynthReader()
+{
+	m_Prefetch.Stop();
+	m_Clip = nullptr; // must be released before the script environment
+	m_pAviSynthFile.reset();
+}
+
+bool CAviSynthReader::GetFrame(const int frame, PVideoFrame& out)
+{
+	std::lock_guard<std::mutex> lock(m_mutexGetFrame);
+
+	try {
+		out = m_Clip->GetFrame(frame, m_pAviSynthFile->m_ScriptEnvironment);
+		return true;
+	}
+	catch ([[maybe_unused]] const AvisynthError& e) {
+		DLog(L"CAviSynthReader: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
+		return false;
+	}
+}
+
+bool CAviSynthReader::ReadFrame(const int frame, ScriptFrame_t& out)
+{
+	if (frame < 0 || frame >= m_VideoInfo.numFrames) {
+		return false;
+	}
+
+	PVideoFrame VFrame;
+	if (!m_Prefetch.Get(frame, VFrame) && !GetFrame(frame, VFrame)) {
+		return false;
+	}
+	// the window follows the reading position, so the next frames are rendered ahead
+	m_Prefetch.SetCursor(frame, VFrame);
+
+	for (int i = 0; i < m_VideoInfo.planes; i++) {
+		out.data[i]  = VFrame->GetReadPtr(m_Planes[i]);
+		out.pitch[i] = VFrame->GetPitch(m_Planes[i]);
+	}
+
+	FrameProps_t props;
+	if (m_bFrameProps) {
+		GetFrameProps(m_pAviSynthFile->m_ScriptEnvironment, VFrame, props);
+	}
+	out.props = props.mediaType;
+	out.fieldBased = props.fieldBased;
+
+	out.ref = std::make_shared<PVideoFrame>(std::move(VFrame));
+
+	return true;
+}
+
+//
+// CAviSynthAudioReader
+//
+
+CAviSynthAudioReader::CAviSynthAudioReader(const WCHAR* filepath, const Settings_t& settings, HRESULT* phr)
+{
+	HRESULT hr = E_FAIL;
+	m_pAviSynthFile.reset(new(std::nothrow) CAviSynthFile(filepath, settings, nullptr, &hr));
+	if (!m_pAviSynthFile || hr != S_OK) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	m_Clip = m_pAviSynthFile->m_AVSValue.AsClip();
+	const VideoInfo& VInfo = m_Clip->GetVideoInfo();
+	if (!VInfo.HasAudio()) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	const int channels       = VInfo.AudioChannels();
+	const int bytesPerSample = VInfo.BytesPerAudioSample();
+	const int bitDepth       = bytesPerSample * 8 / channels;
+
+	bool has_at_least_v10 = true;
+	try {
+		m_pAviSynthFile->m_ScriptEnvironment->CheckVersion(10);
+	}
+	catch (const AvisynthError&) {
+		has_at_least_v10 = false;
+	}
+
+	SetWaveFormatExtensible(&m_AudioInfo.wfex, channels, VInfo.SamplesPerSecond(), bytesPerSample, bitDepth, bitDepth,
+		(VInfo.SampleType() == SAMPLE_FLOAT) ? MEDIASUBTYPE_IEEE_FLOAT : MEDIASUBTYPE_PCM,
+		has_at_least_v10 ? VInfo.GetChannelMask() : 0);
+	m_AudioInfo.numSamples = VInfo.num_audio_samples;
+	m_AudioInfo.chunkSamples = VInfo.SamplesPerSecond() / 5; // as CAviSynthAudioStream
+
+	*phr = S_OK;
+}
+
+CAviSynthAudioReader::~CAviSynthAudioReader()
+{
+	m_Clip = nullptr; // must be released before the script environment
+	m_pAviSynthFile.reset();
+}
+
+bool CAviSynthAudioReader::ReadAudio(BYTE* dst, const int64_t start, const int count)
+{
+	try {
+		m_Clip->GetAudio(dst, start, count, m_pAviSynthFile->m_ScriptEnvironment);
+		return true;
+	}
+	catch ([[maybe_unused]] const AvisynthError& e) {
+		DLog(L"IClip::GetAudio threw an exception: {}", ConvertUtf8OrAnsiLinesToWide(e.msg));
+		return false;
+	}
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2024 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -10,6 +10,15 @@
 #include "../Include/avisynth.h"
 #endif
 #include "Helper.h"
+#include "FrameHash.h"
+#include "FramePrefetch.h"
+#include "FrameRequest.h"
+#include "FrameTimeline.h"
+#include "QualityControl.h"
+#include "SampleBufferCache.h"
+#include "ScriptReader.h"
+#include "StreamSeeking.h"
+#include "Thumbnailer.h"
 
  //
  // CAviSynthFile
@@ -19,6 +28,9 @@ class CAviSynthFile
 {
 	friend class CAviSynthVideoStream;
 	friend class CAviSynthAudioStream;
+	friend class CAviSynthThumbnailRenderer;
+	friend class CAviSynthReader;
+	friend class CAviSynthAudioReader;
 
 	HMODULE m_hAviSynthDll = nullptr;
 
@@ -28,11 +40,28 @@ class CAviSynthFile
 
 	std::wstring m_FileInfo;
 
+	const Settings_t m_Settings;
+	const std::unique_ptr<CHashManifest> m_pHashManifest; // if enabled in the settings
+
+	class CAviSynthVideoStream* m_pVideoStream = nullptr;
+
 public:
-	CAviSynthFile(const WCHAR* filepath, CSource* pParent, HRESULT* phr);
+	CAviSynthFile(const WCHAR* filepath, const Settings_t& settings, CSource* pParent, HRESULT* phr);
 	~CAviSynthFile();
 
 	std::wstring_view GetInfo() { return m_FileInfo; }
+	int64_t GetDroppedFrames() const;
+	std::wstring GetHashManifest() const;
+
+	// frame stepping of the video stream
+	void EnablePrefetch(const bool enable);
+	HRESULT Step(const DWORD frames);
+	HRESULT CanStep() const;
+	HRESULT CancelStep();
+	const CLatencyStats* GetStepLatency() const;
+
+	// the frame of the video stream at the time, or -1 if there is no video
+	int GetFrameNumber(const REFERENCE_TIME rt) const;
 };
 
 //
@@ -41,7 +70,7 @@ public:
 
 class CAviSynthVideoStream
 	: public CSourceStream
-	, public CSourceSeeking
+	, public CStreamSeeking
 {
 private:
 	CCritSec m_cSharedState;
@@ -53,29 +82,48 @@ private:
 
 	PVideoFrame m_Frame;
 	int         m_Planes[4] = {};
+	CCritSec    m_csGetFrame; // IClip::GetFrame is also called by the prefetch, frame request and timeline index threads
 
 	std::unique_ptr<BYTE[]> m_BitmapError;
+	CSampleBufferCache m_SampleCache;
 
 	REFERENCE_TIME m_AvgTimePerFrame = 0;
 	int m_FrameCounter = 0;
 	int m_CurrentFrame = 0;
 
-	FmtParams_t m_Format = {};
+	FmtParams_t m_Format = {};    // source format
+	FmtParams_t m_OutFormat = {}; // connected output format
+	std::vector<FmtParams_t> m_OutputFormats;
 	UINT m_Width   = 0;
 	UINT m_Height  = 0;
 	UINT m_Pitch   = 0;
 	UINT m_PitchBuff  = 0;
 	UINT m_BufferSize = 0;
 
+	TransferFrameFn m_TransferFrame = nullptr;
+	bool m_bOutputAlpha = false; // the connected type carries the alpha plane
+
 	UINT m_ColorInfo = 0;
 	struct {
 		int64_t num = 0;
 		int64_t den = 0;
 	} m_Sar;
+	MediaTypeProps_t m_Props; // media type props of the last frame, accepted or not
+	bool m_bFrameProps = false; // AviSynth+ interface v8 or later
 
 	int m_NumFrames = 0;
 	unsigned m_fpsNum = 1;
 	unsigned m_fpsDen = 1;
+	CFrameTimeline m_Timeline;
+	CQualityControl m_QualityControl;
+
+	CFramePrefetch<PVideoFrame> m_Prefetch;
+	CFrameRequest<PVideoFrame> m_FrameRequest; // the frame of the delivery thread
+	int m_LastFrame        = -1; // the last delivered frame
+	int m_LastFrameCounter = 0;
+	int m_StepFrame        = -1; // the frame requested by Step
+	std::chrono::steady_clock::time_point m_StepStart;
+	CLatencyStats m_StepLatency;
 
 	std::wstring m_StreamInfo;
 
@@ -93,6 +141,8 @@ private:
 	HRESULT OnThreadStartPlay() override;
 
 	void UpdateFromSeek();
+	bool ReadFrameDuration(const int frame, int64_t& num, int64_t& den);
+	void UpdateFromFrameProps(const MediaTypeProps_t& props, const int frame, IMediaSample* pSample);
 
 	// IMediaSeeking
 	STDMETHODIMP SetRate(double dRate) override;
@@ -101,7 +151,12 @@ private:
 	HRESULT ChangeStop() override;
 	HRESULT ChangeRate() override { return S_OK; }
 
-	void InitVideoMediaType();
+	// CStreamSeeking
+	REFERENCE_TIME UnitsToTime(const int64_t units) const override;
+	int64_t TimeToUnits(const REFERENCE_TIME rt) const override;
+	void WaitStartPosition(const LONGLONG position, const bool bUnits) override;
+
+	void InitVideoMediaType(CMediaType& mt, const FmtParams_t& format);
 
 public:
 	HRESULT DecideBufferSize(IMemAllocator* pIMemAlloc, ALLOCATOR_PROPERTIES* pProperties) override;
@@ -111,7 +166,16 @@ public:
 	HRESULT GetMediaType(int iPosition, CMediaType* pmt) override;
 
 	// IQualityControl
-	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override { return E_NOTIMPL; }
+	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override;
+
+	int64_t GetDroppedFrames() const { return m_QualityControl.GetDroppedFrames(); }
+
+	void EnablePrefetch(const bool enable) { m_Prefetch.Enable(enable); }
+	HRESULT Step(const DWORD frames);
+	HRESULT CanStep() const;
+	HRESULT CancelStep();
+	const CLatencyStats& GetStepLatency() const { return m_StepLatency; }
+	int GetFrameNumber(const REFERENCE_TIME rt) const;
 };
 
 //
@@ -120,7 +184,7 @@ public:
 
 class CAviSynthAudioStream
 	: public CSourceStream
-	, public CSourceSeeking
+	, public CStreamSeeking
 {
 private:
 	CCritSec m_cSharedState;
@@ -165,6 +229,10 @@ private:
 	HRESULT ChangeStop() override;
 	HRESULT ChangeRate() override { return S_OK; }
 
+	// CStreamSeeking
+	REFERENCE_TIME UnitsToTime(const int64_t units) const override;
+	int64_t TimeToUnits(const REFERENCE_TIME rt) const override;
+
 public:
 	HRESULT DecideBufferSize(IMemAllocator* pIMemAlloc, ALLOCATOR_PROPERTIES* pProperties) override;
 	HRESULT FillBuffer(IMediaSample* pSample) override;
@@ -175,3 +243,58 @@ public:
 	// IQualityControl
 	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override { return E_NOTIMPL; }
 };
+
+//
+// CAviSynthThumbnailRenderer
+//
+
+class CAviSynthThumbnailRenderer : public CThumbnailRenderer
+{
+	std::unique_ptr<CAviSynthFile> m_pAviSynthFile;
+	PClip m_Clip; // downscaled RGB32
+
+public:
+	CAviSynthThumbnailRenderer(const WCHAR* filepath, const Settings_t& settings, const UINT width, HRESULT* phr);
+	~CAviSynthThumbnailRenderer();
+
+	bool Render(const int frame, BYTE* dst) override;
+};
+
+//
+// CAviSynthReader
+//
+
+class CAviSynthReader : public CScriptReader
+{
+	std::unique_ptr<CAviSynthFile> m_pAviSynthFile;
+	PClip m_Clip;
+	int   m_Planes[4] = {};
+	bool  m_bFrameProps = false;
+
+	std::mutex m_mutexGetFrame; // IClip::GetFrame is also called by the prefetch thread
+	CFramePrefetch<PVideoFrame> m_Prefetch;
+
+	bool GetFrame(const int frame, PVideoFrame& out);
+
+public:
+	CAviSynthReader(const WCHAR* filepath, const Settings_t& settings, const int lookahead, HRESULT* phr);
+	~CAviSynthReader();
+
+	bool ReadFrame(const int frame, ScriptFrame_t& out) override;
+};
+
+//
+// CAviSynthAudioReader
+//
+
+class CAviSynthAudioReader : public CScriptAudioReader
+{
+	std::unique_ptr<CAviSynthFile> m_pAviSynthFile;
+	PClip m_Clip;
+
+public:
+	CAviSynthAudioReader(const WCHAR* filepath, const Settings_t& settings, HRESULT* phr);
+	~CAviSynthAudioReader();
+
+	bool ReadAudio(BYTE* dst, const int64_t start, const int count) override;
+};
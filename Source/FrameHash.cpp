@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <bit>
+
+#include "Helper.h"
+
+#include "FrameHash.h"
+
+static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t Read64(const BYTE* p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Read32(const BYTE* p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t Round(uint64_t acc, const uint64_t input)
+{
+	acc += input * kPrime2;
+	acc = std::rotl(acc, 31);
+	return acc * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t acc, const uint64_t value)
+{
+	acc ^= Round(0, value);
+	return acc * kPrime1 + kPrime4;
+}
+
+uint64_t GetDataHash(const void* data, const size_t size, const uint64_t seed)
+{
+	const BYTE* p = (const BYTE*)data;
+	const BYTE* const end = p + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		uint64_t v1 = seed + kPrime1 + kPrime2;
+		uint64_t v2 = seed + kPrime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - kPrime1;
+
+		const BYTE* const limit = end - 32;
+		do {
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	} else {
+		hash = seed + kPrime5;
+	}
+
+	hash += size;
+
+	for (; p + 8 <= end; p += 8) {
+		hash ^= Round(0, Read64(p));
+		hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+	}
+	if (p + 4 <= end) {
+		hash ^= Read32(p) * kPrime1;
+		hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		hash ^= *p * kPrime5;
+		hash = std::rotl(hash, 11) * kPrime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+uint64_t GetPlanesHash(const int planes, const BYTE* const data[4], const int pitch[4], const int rowSize[4], const int rows[4])
+{
+	uint64_t hash = 0;
+	for (int i = 0; i < planes; i++) {
+		const BYTE* src = data[i];
+		for (int y = 0; y < rows[i]; y++) {
+			hash = GetDataHash(src, rowSize[i], hash);
+			src += pitch[i];
+		}
+	}
+	return hash;
+}
+
+//
+// CHashManifest
+//
+
+void CHashManifest::AddVideo(const int frame, const FmtParams_t& format, const BYTE* data, const UINT pitch, const UINT width, const UINT height)
+{
+	const BYTE* planeData[4] = {};
+	int planePitch[4] = {};
+	int rowSize[4] = {};
+	int rows[4] = {};
+	const int planes = GetOutputPlanes(format, data, pitch, width, height, planeData, planePitch, rowSize, rows);
+
+	size_t size = 0;
+	for (int i = 0; i < planes; i++) {
+		size += (size_t)rowSize[i] * rows[i];
+	}
+	const uint64_t hash = GetPlanesHash(planes, planeData, planePitch, rowSize, rows);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_Video.insert_or_assign(frame, Entry_t{ format.str, size, hash });
+}
+
+void CHashManifest::AddAudio(const int64_t sample, const BYTE* data, const size_t size)
+{
+	const uint64_t hash = GetDataHash(data, size);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_Audio.insert_or_assign(sample, Entry_t{ {}, size, hash });
+}
+
+std::wstring CHashManifest::GetText()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::wstring text;
+	for (const auto& [frame, entry] : m_Video) {
+		text += std::format(L"video {} {} {} {:016x}\n", frame, entry.format, entry.size, entry.hash);
+	}
+	for (const auto& [sample, entry] : m_Audio) {
+		text += std::format(L"audio {} {} {:016x}\n", sample, entry.size, entry.hash);
+	}
+
+	return text;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+
+struct FmtParams_t;
+
+// XXH64 of the data. Four independent lanes keep the multipliers busy, so the hash runs at
+// memory speed and is cheap enough for every delivered sample.
+uint64_t GetDataHash(const void* data, const size_t size, const uint64_t seed = 0);
+
+// Hash of the visible rows of the frame planes, the padding after each row is not hashed.
+uint64_t GetPlanesHash(const int planes, const BYTE* const data[4], const int pitch[4], const int rowSize[4], const int rows[4]);
+
+//
+// CHashManifest
+//
+// Collects the hashes of the delivered video frames and audio chunks. The entries are sorted
+// by the frame number and the first sample, so the text of two builds can be compared with
+// any diff tool regardless of the playback timing. A repeated entry replaces the previous one.
+// Only the visible rows of the video planes are hashed, so the entries do not depend on the
+// pitch of the sample buffer.
+
+class CHashManifest
+{
+	struct Entry_t {
+		std::wstring format; // video output format
+		size_t   size;
+		uint64_t hash;
+	};
+
+	std::mutex m_mutex;
+	std::map<int, Entry_t>     m_Video;
+	std::map<int64_t, Entry_t> m_Audio;
+
+public:
+	void AddVideo(const int frame, const FmtParams_t& format, const BYTE* data, const UINT pitch, const UINT width, const UINT height);
+	void AddAudio(const int64_t sample, const BYTE* data, const size_t size);
+
+	// Lines "video <frame> <format> <size> <hash>" and "audio <sample> <size> <hash>".
+	std::wstring GetText();
+};
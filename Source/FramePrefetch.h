@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+
+//
+// CFramePrefetch
+//
+// Keeps the script frames around the cursor, so that frame steps are served from memory.
+// While enabled, a background thread renders the frames after and before the cursor,
+// the nearest ones first. Frames outside the window are released when the cursor moves.
+// In reverse mode the window only extends behind the cursor and is filled in descending
+// order while playing too, so that reverse playback is delivered from it.
+// Frame_t holds a reference to a script frame and must be cheap to copy.
+
+template <typename Frame_t>
+class CFramePrefetch
+{
+public:
+	// Renders the frame. Returns false if the frame could not be rendered.
+	typedef std::function<bool(const int frame, Frame_t& out)> GetFrameFn;
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_cv;
+	std::map<int, Frame_t>  m_Frames;
+
+	GetFrameFn m_GetFrame;
+	int  m_NumFrames = 0;
+	int  m_Radius    = 0;  // frames kept on each side of the cursor
+	int  m_Cursor    = -1;
+	int  m_InFlight  = -1; // frame being rendered by the thread
+	bool m_bEnabled  = false;
+	bool m_bReverse  = false;
+	bool m_bFailed   = false; // a render failed, wait for the next cursor
+	bool m_bStop     = false;
+
+	std::thread m_Thread;
+
+	// require m_mutex
+	bool IsInWindow(const int frame) const
+	{
+		return m_Cursor >= 0 && frame >= m_Cursor - m_Radius && frame <= m_Cursor + (m_bReverse ? 0 : m_Radius);
+	}
+
+	int GetNextFrame() const
+	{
+		if (m_Cursor < 0) {
+			return -1;
+		}
+		for (int d = 1; d <= m_Radius; d++) {
+			const int next = m_Cursor + d;
+			if (!m_bReverse && next < m_NumFrames && next != m_InFlight && !m_Frames.contains(next)) {
+				return next;
+			}
+			const int prev = m_Cursor - d;
+			if (prev >= 0 && prev != m_InFlight && !m_Frames.contains(prev)) {
+				return prev;
+			}
+		}
+		return -1;
+	}
+
+	void ThreadProc()
+	{
+		// prefetching must not take time away from the delivery thread
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;) {
+			m_cv.wait(lock, [this] {
+				return m_bStop || ((m_bEnabled || m_bReverse) && !m_bFailed && GetNextFrame() >= 0);
+			});
+			if (m_bStop) {
+				break;
+			}
+
+			const int frame = GetNextFrame();
+			m_InFlight = frame;
+			lock.unlock();
+
+			Frame_t data;
+			const bool ok = m_GetFrame(frame, data);
+
+			lock.lock();
+			m_InFlight = -1;
+			if (!ok) {
+				DLog(L"CFramePrefetch: failed to render frame {}", frame);
+				m_bFailed = true;
+			}
+			else if (IsInWindow(frame)) {
+				m_Frames.insert_or_assign(frame, std::move(data));
+			}
+			m_cv.notify_all();
+		}
+	}
+
+public:
+	~CFramePrefetch()
+	{
+		Stop();
+	}
+
+	void Start(const int numFrames, const int radius, GetFrameFn getFrame)
+	{
+		Stop();
+
+		m_NumFrames = numFrames;
+		m_Radius    = radius;
+		m_GetFrame  = std::move(getFrame);
+		m_Cursor    = -1;
+		m_bStop     = false;
+
+		if (m_Radius > 0) {
+			m_Thread = std::thread(&CFramePrefetch::ThreadProc, this);
+		}
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+		}
+		m_cv.notify_all();
+
+		if (m_Thread.joinable()) {
+			m_Thread.join();
+		}
+		m_Frames.clear();
+	}
+
+	// The frames are only rendered in the background while the filter is paused.
+	void Enable(const bool enable)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bEnabled = enable;
+			m_bFailed  = false;
+		}
+		m_cv.notify_all();
+	}
+
+	// Reverse playback renders the frames behind the cursor even while running.
+	void SetReverse(const bool reverse)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bReverse = reverse;
+			m_bFailed  = false;
+			std::erase_if(m_Frames, [this](const auto& item) {
+				return !IsInWindow(item.first);
+			});
+		}
+		m_cv.notify_all();
+	}
+
+	// Moves the window, the frames that stay in it are kept.
+	void MoveCursor(const int frame)
+	{
+		if (m_Radius <= 0) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_Cursor  = frame;
+			m_bFailed = false;
+			std::erase_if(m_Frames, [this](const auto& item) {
+				return !IsInWindow(item.first);
+			});
+		}
+		m_cv.notify_all();
+	}
+
+	// Moves the window to the delivered frame and keeps it.
+	void SetCursor(const int frame, const Frame_t& data)
+	{
+		if (m_Radius <= 0) {
+			return;
+		}
+
+		MoveCursor(frame);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_Frames.insert_or_assign(frame, data);
+	}
+
+	// Returns the frame if it is in the window. A frame the thread is still rendering is not
+	// waited for, the wait could not be cancelled. The caller requests it in its own way.
+	bool Get(const int frame, Frame_t& out)
+	{
+		if (m_Radius <= 0) {
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_Frames.find(frame);
+		if (it == m_Frames.end()) {
+			return false;
+		}
+		out = it->second;
+		return true;
+	}
+};
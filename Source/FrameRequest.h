@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//
+// CFrameRequest
+//
+// Renders the frame for the delivery thread so that a flush does not have to wait for it.
+// The frame is rendered by an asynchronous script API or by a thread of the request, the
+// delivery thread only waits for the result. Cancel releases the waiting delivery thread,
+// the render goes on and its late result is dropped, unless the same frame is requested next.
+// Frame_t holds a reference to a script frame and must be cheap to copy.
+
+template <typename Frame_t>
+class CFrameRequest
+{
+public:
+	// Passes the result of a render, may be called on any thread.
+	typedef std::function<void(const bool ok, Frame_t data)> CompleteFn;
+	// Starts the render of the frame, complete is called when it is done.
+	typedef std::function<void(const int frame, CompleteFn complete)> RequestFn;
+	// Renders the frame. Returns false if the frame could not be rendered.
+	typedef std::function<bool(const int frame, Frame_t& out)> GetFrameFn;
+
+private:
+	struct Request_t {
+		int  frame = -1;
+		bool bDone = false;
+		bool bOk   = false;
+		Frame_t data = {};
+	};
+	typedef std::shared_ptr<Request_t> RequestPtr;
+
+	std::mutex              m_mutex;
+	std::condition_variable m_cv;
+	RequestPtr m_pCurrent; // the last request, the results of older ones are dropped
+	RequestPtr m_pQueued;  // the next frame for the thread
+	int  m_InFlight = 0;   // renders that have not completed
+	bool m_bCancel  = false;
+	bool m_bStop    = false;
+
+	RequestFn   m_Request;
+	GetFrameFn  m_GetFrame;
+	std::thread m_Thread;
+
+	void Complete(const RequestPtr& pRequest, const bool ok, Frame_t data)
+	{
+		// notified under the lock, Stop may destroy the object as soon as m_InFlight is zero
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_InFlight--;
+		if (pRequest == m_pCurrent) {
+			pRequest->bDone = true;
+			pRequest->bOk   = ok;
+			pRequest->data  = std::move(data);
+		}
+		m_cv.notify_all();
+	}
+
+	void ThreadProc()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		for (;;) {
+			m_cv.wait(lock, [this] {
+				return m_bStop || m_pQueued;
+			});
+			if (m_bStop) {
+				break;
+			}
+
+			RequestPtr pRequest = std::move(m_pQueued);
+			m_InFlight++;
+			lock.unlock();
+
+			Frame_t data;
+			const bool ok = m_GetFrame(pRequest->frame, data);
+			Complete(pRequest, ok, std::move(data));
+
+			lock.lock();
+		}
+	}
+
+public:
+	~CFrameRequest()
+	{
+		Stop();
+	}
+
+	// The frames are rendered by a thread of the request.
+	void Start(GetFrameFn getFrame)
+	{
+		Stop();
+
+		m_GetFrame = std::move(getFrame);
+		m_bCancel  = false;
+		m_bStop    = false;
+		m_Thread   = std::thread(&CFrameRequest::ThreadProc, this);
+	}
+
+	// The frames are rendered by the asynchronous API of the script.
+	void StartAsync(RequestFn request)
+	{
+		Stop();
+
+		m_Request = std::move(request);
+		m_bCancel = false;
+		m_bStop   = false;
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+			m_pQueued.reset();
+		}
+		m_cv.notify_all();
+
+		if (m_Thread.joinable()) {
+			m_Thread.join();
+		}
+
+		// the completions must not come after the object is gone
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this] {
+			return m_InFlight == 0;
+		});
+		m_pCurrent.reset();
+	}
+
+	// Returns S_OK with the frame, E_FAIL if the render failed or E_ABORT if the request is cancelled.
+	HRESULT Get(const int frame, Frame_t& out)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_bCancel) {
+			return E_ABORT;
+		}
+
+		RequestPtr pRequest = m_pCurrent;
+		if (!pRequest || pRequest->frame != frame) {
+			pRequest = std::make_shared<Request_t>();
+			pRequest->frame = frame;
+			m_pCurrent = pRequest;
+
+			if (m_Thread.joinable()) {
+				m_pQueued = pRequest;
+				m_cv.notify_all();
+			}
+			else {
+				m_InFlight++;
+				lock.unlock();
+				m_Request(frame, [this, pRequest](const bool ok, Frame_t data) {
+					Complete(pRequest, ok, std::move(data));
+				});
+				lock.lock();
+			}
+		}
+
+		m_cv.wait(lock, [this, &pRequest] {
+			return m_bCancel || pRequest->bDone;
+		});
+		if (!pRequest->bDone) {
+			return E_ABORT;
+		}
+
+		m_pCurrent.reset();
+		if (!pRequest->bOk) {
+			return E_FAIL;
+		}
+		out = std::move(pRequest->data);
+		return S_OK;
+	}
+
+	// Releases the waiting delivery thread, Get fails until Reset. The render goes on.
+	void Cancel()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bCancel = true;
+		m_cv.notify_all();
+	}
+
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bCancel = false;
+	}
+};
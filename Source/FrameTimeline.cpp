@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "FrameTimeline.h"
+
+//
+// CFrameTimeline
+//
+
+CFrameTimeline::~CFrameTimeline()
+{
+	StopIndex();
+}
+
+void CFrameTimeline::Init(const int numFrames, const int64_t fpsNum, const int64_t fpsDen)
+{
+	StopIndex();
+
+	CAutoLock lock(&m_csRuns);
+
+	m_NumFrames     = numFrames;
+	m_IndexedFrames = numFrames;
+	m_bVariable     = false;
+	m_NominalNum    = fpsDen;
+	m_NominalDen    = fpsNum;
+	m_SegmentFrame  = -1;
+	m_Runs.clear();
+}
+
+void CFrameTimeline::InitVariable(const int numFrames, const int64_t fpsNum, const int64_t fpsDen, ReadDurationFn readDuration)
+{
+	StopIndex();
+
+	{
+		CAutoLock lock(&m_csRuns);
+
+		m_NumFrames     = numFrames;
+		m_IndexedFrames = 0;
+		m_bVariable     = true;
+		m_NominalNum    = fpsDen;
+		m_NominalDen    = fpsNum;
+		m_SegmentFrame  = -1;
+		m_Runs.clear();
+	}
+
+	m_bStopIndex = false;
+	m_IndexThread = std::thread(&CFrameTimeline::IndexThreadProc, this, std::move(readDuration));
+}
+
+void CFrameTimeline::StopIndex()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutexIndex);
+		m_bStopIndex = true;
+	}
+	m_cvIndex.notify_all();
+
+	if (m_IndexThread.joinable()) {
+		m_IndexThread.join();
+	}
+}
+
+void CFrameTimeline::IndexThreadProc(ReadDurationFn readDuration)
+{
+	// the index must not take time away from playback, WaitIndex raises the priority
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+	const ULONGLONG startTick = GetTickCount64();
+
+	while (!m_bStopIndex) {
+		int frame;
+		{
+			CAutoLock lock(&m_csRuns);
+			frame = m_IndexedFrames; // may have been advanced by playback
+			if (frame >= m_NumFrames) {
+				DLog(L"CFrameTimeline: {} frames indexed in {} ms, {} runs", m_NumFrames, GetTickCount64() - startTick, m_Runs.size());
+				break;
+			}
+		}
+
+		int64_t num = 0;
+		int64_t den = 0;
+		readDuration(frame, num, den);
+		AddFrameDuration(frame, num, den);
+	}
+
+	{
+		// the waiters must not wait for an index that no longer grows
+		std::lock_guard<std::mutex> lock(m_mutexIndex);
+		m_bStopIndex = true;
+	}
+	m_cvIndex.notify_all();
+}
+
+template <typename Pred>
+void CFrameTimeline::WaitIndex(Pred isReady)
+{
+	if (!m_bVariable) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutexIndex);
+	if (m_bStopIndex || isReady()) {
+		return;
+	}
+
+	if (m_Waiters++ == 0) {
+		SetThreadPriority(m_IndexThread.native_handle(), THREAD_PRIORITY_NORMAL);
+	}
+	m_cvIndex.wait(lock, [&] { return m_bStopIndex || isReady(); });
+	if (--m_Waiters == 0 && !m_bStopIndex) {
+		SetThreadPriority(m_IndexThread.native_handle(), THREAD_PRIORITY_BELOW_NORMAL);
+	}
+}
+
+void CFrameTimeline::WaitIndexedFrame(const int frame)
+{
+	WaitIndex([&] {
+		CAutoLock lock(&m_csRuns);
+		return frame <= m_IndexedFrames;
+	});
+}
+
+void CFrameTimeline::WaitIndexedTime(const REFERENCE_TIME rt)
+{
+	WaitIndex([&] {
+		CAutoLock lock(&m_csRuns);
+		return m_IndexedFrames >= m_NumFrames || GetIndexedEndTime() > rt;
+	});
+}
+
+REFERENCE_TIME CFrameTimeline::GetIndexedEndTime() const
+{
+	if (m_Runs.empty()) {
+		return 0;
+	}
+	const auto& run = m_Runs.back();
+	return run.time + llMulDiv(UNITS * (m_IndexedFrames - run.frame), run.num, run.den, 0);
+}
+
+bool CFrameTimeline::IsIndexed(const int frame) const
+{
+	if (!m_bVariable) {
+		return true;
+	}
+
+	CAutoLock lock(&m_csRuns);
+	return frame < m_IndexedFrames;
+}
+
+void CFrameTimeline::AddFrameDuration(const int frame, int64_t num, int64_t den)
+{
+	if (!m_bVariable) {
+		return;
+	}
+
+	if (num > 0 && den > 0) {
+		const int64_t gcd = std::gcd(num, den);
+		num /= gcd;
+		den /= gcd;
+	} else {
+		num = m_NominalNum;
+		den = m_NominalDen;
+	}
+
+	{
+		CAutoLock lock(&m_csRuns);
+
+		if (frame != m_IndexedFrames || frame >= m_NumFrames) {
+			return; // already indexed or out of order
+		}
+
+		if (m_Runs.empty() || m_Runs.back().num != num || m_Runs.back().den != den) {
+			m_Runs.emplace_back(Run_t{ frame, GetIndexedEndTime(), num, den });
+		}
+		m_IndexedFrames++;
+	}
+
+	// the waiters check the index while they hold m_mutexIndex, so no progress is missed
+	std::lock_guard<std::mutex> lock(m_mutexIndex);
+	if (m_Waiters) {
+		m_cvIndex.notify_all();
+	}
+}
+
+REFERENCE_TIME CFrameTimeline::GetFrameTime(const int frame) const
+{
+	if (!m_bVariable) {
+		return llMulDiv(UNITS * frame, m_NominalNum, m_NominalDen, 0);
+	}
+
+	CAutoLock lock(&m_csRuns);
+
+	if (frame >= m_IndexedFrames) {
+		return GetIndexedEndTime() + llMulDiv(UNITS * (frame - m_IndexedFrames), m_NominalNum, m_NominalDen, 0);
+	}
+
+	auto it = std::upper_bound(m_Runs.cbegin(), m_Runs.cend(), frame, [](const int f, const Run_t& run) {
+		return f < run.frame;
+	});
+	if (it == m_Runs.cbegin()) {
+		return 0;
+	}
+	--it;
+
+	return it->time + llMulDiv(UNITS * (frame - it->frame), it->num, it->den, 0);
+}
+
+REFERENCE_TIME CFrameTimeline::GetSegmentTime(const uint64_t segment, const int firstFrame)
+{
+	if (!m_bVariable) {
+		return GetFrameTime(firstFrame);
+	}
+
+	{
+		CAutoLock lock(&m_csRuns);
+		if (m_SegmentId == segment && m_SegmentFrame == firstFrame) {
+			return m_SegmentTime;
+		}
+	}
+
+	const REFERENCE_TIME rt = GetFrameTime(firstFrame);
+
+	CAutoLock lock(&m_csRuns);
+	m_SegmentId    = segment;
+	m_SegmentFrame = firstFrame;
+	m_SegmentTime  = rt;
+
+	return rt;
+}
+
+int CFrameTimeline::GetFrameNumber(const REFERENCE_TIME rt) const
+{
+	if (!m_bVariable) {
+		return (int)llMulDiv(rt, m_NominalDen, m_NominalNum * UNITS, 0); // round down
+	}
+
+	CAutoLock lock(&m_csRuns);
+
+	const REFERENCE_TIME rtEnd = GetIndexedEndTime();
+	if (rt >= rtEnd) {
+		int64_t count = llMulDiv(rt - rtEnd, m_NominalDen, m_NominalNum * UNITS, 0);
+		if (llMulDiv(UNITS * (count + 1), m_NominalNum, m_NominalDen, 0) <= rt - rtEnd) {
+			count++;
+		}
+		return m_IndexedFrames + (int)count;
+	}
+
+	auto it = std::upper_bound(m_Runs.cbegin(), m_Runs.cend(), rt, [](const REFERENCE_TIME t, const Run_t& run) {
+		return t < run.time;
+	});
+	if (it == m_Runs.cbegin()) {
+		return 0;
+	}
+	const int nextFrame = (it == m_Runs.cend()) ? m_IndexedFrames : it->frame;
+	--it;
+
+	// the frame times are rounded down, so the next frame may already start at rt
+	int frame = it->frame + (int)llMulDiv(rt - it->time, it->den, it->num * UNITS, 0);
+	if (it->time + llMulDiv(UNITS * (frame + 1 - it->frame), it->num, it->den, 0) <= rt) {
+		frame++;
+	}
+
+	return std::min(frame, nextFrame - 1);
+}
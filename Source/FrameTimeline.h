@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//
+// CFrameTimeline
+//
+// Maps frame numbers to timestamps and back. Constant frame rate clips use a closed form.
+// For variable frame rate clips the frame durations are read in order by a background thread,
+// and delivered frames that are next in order are taken as well. The durations are collected
+// into runs of equal duration, so both mappings are a binary search over the runs. Frames that
+// are not indexed yet are extrapolated with the nominal frame rate, a seek waits for the index
+// to reach its target.
+
+class CFrameTimeline
+{
+public:
+	// Reads the duration of the frame in seconds as a fraction. Returns false if the frame has no duration.
+	typedef std::function<bool(const int frame, int64_t& num, int64_t& den)> ReadDurationFn;
+
+private:
+	struct Run_t {
+		int            frame; // first frame of the run
+		REFERENCE_TIME time;  // start time of the first frame
+		int64_t        num;   // frame duration in seconds
+		int64_t        den;
+	};
+
+	mutable CCritSec   m_csRuns;
+	std::vector<Run_t> m_Runs;
+
+	int  m_NumFrames     = 0;
+	int  m_IndexedFrames = 0; // the durations of frames [0, m_IndexedFrames) are known
+	bool m_bVariable     = false;
+
+	// nominal frame duration in seconds
+	int64_t m_NominalNum = 1;
+	int64_t m_NominalDen = 1;
+
+	// start time of the first frame of the current segment
+	uint64_t       m_SegmentId    = 0;
+	int            m_SegmentFrame = -1;
+	REFERENCE_TIME m_SegmentTime  = 0;
+
+	std::thread       m_IndexThread;
+	std::atomic<bool> m_bStopIndex = false;
+	std::mutex              m_mutexIndex; // signals the progress of the index
+	std::condition_variable m_cvIndex;
+	int m_Waiters = 0; // requires m_mutexIndex
+
+	REFERENCE_TIME GetIndexedEndTime() const; // requires m_csRuns
+	void IndexThreadProc(ReadDurationFn readDuration);
+	template <typename Pred>
+	void WaitIndex(Pred isReady);
+
+public:
+	~CFrameTimeline();
+
+	void Init(const int numFrames, const int64_t fpsNum, const int64_t fpsDen);
+	// Starts the index thread. readDuration is called from that thread, it must not block delivery
+	// for longer than one frame.
+	void InitVariable(const int numFrames, const int64_t fpsNum, const int64_t fpsDen, ReadDurationFn readDuration);
+	void StopIndex();
+
+	bool IsVariable() const { return m_bVariable; }
+	bool IsIndexed(const int frame) const;
+	void AddFrameDuration(const int frame, int64_t num, int64_t den);
+	// Wait until the start time of the frame or the frame at the time is exact.
+	// The index thread runs at normal priority while someone waits.
+	void WaitIndexedFrame(const int frame);
+	void WaitIndexedTime(const REFERENCE_TIME rt);
+
+	REFERENCE_TIME GetFrameTime(const int frame) const;
+	// Returns the time of the first frame of the segment. The time is taken once per segment,
+	// so the sample times of a segment do not move when the index grows past its first frame.
+	REFERENCE_TIME GetSegmentTime(const uint64_t segment, const int firstFrame);
+	// Returns the frame shown at the time (round down).
+	int GetFrameNumber(const REFERENCE_TIME rt) const;
+	REFERENCE_TIME GetDuration() const { return GetFrameTime(m_NumFrames); }
+};
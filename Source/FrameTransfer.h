@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <emmintrin.h>
+
+// Frame transfer kernels.
+// Source planes are always passed in Y,U,V,A or G,B,R,A order, the kernels reorder them for the output format.
+
+template <bool Flip>
+inline UINT CopyPlane(BYTE* dst, const UINT dst_pitch, const BYTE* src, int src_pitch, const UINT height)
+{
+	if constexpr (Flip) {
+		src += src_pitch * (int)(height - 1);
+		src_pitch = -src_pitch;
+	}
+
+	if (src_pitch == (int)dst_pitch) {
+		memcpy(dst, src, dst_pitch * height);
+	}
+	else {
+		const UINT linesize = std::min((UINT)abs(src_pitch), dst_pitch);
+		for (UINT y = 0; y < height; y++) {
+			memcpy(dst, src, linesize);
+			src += src_pitch;
+			dst += dst_pitch;
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+template <int Planes, int SubW, int SubH, bool SwapUV, bool Flip>
+UINT CopyFrame(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	static_assert(Planes >= 0 && Planes <= 4);
+	static_assert(!Flip || Planes == 1);
+
+	UINT dataLength = 0;
+
+	for (int i = 0; i < Planes; i++) {
+		const bool chroma = (i == 1 || i == 2);
+		const int s = (SwapUV && chroma) ? 3 - i : i;
+		const UINT plane_pitch  = chroma ? (dst_pitch >> SubW) : dst_pitch;
+		const UINT plane_height = chroma ? (height >> SubH) : height;
+
+		const UINT size = CopyPlane<Flip>(dst, plane_pitch, src[s], src_pitch[s], plane_height);
+		dst += size;
+		dataLength += size;
+	}
+
+	return dataLength;
+}
+
+// Left shift of 16-bit samples, used to move 10-14 bit data to the high bits for P010/P016.
+template <int Shift>
+inline void ShiftRow16(uint16_t* dst, const uint16_t* src, const UINT count)
+{
+	UINT i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_slli_epi16(x, Shift));
+	}
+	for (; i < count; i++) {
+		dst[i] = (uint16_t)(src[i] << Shift);
+	}
+}
+
+// Interleaves U and V samples into one UV row, with the same shift as ShiftRow16 for 16-bit samples.
+template <typename T, int Shift>
+inline void InterleaveRow(T* dst, const T* srcU, const T* srcV, const UINT count)
+{
+	static_assert(sizeof(T) == 1 || sizeof(T) == 2);
+	static_assert(sizeof(T) == 2 || Shift == 0);
+
+	constexpr UINT step = 16 / sizeof(T);
+	UINT i = 0;
+	for (; i + step <= count; i += step) {
+		__m128i u = _mm_loadu_si128((const __m128i*)(srcU + i));
+		__m128i v = _mm_loadu_si128((const __m128i*)(srcV + i));
+		if constexpr (sizeof(T) == 1) {
+			_mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi8(u, v));
+			_mm_storeu_si128((__m128i*)(dst + i * 2 + step), _mm_unpackhi_epi8(u, v));
+		} else {
+			if constexpr (Shift > 0) {
+				u = _mm_slli_epi16(u, Shift);
+				v = _mm_slli_epi16(v, Shift);
+			}
+			_mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi16(u, v));
+			_mm_storeu_si128((__m128i*)(dst + i * 2 + step), _mm_unpackhi_epi16(u, v));
+		}
+	}
+	for (; i < count; i++) {
+		dst[i * 2]     = (T)(srcU[i] << Shift);
+		dst[i * 2 + 1] = (T)(srcV[i] << Shift);
+	}
+}
+
+// Planar 4:2:0 or 4:2:2 to NV12 (T = uint8_t), P010/P016 or P210/P216 (T = uint16_t).
+template <typename T, int Shift, int SubH>
+UINT CopyFrameToSemiPlanar(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	if constexpr (Shift == 0) {
+		CopyPlane<false>(dst, dst_pitch, src[0], src_pitch[0], height);
+	} else {
+		const BYTE* src_y = src[0];
+		BYTE* dst_y = dst;
+		for (UINT y = 0; y < height; y++) {
+			ShiftRow16<Shift>((uint16_t*)dst_y, (const uint16_t*)src_y, width);
+			src_y += src_pitch[0];
+			dst_y += dst_pitch;
+		}
+	}
+
+	const UINT chroma_height = height >> SubH;
+	const BYTE* src_u = src[1];
+	const BYTE* src_v = src[2];
+	BYTE* dst_uv = dst + dst_pitch * height;
+	for (UINT y = 0; y < chroma_height; y++) {
+		InterleaveRow<T, Shift>((T*)dst_uv, (const T*)src_u, (const T*)src_v, width / 2);
+		src_u += src_pitch[1];
+		src_v += src_pitch[2];
+		dst_uv += dst_pitch;
+	}
+
+	return dst_pitch * (height + chroma_height);
+}
+
+// Planar 4:2:2 10-bit to v210. Six pixels are packed into four 32-bit words.
+// SSE2 has no byte shuffle, and the 6-pixel groups do not fit 128-bit lanes, so this one is scalar.
+inline UINT CopyFrameToV210(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	auto pack = [](uint32_t* d, const uint16_t* y, const uint16_t* u, const uint16_t* v) {
+		d[0] = (u[0] & 0x3FF) | ((y[0] & 0x3FF) << 10) | ((v[0] & 0x3FF) << 20);
+		d[1] = (y[1] & 0x3FF) | ((u[1] & 0x3FF) << 10) | ((y[2] & 0x3FF) << 20);
+		d[2] = (v[1] & 0x3FF) | ((y[3] & 0x3FF) << 10) | ((u[2] & 0x3FF) << 20);
+		d[3] = (y[4] & 0x3FF) | ((v[2] & 0x3FF) << 10) | ((y[5] & 0x3FF) << 20);
+	};
+
+	for (UINT y = 0; y < height; y++) {
+		const uint16_t* src_y = (const uint16_t*)(src[0] + src_pitch[0] * (int)y);
+		const uint16_t* src_u = (const uint16_t*)(src[1] + src_pitch[1] * (int)y);
+		const uint16_t* src_v = (const uint16_t*)(src[2] + src_pitch[2] * (int)y);
+		uint32_t* d = (uint32_t*)(dst + dst_pitch * y);
+
+		UINT x = 0;
+		for (; x + 6 <= width; x += 6) {
+			pack(d, src_y + x, src_u + x / 2, src_v + x / 2);
+			d += 4;
+		}
+		if (x < width) {
+			// incomplete last group, padded with the last pixel
+			uint16_t ty[6], tu[3], tv[3];
+			for (UINT i = 0; i < 6; i++) {
+				ty[i] = src_y[std::min(x + i, width - 1)];
+			}
+			for (UINT i = 0; i < 3; i++) {
+				tu[i] = src_u[std::min((x / 2) + i, (width - 1) / 2)];
+				tv[i] = src_v[std::min((x / 2) + i, (width - 1) / 2)];
+			}
+			pack(d, ty, tu, tv);
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+// Planar 4:4:4 10-bit to Y410, the alpha bits are set to opaque.
+inline UINT CopyFrameToY410(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	const __m128i zero  = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32((int)0xC0000000);
+
+	for (UINT y = 0; y < height; y++) {
+		const uint16_t* src_y = (const uint16_t*)(src[0] + src_pitch[0] * (int)y);
+		const uint16_t* src_u = (const uint16_t*)(src[1] + src_pitch[1] * (int)y);
+		const uint16_t* src_v = (const uint16_t*)(src[2] + src_pitch[2] * (int)y);
+		uint32_t* d = (uint32_t*)(dst + dst_pitch * y);
+
+		UINT x = 0;
+		for (; x + 8 <= width; x += 8) {
+			const __m128i vy = _mm_loadu_si128((const __m128i*)(src_y + x));
+			const __m128i vu = _mm_loadu_si128((const __m128i*)(src_u + x));
+			const __m128i vv = _mm_loadu_si128((const __m128i*)(src_v + x));
+
+			__m128i lo = _mm_or_si128(_mm_unpacklo_epi16(vu, zero), _mm_slli_epi32(_mm_unpacklo_epi16(vy, zero), 10));
+			lo = _mm_or_si128(_mm_or_si128(lo, _mm_slli_epi32(_mm_unpacklo_epi16(vv, zero), 20)), alpha);
+			__m128i hi = _mm_or_si128(_mm_unpackhi_epi16(vu, zero), _mm_slli_epi32(_mm_unpackhi_epi16(vy, zero), 10));
+			hi = _mm_or_si128(_mm_or_si128(hi, _mm_slli_epi32(_mm_unpackhi_epi16(vv, zero), 20)), alpha);
+
+			_mm_storeu_si128((__m128i*)(d + x), lo);
+			_mm_storeu_si128((__m128i*)(d + x + 4), hi);
+		}
+		for (; x < width; x++) {
+			d[x] = src_u[x] | (src_y[x] << 10) | (src_v[x] << 20) | 0xC0000000;
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+// Planar 4:4:4 10-16 bit to Y416, the alpha is set to opaque.
+template <int Shift>
+UINT CopyFrameToY416(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	const __m128i alpha = _mm_set1_epi16(-1);
+
+	for (UINT y = 0; y < height; y++) {
+		const uint16_t* src_y = (const uint16_t*)(src[0] + src_pitch[0] * (int)y);
+		const uint16_t* src_u = (const uint16_t*)(src[1] + src_pitch[1] * (int)y);
+		const uint16_t* src_v = (const uint16_t*)(src[2] + src_pitch[2] * (int)y);
+		uint16_t* d = (uint16_t*)(dst + dst_pitch * y);
+
+		UINT x = 0;
+		for (; x + 8 <= width; x += 8) {
+			const __m128i vy = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_y + x)), Shift);
+			const __m128i vu = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_u + x)), Shift);
+			const __m128i vv = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_v + x)), Shift);
+
+			const __m128i uy_lo = _mm_unpacklo_epi16(vu, vy);
+			const __m128i uy_hi = _mm_unpackhi_epi16(vu, vy);
+			const __m128i va_lo = _mm_unpacklo_epi16(vv, alpha);
+			const __m128i va_hi = _mm_unpackhi_epi16(vv, alpha);
+
+			__m128i* out = (__m128i*)(d + x * 4);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi32(uy_lo, va_lo));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi32(uy_lo, va_lo));
+			_mm_storeu_si128(out + 2, _mm_unpacklo_epi32(uy_hi, va_hi));
+			_mm_storeu_si128(out + 3, _mm_unpackhi_epi32(uy_hi, va_hi));
+		}
+		for (; x < width; x++) {
+			d[x * 4 + 0] = (uint16_t)(src_u[x] << Shift);
+			d[x * 4 + 1] = (uint16_t)(src_y[x] << Shift);
+			d[x * 4 + 2] = (uint16_t)(src_v[x] << Shift);
+			d[x * 4 + 3] = 0xFFFF;
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+// Planar RGB 8-bit to RGB32/ARGB32. Without an alpha plane the alpha bytes are set to 0xFF.
+template <bool Alpha>
+UINT CopyFrameToRGB32(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	for (UINT y = 0; y < height; y++) {
+		const BYTE* src_g = src[0] + src_pitch[0] * (int)y;
+		const BYTE* src_b = src[1] + src_pitch[1] * (int)y;
+		const BYTE* src_r = src[2] + src_pitch[2] * (int)y;
+		const BYTE* src_a = Alpha ? src[3] + src_pitch[3] * (int)y : nullptr;
+		BYTE* d = dst + dst_pitch * y;
+
+		UINT x = 0;
+		for (; x + 16 <= width; x += 16) {
+			const __m128i vg = _mm_loadu_si128((const __m128i*)(src_g + x));
+			const __m128i vb = _mm_loadu_si128((const __m128i*)(src_b + x));
+			const __m128i vr = _mm_loadu_si128((const __m128i*)(src_r + x));
+			const __m128i va = Alpha ? _mm_loadu_si128((const __m128i*)(src_a + x)) : _mm_set1_epi8(-1);
+
+			const __m128i bg_lo = _mm_unpacklo_epi8(vb, vg);
+			const __m128i bg_hi = _mm_unpackhi_epi8(vb, vg);
+			const __m128i ra_lo = _mm_unpacklo_epi8(vr, va);
+			const __m128i ra_hi = _mm_unpackhi_epi8(vr, va);
+
+			__m128i* out = (__m128i*)(d + x * 4);
+			_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(bg_lo, ra_lo));
+			_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+			_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+			_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+		}
+		for (; x < width; x++) {
+			d[x * 4 + 0] = src_b[x];
+			d[x * 4 + 1] = src_g[x];
+			d[x * 4 + 2] = src_r[x];
+			d[x * 4 + 3] = Alpha ? src_a[x] : 0xFF;
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+// Interleaves 8 pixels of 16-bit B,G,R,A into four registers of two BGRA64 pixels each.
+inline void InterleaveBGRA64(__m128i out[4], const __m128i vb, const __m128i vg, const __m128i vr, const __m128i va)
+{
+	const __m128i bg_lo = _mm_unpacklo_epi16(vb, vg);
+	const __m128i bg_hi = _mm_unpackhi_epi16(vb, vg);
+	const __m128i ra_lo = _mm_unpacklo_epi16(vr, va);
+	const __m128i ra_hi = _mm_unpackhi_epi16(vr, va);
+
+	out[0] = _mm_unpacklo_epi32(bg_lo, ra_lo);
+	out[1] = _mm_unpackhi_epi32(bg_lo, ra_lo);
+	out[2] = _mm_unpacklo_epi32(bg_hi, ra_hi);
+	out[3] = _mm_unpackhi_epi32(bg_hi, ra_hi);
+}
+
+// Planar RGB 10-16 bit to BGRA64. Without an alpha plane the alpha is set to 0xFFFF.
+template <int Shift, bool Alpha>
+UINT CopyFrameToBGRA64(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	for (UINT y = 0; y < height; y++) {
+		const uint16_t* src_g = (const uint16_t*)(src[0] + src_pitch[0] * (int)y);
+		const uint16_t* src_b = (const uint16_t*)(src[1] + src_pitch[1] * (int)y);
+		const uint16_t* src_r = (const uint16_t*)(src[2] + src_pitch[2] * (int)y);
+		const uint16_t* src_a = Alpha ? (const uint16_t*)(src[3] + src_pitch[3] * (int)y) : nullptr;
+		uint16_t* d = (uint16_t*)(dst + dst_pitch * y);
+
+		UINT x = 0;
+		for (; x + 8 <= width; x += 8) {
+			const __m128i vg = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_g + x)), Shift);
+			const __m128i vb = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_b + x)), Shift);
+			const __m128i vr = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_r + x)), Shift);
+			const __m128i va = Alpha ? _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_a + x)), Shift) : _mm_set1_epi16(-1);
+
+			__m128i px[4];
+			InterleaveBGRA64(px, vb, vg, vr, va);
+
+			__m128i* out = (__m128i*)(d + x * 4);
+			for (int i = 0; i < 4; i++) {
+				_mm_storeu_si128(out + i, px[i]);
+			}
+		}
+		for (; x < width; x++) {
+			d[x * 4 + 0] = (uint16_t)(src_b[x] << Shift);
+			d[x * 4 + 1] = (uint16_t)(src_g[x] << Shift);
+			d[x * 4 + 2] = (uint16_t)(src_r[x] << Shift);
+			d[x * 4 + 3] = Alpha ? (uint16_t)(src_a[x] << Shift) : 0xFFFF;
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+// Planar RGB 10-16 bit to BGR48.
+template <int Shift>
+UINT CopyFrameToBGR48(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	const __m128i mask_lo = _mm_set_epi32(0, 0, 0x0000FFFF, -1); // bytes 0-5
+	const __m128i mask_hi = _mm_set_epi32(0, -1, (int)0xFFFF0000, 0); // bytes 6-11
+
+	for (UINT y = 0; y < height; y++) {
+		const uint16_t* src_g = (const uint16_t*)(src[0] + src_pitch[0] * (int)y);
+		const uint16_t* src_b = (const uint16_t*)(src[1] + src_pitch[1] * (int)y);
+		const uint16_t* src_r = (const uint16_t*)(src[2] + src_pitch[2] * (int)y);
+		uint16_t* d = (uint16_t*)(dst + dst_pitch * y);
+
+		UINT x = 0;
+		// each store writes 4 bytes past its two pixels, so at least one pixel must be left for the next store or the tail
+		for (; x + 8 < width; x += 8) {
+			const __m128i vg = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_g + x)), Shift);
+			const __m128i vb = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_b + x)), Shift);
+			const __m128i vr = _mm_slli_epi16(_mm_loadu_si128((const __m128i*)(src_r + x)), Shift);
+
+			__m128i px[4];
+			InterleaveBGRA64(px, vb, vg, vr, _mm_setzero_si128());
+
+			BYTE* out = (BYTE*)(d + x * 3);
+			for (int i = 0; i < 4; i++) {
+				// B0 G0 R0 A0 B1 G1 R1 A1 -> B0 G0 R0 B1 G1 R1
+				const __m128i bgr = _mm_or_si128(_mm_and_si128(px[i], mask_lo), _mm_and_si128(_mm_srli_si128(px[i], 2), mask_hi));
+				_mm_storeu_si128((__m128i*)(out + i * 12), bgr);
+			}
+		}
+		for (; x < width; x++) {
+			d[x * 3 + 0] = (uint16_t)(src_b[x] << Shift);
+			d[x * 3 + 1] = (uint16_t)(src_g[x] << Shift);
+			d[x * 3 + 2] = (uint16_t)(src_r[x] << Shift);
+		}
+	}
+
+	return dst_pitch * height;
+}
+
+//
+// Bit depth reduction with dithering
+//
+
+// 8x8 Bayer matrix, values 0..63
+inline constexpr uint8_t s_Bayer8x8[8][8] = {
+	{  0, 32,  8, 40,  2, 34, 10, 42 },
+	{ 48, 16, 56, 24, 50, 18, 58, 26 },
+	{ 12, 44,  4, 36, 14, 46,  6, 38 },
+	{ 60, 28, 52, 20, 62, 30, 54, 22 },
+	{  3, 35, 11, 43,  1, 33,  9, 41 },
+	{ 51, 19, 59, 27, 49, 17, 57, 25 },
+	{ 15, 47,  7, 39, 13, 45,  5, 37 },
+	{ 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// Scratch memory of the dithering kernels, sized on the first frame and then reused by the
+// streaming thread. A kernel takes one block and splits it, the kernels do not nest.
+inline BYTE* GetDitherScratch(const size_t size)
+{
+	thread_local std::vector<BYTE> scratch;
+	if (scratch.size() < size) {
+		scratch.resize(size);
+	}
+	return scratch.data();
+}
+
+// the size rounded up, so that the parts of a scratch block stay 16-byte aligned
+inline constexpr size_t AlignScratch(const size_t size)
+{
+	return (size + 15) & ~(size_t)15;
+}
+
+// Reduces rows of one plane from SrcBits (32 for float) to DstBits.
+// Ordered dither adds the Bayer threshold before the shift. Error diffusion uses the Sierra Lite
+// kernel (2/4 right, 1/4 down-left, 1/4 down) and keeps the error of the next row between calls.
+template <bool ErrorDiffusion, int SrcBits, int DstBits>
+class CPlaneDither
+{
+	static constexpr int Shift  = (SrcBits == 32 ? 16 : SrcBits) - DstBits;
+	static constexpr int DstMax = (1 << DstBits) - 1;
+	static_assert(Shift > 0 && DstBits <= 10);
+
+	const UINT m_Width;
+	UINT m_Y = 0;
+	int* m_Err;      // error for the current and the next row, width + 2 each
+	uint16_t* m_Row; // float samples converted to 16-bit
+
+	static constexpr size_t ErrSize(const UINT width)
+	{
+		return ErrorDiffusion ? AlignScratch((width + 2) * 2 * sizeof(int)) : 0;
+	}
+
+	const uint16_t* LoadRow(const BYTE* src)
+	{
+		if constexpr (SrcBits == 32) {
+			const float* s = (const float*)src;
+			for (UINT x = 0; x < m_Width; x++) {
+				m_Row[x] = (uint16_t)std::clamp(s[x] * 65535.0f + 0.5f, 0.0f, 65535.0f);
+			}
+			return m_Row;
+		} else {
+			return (const uint16_t*)src;
+		}
+	}
+
+public:
+	// the bytes of scratch memory for a plane of the width
+	static constexpr size_t ScratchSize(const UINT width)
+	{
+		return ErrSize(width) + (SrcBits == 32 ? AlignScratch(width * sizeof(uint16_t)) : 0);
+	}
+
+	CPlaneDither(const UINT width, BYTE* scratch)
+		: m_Width(width)
+		, m_Err((int*)scratch)
+		, m_Row((uint16_t*)(scratch + ErrSize(width)))
+	{
+		if constexpr (ErrorDiffusion) {
+			// the next row is cleared by Row
+			std::fill(m_Err, m_Err + width + 2, 0);
+		}
+	}
+
+	template <typename TDst>
+	void Row(TDst* dst, const BYTE* src_row)
+	{
+		static_assert(sizeof(TDst) == 1 || DstBits > 8);
+		const uint16_t* src = LoadRow(src_row);
+
+		if constexpr (ErrorDiffusion) {
+			// the error of pixel x is stored at x + 1
+			const int* err = m_Err + (m_Y & 1) * (m_Width + 2);
+			int* errNext   = m_Err + (~m_Y & 1) * (m_Width + 2);
+			std::fill(errNext, errNext + m_Width + 2, 0);
+
+			int right = 0;
+			for (UINT x = 0; x < m_Width; x++) {
+				const int value = src[x] + err[x + 1] + right;
+				const int q = std::clamp((value + (1 << (Shift - 1))) >> Shift, 0, DstMax);
+				dst[x] = (TDst)q;
+
+				const int e = value - (q << Shift);
+				right = e / 2;
+				errNext[x] += e / 4;
+				errNext[x + 1] += e - e / 2 - e / 4;
+			}
+		}
+		else {
+			alignas(16) uint16_t bias[8];
+			for (int i = 0; i < 8; i++) {
+				bias[i] = (uint16_t)((s_Bayer8x8[m_Y & 7][i] << Shift) >> 6);
+			}
+
+			const __m128i vbias = _mm_load_si128((const __m128i*)bias);
+			const __m128i vmax  = _mm_set1_epi16(DstMax);
+			UINT x = 0;
+			for (; x + 8 <= m_Width; x += 8) {
+				__m128i v = _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(src + x)), vbias);
+				v = _mm_srli_epi16(v, Shift);
+				if constexpr (sizeof(TDst) == 1) {
+					_mm_storel_epi64((__m128i*)(dst + x), _mm_packus_epi16(v, v));
+				} else {
+					_mm_storeu_si128((__m128i*)(dst + x), _mm_min_epi16(v, vmax));
+				}
+			}
+			for (; x < m_Width; x++) {
+				dst[x] = (TDst)std::min((src[x] + bias[x & 7]) >> Shift, DstMax);
+			}
+		}
+
+		m_Y++;
+	}
+};
+
+// Planar 10-16 bit or float to 8-bit planar with the same layout (YV12, YV16, YV24, Y800).
+template <bool ErrorDiffusion, int SrcBits, int Planes, int SubW, int SubH, bool SwapUV>
+UINT DitherFrame(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	using Dither = CPlaneDither<ErrorDiffusion, SrcBits, 8>;
+	BYTE* scratch = GetDitherScratch(Dither::ScratchSize(width));
+	UINT dataLength = 0;
+
+	for (int i = 0; i < Planes; i++) {
+		const bool chroma = (i == 1 || i == 2);
+		const int s = (SwapUV && chroma) ? 3 - i : i;
+		const UINT plane_pitch  = chroma ? (dst_pitch >> SubW) : dst_pitch;
+		const UINT plane_width  = chroma ? (width >> SubW) : width;
+		const UINT plane_height = chroma ? (height >> SubH) : height;
+
+		Dither dither(plane_width, scratch);
+		for (UINT y = 0; y < plane_height; y++) {
+			dither.Row(dst + plane_pitch * y, src[s] + src_pitch[s] * (int)y);
+		}
+
+		dst += plane_pitch * plane_height;
+		dataLength += plane_pitch * plane_height;
+	}
+
+	return dataLength;
+}
+
+// Planar 4:2:0 10-16 bit to NV12 (DstBits = 8) or P010 (DstBits = 10).
+template <bool ErrorDiffusion, int SrcBits, int DstBits>
+UINT DitherFrameToSemiPlanar(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	using T = std::conditional_t<(DstBits > 8), uint16_t, uint8_t>;
+	using Dither = CPlaneDither<ErrorDiffusion, SrcBits, DstBits>;
+	constexpr int Shift = sizeof(T) * 8 - DstBits; // P010 keeps the samples in the high bits
+
+	// the luma is done first, the block is then shared by the chroma dithers and rows
+	const UINT chroma_width = width / 2;
+	const size_t chroma_scratch = Dither::ScratchSize(chroma_width);
+	const size_t chroma_row     = AlignScratch(chroma_width * sizeof(T));
+	BYTE* scratch = GetDitherScratch(std::max(Dither::ScratchSize(width), (chroma_scratch + chroma_row) * 2));
+
+	Dither ditherY(width, scratch);
+	for (UINT y = 0; y < height; y++) {
+		T* dst_y = (T*)(dst + dst_pitch * y);
+		ditherY.Row(dst_y, src[0] + src_pitch[0] * (int)y);
+		if constexpr (Shift > 0) {
+			ShiftRow16<Shift>(dst_y, dst_y, width);
+		}
+	}
+
+	Dither ditherU(chroma_width, scratch);
+	Dither ditherV(chroma_width, scratch + chroma_scratch);
+	T* row_u = (T*)(scratch + chroma_scratch * 2);
+	T* row_v = (T*)(scratch + chroma_scratch * 2 + chroma_row);
+
+	BYTE* dst_uv = dst + dst_pitch * height;
+	for (UINT y = 0; y < height / 2; y++) {
+		ditherU.Row(row_u, src[1] + src_pitch[1] * (int)y);
+		ditherV.Row(row_v, src[2] + src_pitch[2] * (int)y);
+		InterleaveRow<T, Shift>((T*)dst_uv, row_u, row_v, chroma_width);
+		dst_uv += dst_pitch;
+	}
+
+	return dst_pitch * height * 3 / 2;
+}
+
+// Planar RGB 10-16 bit or float to RGB32.
+template <bool ErrorDiffusion, int SrcBits>
+UINT DitherFrameToRGB32(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height)
+{
+	using Dither = CPlaneDither<ErrorDiffusion, SrcBits, 8>;
+	const size_t plane_scratch = Dither::ScratchSize(width);
+	BYTE* scratch = GetDitherScratch(plane_scratch * 3 + width * 3);
+
+	BYTE* rows = scratch + plane_scratch * 3;
+	const BYTE* row_src[4] = { rows, rows + width, rows + width * 2, nullptr };
+	const int row_pitch[4] = { (int)width, (int)width, (int)width, 0 };
+
+	Dither dither[3] = {
+		{ width, scratch },
+		{ width, scratch + plane_scratch },
+		{ width, scratch + plane_scratch * 2 },
+	};
+	for (UINT y = 0; y < height; y++) {
+		for (int i = 0; i < 3; i++) {
+			dither[i].Row((BYTE*)row_src[i], src[i] + src_pitch[i] * (int)y);
+		}
+		CopyFrameToRGB32<false>(dst + dst_pitch * y, dst_pitch, row_src, row_pitch, width, 1);
+	}
+
+	return dst_pitch * height;
+}
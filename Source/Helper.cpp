@@ -5,6 +5,8 @@
  */
 
 #include "stdafx.h"
+#include <array>
+#include <cmath>
 #include "../Include/Version.h"
 
 #ifndef __AVISYNTH_7_H__
@@ -12,10 +14,12 @@
 #endif
 
 #ifndef VSSCRIPT_H
+#define VS_GRAPH_API
 #include "../Include/VSScript4.h"
 #endif
 
 #include "Helper.h"
+#include "FrameTransfer.h"
 
 
 std::wstring GetVersionStr()
@@ -43,86 +47,534 @@ LPCWSTR GetNameAndVersion()
 	return version.c_str();
 }
 
-static const FmtParams_t s_FormatTable[] = {
-	// fourcc                   |   subtype                | ASformat                | VSformat      | str    |Packsize|buffCoeff|CDepth|planes|bitCount
-	{DWORD(-1),                  GUID_NULL,                 0,                        0,              nullptr,        0, 0,       0,     0,     0},
+static constexpr FmtParams_t s_FormatTableBase[] = {
+	// fourcc                   |   subtype                  | ASformat                | VSformat      | str    |Packsize|buffCoeff|CDepth|planes|bitCount
+	{DWORD(-1),                  &GUID_NULL,                 0,                        0,              nullptr,        0, 0,       0,     0,     0},
 	// YUV packed
-	{FCC('YUY2'),                MEDIASUBTYPE_YUY2,         VideoInfo::CS_YUY2,       0,             L"YUY2",         2, 2,       8,     1,     16},
+	{FCC('YUY2'),                &MEDIASUBTYPE_YUY2,         VideoInfo::CS_YUY2,       0,             L"YUY2",         2, 2,       8,     1,     16},
 	// YUV planar
-	{FCC('YV12'),                MEDIASUBTYPE_YV12,         VideoInfo::CS_I420,       0,             L"I420",         1, 3,       8,     3,     12},
-	{FCC('YV12'),                MEDIASUBTYPE_YV12,         VideoInfo::CS_YV12,       pfYUV420P8,    L"YV12",         1, 3,       8,     3,     12},
-	{MAKEFOURCC('Y','3',11,10),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P10,  pfYUV420P10,   L"YUV420P10",    2, 3,       10,    3,     24},
-	{MAKEFOURCC('Y','3',11,12),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P12,  pfYUV420P12,   L"YUV420P12",    2, 3,       12,    3,     24},
-	{MAKEFOURCC('Y','3',11,14),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P14,  pfYUV420P14,   L"YUV420P14",    2, 3,       14,    3,     24},
-	{MAKEFOURCC('Y','3',11,16),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P16,  pfYUV420P16,   L"YUV420P16",    2, 3,       16,    3,     24},
-	{FCC('YV16'),                MEDIASUBTYPE_YV16,         VideoInfo::CS_YV16,       pfYUV422P8,    L"YV16",         1, 4,       8,     3,     16},
-	{MAKEFOURCC('Y','3',10,10),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P10,  pfYUV422P10,   L"YUV422P10",    2, 4,       10,    3,     32},
-	{MAKEFOURCC('Y','3',10,12),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P12,  pfYUV422P12,   L"YUV422P12",    2, 4,       12,    3,     32},
-	{MAKEFOURCC('Y','3',10,14),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P14,  pfYUV422P14,   L"YUV422P14",    2, 4,       14,    3,     32},
-	{MAKEFOURCC('Y','3',10,16),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P16,  pfYUV422P16,   L"YUV422P16",    2, 4,       16,    3,     32},
-	{FCC('YV24'),                MEDIASUBTYPE_YV24,         VideoInfo::CS_YV24,       pfYUV444P8,    L"YV24",         1, 6,       8,     3,     24},
-	{MAKEFOURCC('Y','3',0,10),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P10,  pfYUV444P10,   L"YUV444P10",    2, 6,       10,    3,     48},
-	{MAKEFOURCC('Y','3',0,12),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P12,  pfYUV444P12,   L"YUV444P12",    2, 6,       12,    3,     48},
-	{MAKEFOURCC('Y','3',0,14),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P14,  pfYUV444P14,   L"YUV444P14",    2, 6,       14,    3,     48},
-	{MAKEFOURCC('Y','3',0,16),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P16,  pfYUV444P16,   L"YUV444P16",    2, 6,       16,    3,     48},
+	{FCC('YV12'),                &MEDIASUBTYPE_YV12,         VideoInfo::CS_I420,       0,             L"I420",         1, 3,       8,     3,     12},
+	{FCC('YV12'),                &MEDIASUBTYPE_YV12,         VideoInfo::CS_YV12,       pfYUV420P8,    L"YV12",         1, 3,       8,     3,     12},
+	{MAKEFOURCC('Y','3',11,10),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P10,  pfYUV420P10,   L"YUV420P10",    2, 3,       10,    3,     24},
+	{MAKEFOURCC('Y','3',11,12),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P12,  pfYUV420P12,   L"YUV420P12",    2, 3,       12,    3,     24},
+	{MAKEFOURCC('Y','3',11,14),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P14,  pfYUV420P14,   L"YUV420P14",    2, 3,       14,    3,     24},
+	{MAKEFOURCC('Y','3',11,16),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV420P16,  pfYUV420P16,   L"YUV420P16",    2, 3,       16,    3,     24},
+	{FCC('YV16'),                &MEDIASUBTYPE_YV16,         VideoInfo::CS_YV16,       pfYUV422P8,    L"YV16",         1, 4,       8,     3,     16},
+	{MAKEFOURCC('Y','3',10,10),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P10,  pfYUV422P10,   L"YUV422P10",    2, 4,       10,    3,     32},
+	{MAKEFOURCC('Y','3',10,12),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P12,  pfYUV422P12,   L"YUV422P12",    2, 4,       12,    3,     32},
+	{MAKEFOURCC('Y','3',10,14),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P14,  pfYUV422P14,   L"YUV422P14",    2, 4,       14,    3,     32},
+	{MAKEFOURCC('Y','3',10,16),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV422P16,  pfYUV422P16,   L"YUV422P16",    2, 4,       16,    3,     32},
+	{FCC('YV24'),                &MEDIASUBTYPE_YV24,         VideoInfo::CS_YV24,       pfYUV444P8,    L"YV24",         1, 6,       8,     3,     24},
+	{MAKEFOURCC('Y','3',0,10),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P10,  pfYUV444P10,   L"YUV444P10",    2, 6,       10,    3,     48},
+	{MAKEFOURCC('Y','3',0,12),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P12,  pfYUV444P12,   L"YUV444P12",    2, 6,       12,    3,     48},
+	{MAKEFOURCC('Y','3',0,14),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P14,  pfYUV444P14,   L"YUV444P14",    2, 6,       14,    3,     48},
+	{MAKEFOURCC('Y','3',0,16),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUV444P16,  pfYUV444P16,   L"YUV444P16",    2, 6,       16,    3,     48},
 	// YUV planar whith alpha
-	{MAKEFOURCC('Y','4',11,8),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420,    0,             L"YUVA420P8",    1, 5,       8,     4,     20},
-	{MAKEFOURCC('Y','4',11,10),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420P10, 0,             L"YUVA420P10",   2, 5,       10,    4,     40},
-	{MAKEFOURCC('Y','4',11,16),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420P16, 0,             L"YUVA420P16",   2, 5,       16,    4,     40},
-	{MAKEFOURCC('Y','4',10,8),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422,    0,             L"YUVA422P8",    1, 6,       8,     4,     24},
-	{MAKEFOURCC('Y','4',10,10),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P10, 0,             L"YUVA422P10",   2, 6,       10,    4,     48},
-	{MAKEFOURCC('Y','4',10,12),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P12, 0,             L"YUVA422P12",   2, 6,       12,    4,     48},
-	{MAKEFOURCC('Y','4',10,16),  MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P16, 0,             L"YUVA422P16",   2, 6,       16,    4,     48},
-	{MAKEFOURCC('Y','4',0,8),    MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444,    0,             L"YUVA444P8",    1, 8,       8,     4,     32},
-	{MAKEFOURCC('Y','4',0,10),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P10, 0,             L"YUVA444P10",   2, 8,       10,    4,     64},
-	{MAKEFOURCC('Y','4',0,12),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P12, 0,             L"YUVA444P12",   2, 8,       12,    4,     64},
-	{MAKEFOURCC('Y','4',0,16),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P16, 0,             L"YUVA444P16",   2, 8,       16,    4,     64},
+	{MAKEFOURCC('Y','4',11,8),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420,    0,             L"YUVA420P8",    1, 5,       8,     4,     20},
+	{MAKEFOURCC('Y','4',11,10),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420P10, 0,             L"YUVA420P10",   2, 5,       10,    4,     40},
+	{MAKEFOURCC('Y','4',11,16),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA420P16, 0,             L"YUVA420P16",   2, 5,       16,    4,     40},
+	{MAKEFOURCC('Y','4',10,8),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422,    0,             L"YUVA422P8",    1, 6,       8,     4,     24},
+	{MAKEFOURCC('Y','4',10,10),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P10, 0,             L"YUVA422P10",   2, 6,       10,    4,     48},
+	{MAKEFOURCC('Y','4',10,12),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P12, 0,             L"YUVA422P12",   2, 6,       12,    4,     48},
+	{MAKEFOURCC('Y','4',10,16),  &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA422P16, 0,             L"YUVA422P16",   2, 6,       16,    4,     48},
+	{MAKEFOURCC('Y','4',0,8),    &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444,    0,             L"YUVA444P8",    1, 8,       8,     4,     32},
+	{MAKEFOURCC('Y','4',0,10),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P10, 0,             L"YUVA444P10",   2, 8,       10,    4,     64},
+	{MAKEFOURCC('Y','4',0,12),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P12, 0,             L"YUVA444P12",   2, 8,       12,    4,     64},
+	{MAKEFOURCC('Y','4',0,16),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_YUVA444P16, 0,             L"YUVA444P16",   2, 8,       16,    4,     64},
 	// RGB packed
-	{BI_RGB,                     MEDIASUBTYPE_RGB24,        VideoInfo::CS_BGR24,      0,             L"RGB24",        3, 2,       8,     1,     24},
-	{BI_RGB,                     MEDIASUBTYPE_RGB32,        0,                        0,             L"RGB32",        4, 2,       8,     1,     32},
-	{BI_RGB,                     MEDIASUBTYPE_ARGB32,       VideoInfo::CS_BGR32,      0,             L"ARGB32",       4, 2,       8,     1,     32},
-	{MAKEFOURCC('B','G','R',48), MEDIASUBTYPE_BGR48,        VideoInfo::CS_BGR48,      0,             L"BGR48",        6, 2,       16,    1,     48},
-	{MAKEFOURCC('B','R','A',64), MEDIASUBTYPE_BGRA64,       VideoInfo::CS_BGR64,      0,             L"BGRA64",       8, 2,       16,    1,     64},
+	{BI_RGB,                     &MEDIASUBTYPE_RGB24,        VideoInfo::CS_BGR24,      0,             L"RGB24",        3, 2,       8,     1,     24},
+	{BI_RGB,                     &MEDIASUBTYPE_RGB32,        0,                        0,             L"RGB32",        4, 2,       8,     1,     32},
+	{BI_RGB,                     &MEDIASUBTYPE_ARGB32,       VideoInfo::CS_BGR32,      0,             L"ARGB32",       4, 2,       8,     1,     32},
+	{MAKEFOURCC('B','G','R',48), &MEDIASUBTYPE_BGR48,        VideoInfo::CS_BGR48,      0,             L"BGR48",        6, 2,       16,    1,     48},
+	{MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64,       VideoInfo::CS_BGR64,      0,             L"BGRA64",       8, 2,       16,    1,     64},
 	// RGB planar
-	{MAKEFOURCC('G','3',0,8),    MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP,       pfRGB24,       L"RGBP8",        1, 6,       8,     3,     24},
-	{MAKEFOURCC('G','3',0,10),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP10,     pfRGB30,       L"RGBP10",       2, 6,       10,    3,     48},
-	{MAKEFOURCC('G','3',0,12),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP12,     pfRGB36,       L"RGBP12",       2, 6,       12,    3,     48},
-	{MAKEFOURCC('G','3',0,14),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP14,     pfRGB42,       L"RGBP14",       2, 6,       14,    3,     48},
-	{MAKEFOURCC('G','3',0,16),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP16,     pfRGB48,       L"RGBP16",       2, 6,       16,    3,     48},
-	{MAKEFOURCC('G','3',0,33),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBPS,      pfRGBS,        L"RGBPS",        4, 6,       32,    3,     96},
+	{MAKEFOURCC('G','3',0,8),    &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP,       pfRGB24,       L"RGBP8",        1, 6,       8,     3,     24},
+	{MAKEFOURCC('G','3',0,10),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP10,     pfRGB30,       L"RGBP10",       2, 6,       10,    3,     48},
+	{MAKEFOURCC('G','3',0,12),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP12,     pfRGB36,       L"RGBP12",       2, 6,       12,    3,     48},
+	{MAKEFOURCC('G','3',0,14),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP14,     pfRGB42,       L"RGBP14",       2, 6,       14,    3,     48},
+	{MAKEFOURCC('G','3',0,16),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBP16,     pfRGB48,       L"RGBP16",       2, 6,       16,    3,     48},
+	{MAKEFOURCC('G','3',0,33),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBPS,      pfRGBS,        L"RGBPS",        4, 6,       32,    3,     96},
 	// RGB planar whith alpha
-	{MAKEFOURCC('G','4',0,8),    MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP,      0,             L"RGBAP8",       1, 8,       8,     4,     32},
-	{MAKEFOURCC('G','4',0,10),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP10,    0,             L"RGBAP10",      2, 8,       10,    4,     64},
-	{MAKEFOURCC('G','4',0,12),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP12,    0,             L"RGBAP12",      2, 8,       12,    4,     64},
-	{MAKEFOURCC('G','4',0,14),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP14,    0,             L"RGBAP14",      2, 8,       14,    4,     64},
-	{MAKEFOURCC('G','4',0,16),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP16,    0,             L"RGBAP16",      2, 8,       16,    4,     64},
-	{MAKEFOURCC('G','4',0,33),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAPS,     0,             L"RGBAPS",       4, 8,       32,    4,    128},
+	{MAKEFOURCC('G','4',0,8),    &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP,      0,             L"RGBAP8",       1, 8,       8,     4,     32},
+	{MAKEFOURCC('G','4',0,10),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP10,    0,             L"RGBAP10",      2, 8,       10,    4,     64},
+	{MAKEFOURCC('G','4',0,12),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP12,    0,             L"RGBAP12",      2, 8,       12,    4,     64},
+	{MAKEFOURCC('G','4',0,14),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP14,    0,             L"RGBAP14",      2, 8,       14,    4,     64},
+	{MAKEFOURCC('G','4',0,16),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAP16,    0,             L"RGBAP16",      2, 8,       16,    4,     64},
+	{MAKEFOURCC('G','4',0,33),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_RGBAPS,     0,             L"RGBAPS",       4, 8,       32,    4,    128},
 	// grayscale
-	{FCC('Y800'),                MEDIASUBTYPE_Y800,         VideoInfo::CS_Y8,         pfGray8,       L"Y8",           1, 2,       8,     1,     8},
-	{MAKEFOURCC('Y','1',0,10),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y10,        pfGray10,      L"Y10",          2, 2,       10,    1,     16},
-	{MAKEFOURCC('Y','1',0,12),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y12,        pfGray12,      L"Y12",          2, 2,       12,    1,     16},
-	{MAKEFOURCC('Y','1',0,14),   MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y14,        pfGray14,      L"Y14",          2, 2,       14,    1,     16},
-	{MAKEFOURCC('Y','1',0,16),   MEDIASUBTYPE_Y16,          VideoInfo::CS_Y16,        pfGray16,      L"Y16",          2, 2,       16,    1,     16},
+	{FCC('Y800'),                &MEDIASUBTYPE_Y800,         VideoInfo::CS_Y8,         pfGray8,       L"Y8",           1, 2,       8,     1,     8},
+	{MAKEFOURCC('Y','1',0,10),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y10,        pfGray10,      L"Y10",          2, 2,       10,    1,     16},
+	{MAKEFOURCC('Y','1',0,12),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y12,        pfGray12,      L"Y12",          2, 2,       12,    1,     16},
+	{MAKEFOURCC('Y','1',0,14),   &MEDIASUBTYPE_LAV_RAWVIDEO, VideoInfo::CS_Y14,        pfGray14,      L"Y14",          2, 2,       14,    1,     16},
+	{MAKEFOURCC('Y','1',0,16),   &MEDIASUBTYPE_Y16,          VideoInfo::CS_Y16,        pfGray16,      L"Y16",          2, 2,       16,    1,     16},
 };
 
-const FmtParams_t& GetFormatParamsAviSynth(const int asFormat)
+constexpr int GetSubSampling(const FmtParams_t& f, const int mask, const int shift)
+{
+	if (f.planes < 3 || !(f.ASformat & VideoInfo::CS_PLANAR) || !(f.ASformat & (VideoInfo::CS_YUV | VideoInfo::CS_YUVA))) {
+		return 0;
+	}
+	switch ((f.ASformat & mask) >> shift) {
+	case 0:  return 1; // CS_Sub_Width_2, CS_Sub_Height_2
+	case 1:  return 2; // CS_Sub_Width_4, CS_Sub_Height_4
+	default: return 0; // CS_Sub_Width_1, CS_Sub_Height_1
+	}
+}
+
+constexpr int GetSubSamplingW(const FmtParams_t& f)
+{
+	return GetSubSampling(f, VideoInfo::CS_Sub_Width_Mask, VideoInfo::CS_Shift_Sub_Width);
+}
+
+constexpr int GetSubSamplingH(const FmtParams_t& f)
+{
+	return GetSubSampling(f, VideoInfo::CS_Sub_Height_Mask, VideoInfo::CS_Shift_Sub_Height);
+}
+
+constexpr bool IsSwapUV(const FmtParams_t& f)
+{
+	// YV12, YV16 and YV24 have the V plane before the U plane
+	return f.fourcc == FCC('YV12') || f.fourcc == FCC('YV16') || f.fourcc == FCC('YV24');
+}
+
+constexpr bool IsBottomUp(const FmtParams_t& f)
+{
+	// AviSynth+ outputs packed RGB formats as bottom-up bitmaps
+	return f.fourcc == BI_RGB || f.fourcc == MAKEFOURCC('B','G','R',48) || f.fourcc == MAKEFOURCC('B','R','A',64);
+}
+
+template <size_t... I>
+constexpr auto MakeFormatTable(std::index_sequence<I...>)
+{
+	std::array<FmtParams_t, sizeof...(I)> table = { s_FormatTableBase[I]... };
+
+	((table[I].copyFrame = &CopyFrame<
+		s_FormatTableBase[I].planes,
+		GetSubSamplingW(s_FormatTableBase[I]),
+		GetSubSamplingH(s_FormatTableBase[I]),
+		IsSwapUV(s_FormatTableBase[I]),
+		IsBottomUp(s_FormatTableBase[I])>), ...);
+
+	return table;
+}
+
+static constexpr auto s_FormatTable = MakeFormatTable(std::make_index_sequence<std::size(s_FormatTableBase)>{});
+
+constexpr bool ValidateFormatTable()
+{
+	for (size_t i = 1; i < s_FormatTable.size(); i++) {
+		const auto& f = s_FormatTable[i];
+		if (f.planes != 1 && f.planes != 3 && f.planes != 4) {
+			return false;
+		}
+		if (f.Packsize * 8 < f.CDepth || !f.str || !f.subtype || !f.copyFrame) {
+			return false;
+		}
+		// luma plane + two chroma planes + alpha plane, in half luma planes
+		const int buffCoeff = 2 + (f.planes >= 3 ? (4 >> (GetSubSamplingW(f) + GetSubSamplingH(f))) : 0) + (f.planes == 4 ? 2 : 0);
+		if (f.buffCoeff != buffCoeff || f.bitCount != f.Packsize * 4 * f.buffCoeff) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(ValidateFormatTable(), "Invalid entry in s_FormatTable");
+
+// Indexes of the table entries with a non-zero key, sorted by that key.
+// Lookups are a binary search over at most a few dozen entries instead of a scan of the whole table.
+template <int FmtParams_t::*Key>
+constexpr size_t CountFormatKeys()
+{
+	size_t count = 0;
+	for (size_t i = 1; i < s_FormatTable.size(); i++) {
+		if (s_FormatTable[i].*Key != 0) {
+			count++;
+		}
+	}
+	return count;
+}
+
+template <int FmtParams_t::*Key>
+constexpr auto MakeFormatIndex()
+{
+	std::array<uint8_t, CountFormatKeys<Key>()> index = {};
+	size_t n = 0;
+	for (size_t i = 1; i < s_FormatTable.size(); i++) {
+		if (s_FormatTable[i].*Key != 0) {
+			index[n++] = (uint8_t)i;
+		}
+	}
+	std::sort(index.begin(), index.end(), [](const uint8_t a, const uint8_t b) {
+		return s_FormatTable[a].*Key < s_FormatTable[b].*Key;
+	});
+	return index;
+}
+
+template <int FmtParams_t::*Key, size_t N>
+constexpr bool IsFormatIndexUnique(const std::array<uint8_t, N>& index)
+{
+	for (size_t i = 1; i < N; i++) {
+		if (s_FormatTable[index[i - 1]].*Key == s_FormatTable[index[i]].*Key) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <int FmtParams_t::*Key, size_t N>
+const FmtParams_t& FindFormatParams(const std::array<uint8_t, N>& index, const int key)
 {
-	for (const auto& f : s_FormatTable) {
-		if (f.ASformat == asFormat) {
-			return f;
+	if (key) {
+		auto it = std::lower_bound(index.begin(), index.end(), key, [](const uint8_t i, const int k) {
+			return s_FormatTable[i].*Key < k;
+		});
+		if (it != index.end() && s_FormatTable[*it].*Key == key) {
+			return s_FormatTable[*it];
 		}
 	}
 	return s_FormatTable[0];
 }
 
+static_assert(s_FormatTable.size() <= UINT8_MAX + 1, "s_FormatTable is too large for uint8_t indexes");
+
+static constexpr auto s_IndexASformat = MakeFormatIndex<&FmtParams_t::ASformat>();
+static constexpr auto s_IndexVSformat = MakeFormatIndex<&FmtParams_t::VSformat>();
+
+static_assert(IsFormatIndexUnique<&FmtParams_t::ASformat>(s_IndexASformat), "Duplicate ASformat in s_FormatTable");
+static_assert(IsFormatIndexUnique<&FmtParams_t::VSformat>(s_IndexVSformat), "Duplicate VSformat in s_FormatTable");
+
+const FmtParams_t& GetFormatParamsAviSynth(const int asFormat)
+{
+	return FindFormatParams<&FmtParams_t::ASformat>(s_IndexASformat, asFormat);
+}
+
 const FmtParams_t& GetFormatParamsVapourSynth(const int vsVideoFormat)
 {
-	for (const auto& f : s_FormatTable) {
-		if (f.VSformat == vsVideoFormat) {
-			return f;
+	return FindFormatParams<&FmtParams_t::VSformat>(s_IndexVSformat, vsVideoFormat);
+}
+
+int GetVapourSynthVideoID(const VSVideoFormat& vf)
+{
+	// same as VS_MAKE_VIDEO_ID, which is not available outside of VapourSynth4.h
+	return (vf.colorFamily << 28) | (vf.sampleType << 24) | (vf.bitsPerSample << 16) | (vf.subSamplingW << 8) | (vf.subSamplingH << 0);
+}
+
+const FmtParams_t& GetFormatParamsVapourSynth(const VSVideoFormat& vf)
+{
+	return GetFormatParamsVapourSynth(GetVapourSynthVideoID(vf));
+}
+
+// Additional output formats, offered after the native format of the source.
+// The copyFrame function converts from the source format with the ASformat in the first column.
+struct OutputFmtParams_t {
+	int         srcASformat;
+	FmtParams_t params;
+};
+
+static constexpr OutputFmtParams_t s_OutputFormatTable[] = {
+	// source                  fourcc                      subtype               ASformat VSformat str        Packsize buffCoeff CDepth planes bitCount copyFrame
+	{VideoInfo::CS_I420,      {FCC('NV12'),                &MEDIASUBTYPE_NV12,   0,       0,       L"NV12",   1,       3,        8,     2,     12,      &CopyFrameToSemiPlanar<uint8_t, 0, 1>}},
+	{VideoInfo::CS_YV12,      {FCC('NV12'),                &MEDIASUBTYPE_NV12,   0,       0,       L"NV12",   1,       3,        8,     2,     12,      &CopyFrameToSemiPlanar<uint8_t, 0, 1>}},
+	{VideoInfo::CS_YUV420P10, {FCC('P010'),                &MEDIASUBTYPE_P010,   0,       0,       L"P010",   2,       3,        10,    2,     24,      &CopyFrameToSemiPlanar<uint16_t, 6, 1>}},
+	{VideoInfo::CS_YUV420P12, {FCC('P016'),                &MEDIASUBTYPE_P016,   0,       0,       L"P016",   2,       3,        16,    2,     24,      &CopyFrameToSemiPlanar<uint16_t, 4, 1>}},
+	{VideoInfo::CS_YUV420P14, {FCC('P016'),                &MEDIASUBTYPE_P016,   0,       0,       L"P016",   2,       3,        16,    2,     24,      &CopyFrameToSemiPlanar<uint16_t, 2, 1>}},
+	{VideoInfo::CS_YUV420P16, {FCC('P016'),                &MEDIASUBTYPE_P016,   0,       0,       L"P016",   2,       3,        16,    2,     24,      &CopyFrameToSemiPlanar<uint16_t, 0, 1>}},
+	{VideoInfo::CS_YUV422P10, {FCC('P210'),                &MEDIASUBTYPE_P210,   0,       0,       L"P210",   2,       4,        10,    2,     32,      &CopyFrameToSemiPlanar<uint16_t, 6, 0>}},
+	{VideoInfo::CS_YUV422P10, {FCC('v210'),                &MEDIASUBTYPE_v210,   0,       0,       L"v210",   0,       2,        10,    1,     20,      &CopyFrameToV210}},
+	{VideoInfo::CS_YUV422P12, {FCC('P216'),                &MEDIASUBTYPE_P216,   0,       0,       L"P216",   2,       4,        16,    2,     32,      &CopyFrameToSemiPlanar<uint16_t, 4, 0>}},
+	{VideoInfo::CS_YUV422P14, {FCC('P216'),                &MEDIASUBTYPE_P216,   0,       0,       L"P216",   2,       4,        16,    2,     32,      &CopyFrameToSemiPlanar<uint16_t, 2, 0>}},
+	{VideoInfo::CS_YUV422P16, {FCC('P216'),                &MEDIASUBTYPE_P216,   0,       0,       L"P216",   2,       4,        16,    2,     32,      &CopyFrameToSemiPlanar<uint16_t, 0, 0>}},
+	{VideoInfo::CS_YUV444P10, {FCC('Y410'),                &MEDIASUBTYPE_Y410,   0,       0,       L"Y410",   4,       2,        10,    1,     32,      &CopyFrameToY410}},
+	{VideoInfo::CS_YUV444P10, {FCC('Y416'),                &MEDIASUBTYPE_Y416,   0,       0,       L"Y416",   8,       2,        16,    1,     64,      &CopyFrameToY416<6>}},
+	{VideoInfo::CS_YUV444P12, {FCC('Y416'),                &MEDIASUBTYPE_Y416,   0,       0,       L"Y416",   8,       2,        16,    1,     64,      &CopyFrameToY416<4>}},
+	{VideoInfo::CS_YUV444P14, {FCC('Y416'),                &MEDIASUBTYPE_Y416,   0,       0,       L"Y416",   8,       2,        16,    1,     64,      &CopyFrameToY416<2>}},
+	{VideoInfo::CS_YUV444P16, {FCC('Y416'),                &MEDIASUBTYPE_Y416,   0,       0,       L"Y416",   8,       2,        16,    1,     64,      &CopyFrameToY416<0>}},
+	{VideoInfo::CS_RGBP,      {BI_RGB,                     &MEDIASUBTYPE_RGB32,  0,       0,       L"RGB32",  4,       2,        8,     1,     32,      &CopyFrameToRGB32<false>}},
+	{VideoInfo::CS_RGBP10,    {MAKEFOURCC('B','G','R',48), &MEDIASUBTYPE_BGR48,  0,       0,       L"BGR48",  6,       2,        16,    1,     48,      &CopyFrameToBGR48<6>}},
+	{VideoInfo::CS_RGBP10,    {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<6, false>}},
+	{VideoInfo::CS_RGBP12,    {MAKEFOURCC('B','G','R',48), &MEDIASUBTYPE_BGR48,  0,       0,       L"BGR48",  6,       2,        16,    1,     48,      &CopyFrameToBGR48<4>}},
+	{VideoInfo::CS_RGBP12,    {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<4, false>}},
+	{VideoInfo::CS_RGBP14,    {MAKEFOURCC('B','G','R',48), &MEDIASUBTYPE_BGR48,  0,       0,       L"BGR48",  6,       2,        16,    1,     48,      &CopyFrameToBGR48<2>}},
+	{VideoInfo::CS_RGBP14,    {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<2, false>}},
+	{VideoInfo::CS_RGBP16,    {MAKEFOURCC('B','G','R',48), &MEDIASUBTYPE_BGR48,  0,       0,       L"BGR48",  6,       2,        16,    1,     48,      &CopyFrameToBGR48<0>}},
+	{VideoInfo::CS_RGBP16,    {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<0, false>}},
+	{VideoInfo::CS_RGBAP,     {BI_RGB,                     &MEDIASUBTYPE_ARGB32, 0,       0,       L"ARGB32", 4,       2,        8,     1,     32,      &CopyFrameToRGB32<true>}},
+	{VideoInfo::CS_RGBAP10,   {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<6, true>}},
+	{VideoInfo::CS_RGBAP12,   {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<4, true>}},
+	{VideoInfo::CS_RGBAP14,   {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<2, true>}},
+	{VideoInfo::CS_RGBAP16,   {MAKEFOURCC('B','R','A',64), &MEDIASUBTYPE_BGRA64, 0,       0,       L"BGRA64", 8,       2,        16,    1,     64,      &CopyFrameToBGRA64<0, true>}},
+};
+
+constexpr bool ValidateOutputFormatTable()
+{
+	for (const auto& o : s_OutputFormatTable) {
+		const auto& f = o.params;
+		if (std::none_of(s_FormatTable.begin() + 1, s_FormatTable.end(), [&](const FmtParams_t& src) { return src.ASformat == o.srcASformat; })) {
+			return false;
+		}
+		if (f.ASformat || f.VSformat || !f.str || !f.subtype || !f.copyFrame) {
+			return false;
+		}
+		if (f.fourcc == FCC('v210')) {
+			continue; // Packsize is not used, see GetOutputPitch
+		}
+		if (f.Packsize * 8 < f.CDepth || f.bitCount != f.Packsize * 4 * f.buffCoeff) {
+			return false;
 		}
 	}
-	return s_FormatTable[0];
+	return true;
+}
+
+static_assert(ValidateOutputFormatTable(), "Invalid entry in s_OutputFormatTable");
+
+// Dithered output formats with a lower bit depth, offered after the lossless formats.
+struct DitherFmtParams_t {
+	int             srcASformat;
+	FmtParams_t     params; // copyFrame uses ordered dither
+	TransferFrameFn copyFrameErrorDiffusion;
+};
+
+static constexpr DitherFmtParams_t s_DitherFormatTable[] = {
+	// source                  fourcc       subtype              ASformat VSformat str       Packsize buffCoeff CDepth planes bitCount copyFrame (ordered)                      error diffusion
+	{VideoInfo::CS_YUV420P10, {FCC('NV12'), &MEDIASUBTYPE_NV12,  0,       0,       L"NV12",  1,       3,        8,     2,     12,      &DitherFrameToSemiPlanar<false, 10, 8>}, &DitherFrameToSemiPlanar<true, 10, 8>},
+	{VideoInfo::CS_YUV420P12, {FCC('NV12'), &MEDIASUBTYPE_NV12,  0,       0,       L"NV12",  1,       3,        8,     2,     12,      &DitherFrameToSemiPlanar<false, 12, 8>}, &DitherFrameToSemiPlanar<true, 12, 8>},
+	{VideoInfo::CS_YUV420P14, {FCC('NV12'), &MEDIASUBTYPE_NV12,  0,       0,       L"NV12",  1,       3,        8,     2,     12,      &DitherFrameToSemiPlanar<false, 14, 8>}, &DitherFrameToSemiPlanar<true, 14, 8>},
+	{VideoInfo::CS_YUV420P16, {FCC('NV12'), &MEDIASUBTYPE_NV12,  0,       0,       L"NV12",  1,       3,        8,     2,     12,      &DitherFrameToSemiPlanar<false, 16, 8>}, &DitherFrameToSemiPlanar<true, 16, 8>},
+	{VideoInfo::CS_YUV420P12, {FCC('P010'), &MEDIASUBTYPE_P010,  0,       0,       L"P010",  2,       3,        10,    2,     24,      &DitherFrameToSemiPlanar<false, 12, 10>}, &DitherFrameToSemiPlanar<true, 12, 10>},
+	{VideoInfo::CS_YUV420P14, {FCC('P010'), &MEDIASUBTYPE_P010,  0,       0,       L"P010",  2,       3,        10,    2,     24,      &DitherFrameToSemiPlanar<false, 14, 10>}, &DitherFrameToSemiPlanar<true, 14, 10>},
+	{VideoInfo::CS_YUV420P16, {FCC('P010'), &MEDIASUBTYPE_P010,  0,       0,       L"P010",  2,       3,        10,    2,     24,      &DitherFrameToSemiPlanar<false, 16, 10>}, &DitherFrameToSemiPlanar<true, 16, 10>},
+	{VideoInfo::CS_YUV422P10, {FCC('YV16'), &MEDIASUBTYPE_YV16,  0,       0,       L"YV16",  1,       4,        8,     3,     16,      &DitherFrame<false, 10, 3, 1, 0, true>}, &DitherFrame<true, 10, 3, 1, 0, true>},
+	{VideoInfo::CS_YUV422P12, {FCC('YV16'), &MEDIASUBTYPE_YV16,  0,       0,       L"YV16",  1,       4,        8,     3,     16,      &DitherFrame<false, 12, 3, 1, 0, true>}, &DitherFrame<true, 12, 3, 1, 0, true>},
+	{VideoInfo::CS_YUV422P14, {FCC('YV16'), &MEDIASUBTYPE_YV16,  0,       0,       L"YV16",  1,       4,        8,     3,     16,      &DitherFrame<false, 14, 3, 1, 0, true>}, &DitherFrame<true, 14, 3, 1, 0, true>},
+	{VideoInfo::CS_YUV422P16, {FCC('YV16'), &MEDIASUBTYPE_YV16,  0,       0,       L"YV16",  1,       4,        8,     3,     16,      &DitherFrame<false, 16, 3, 1, 0, true>}, &DitherFrame<true, 16, 3, 1, 0, true>},
+	{VideoInfo::CS_YUV444P10, {FCC('YV24'), &MEDIASUBTYPE_YV24,  0,       0,       L"YV24",  1,       6,        8,     3,     24,      &DitherFrame<false, 10, 3, 0, 0, true>}, &DitherFrame<true, 10, 3, 0, 0, true>},
+	{VideoInfo::CS_YUV444P12, {FCC('YV24'), &MEDIASUBTYPE_YV24,  0,       0,       L"YV24",  1,       6,        8,     3,     24,      &DitherFrame<false, 12, 3, 0, 0, true>}, &DitherFrame<true, 12, 3, 0, 0, true>},
+	{VideoInfo::CS_YUV444P14, {FCC('YV24'), &MEDIASUBTYPE_YV24,  0,       0,       L"YV24",  1,       6,        8,     3,     24,      &DitherFrame<false, 14, 3, 0, 0, true>}, &DitherFrame<true, 14, 3, 0, 0, true>},
+	{VideoInfo::CS_YUV444P16, {FCC('YV24'), &MEDIASUBTYPE_YV24,  0,       0,       L"YV24",  1,       6,        8,     3,     24,      &DitherFrame<false, 16, 3, 0, 0, true>}, &DitherFrame<true, 16, 3, 0, 0, true>},
+	{VideoInfo::CS_RGBP10,    {BI_RGB,      &MEDIASUBTYPE_RGB32, 0,       0,       L"RGB32", 4,       2,        8,     1,     32,      &DitherFrameToRGB32<false, 10>}, &DitherFrameToRGB32<true, 10>},
+	{VideoInfo::CS_RGBP12,    {BI_RGB,      &MEDIASUBTYPE_RGB32, 0,       0,       L"RGB32", 4,       2,        8,     1,     32,      &DitherFrameToRGB32<false, 12>}, &DitherFrameToRGB32<true, 12>},
+	{VideoInfo::CS_RGBP14,    {BI_RGB,      &MEDIASUBTYPE_RGB32, 0,       0,       L"RGB32", 4,       2,        8,     1,     32,      &DitherFrameToRGB32<false, 14>}, &DitherFrameToRGB32<true, 14>},
+	{VideoInfo::CS_RGBP16,    {BI_RGB,      &MEDIASUBTYPE_RGB32, 0,       0,       L"RGB32", 4,       2,        8,     1,     32,      &DitherFrameToRGB32<false, 16>}, &DitherFrameToRGB32<true, 16>},
+	{VideoInfo::CS_RGBPS,     {BI_RGB,      &MEDIASUBTYPE_RGB32, 0,       0,       L"RGB32", 4,       2,        8,     1,     32,      &DitherFrameToRGB32<false, 32>}, &DitherFrameToRGB32<true, 32>},
+	{VideoInfo::CS_Y10,       {FCC('Y800'), &MEDIASUBTYPE_Y800,  0,       0,       L"Y8",    1,       2,        8,     1,     8,       &DitherFrame<false, 10, 1, 0, 0, false>}, &DitherFrame<true, 10, 1, 0, 0, false>},
+	{VideoInfo::CS_Y12,       {FCC('Y800'), &MEDIASUBTYPE_Y800,  0,       0,       L"Y8",    1,       2,        8,     1,     8,       &DitherFrame<false, 12, 1, 0, 0, false>}, &DitherFrame<true, 12, 1, 0, 0, false>},
+	{VideoInfo::CS_Y14,       {FCC('Y800'), &MEDIASUBTYPE_Y800,  0,       0,       L"Y8",    1,       2,        8,     1,     8,       &DitherFrame<false, 14, 1, 0, 0, false>}, &DitherFrame<true, 14, 1, 0, 0, false>},
+	{VideoInfo::CS_Y16,       {FCC('Y800'), &MEDIASUBTYPE_Y800,  0,       0,       L"Y8",    1,       2,        8,     1,     8,       &DitherFrame<false, 16, 1, 0, 0, false>}, &DitherFrame<true, 16, 1, 0, 0, false>},
+};
+
+constexpr bool ValidateDitherFormatTable()
+{
+	for (const auto& o : s_DitherFormatTable) {
+		const auto& f = o.params;
+		if (std::none_of(s_FormatTable.begin() + 1, s_FormatTable.end(), [&](const FmtParams_t& src) { return src.ASformat == o.srcASformat && src.CDepth > f.CDepth; })) {
+			return false;
+		}
+		if (f.ASformat || f.VSformat || !f.str || !f.subtype || !f.copyFrame || !o.copyFrameErrorDiffusion) {
+			return false;
+		}
+		if (f.Packsize * 8 < f.CDepth || f.bitCount != f.Packsize * 4 * f.buffCoeff) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(ValidateDitherFormatTable(), "Invalid entry in s_DitherFormatTable");
+
+int GetASformatWithAlpha(const int asFormat)
+{
+	if (asFormat & VideoInfo::CS_PLANAR) {
+		if (asFormat & VideoInfo::CS_YUV) {
+			return (asFormat & ~VideoInfo::CS_YUV) | VideoInfo::CS_YUVA;
+		}
+		if ((asFormat & VideoInfo::CS_BGR) && (asFormat & VideoInfo::CS_RGB_TYPE)) {
+			return (asFormat & ~VideoInfo::CS_RGB_TYPE) | VideoInfo::CS_RGBA_TYPE;
+		}
+	}
+	return 0;
+}
+
+int GetASformatWithoutAlpha(const int asFormat)
+{
+	if (asFormat & VideoInfo::CS_PLANAR) {
+		if (asFormat & VideoInfo::CS_YUVA) {
+			return (asFormat & ~VideoInfo::CS_YUVA) | VideoInfo::CS_YUV;
+		}
+		if ((asFormat & VideoInfo::CS_BGR) && (asFormat & VideoInfo::CS_RGBA_TYPE)) {
+			return (asFormat & ~VideoInfo::CS_RGBA_TYPE) | VideoInfo::CS_RGB_TYPE;
+		}
+	}
+	return 0;
+}
+
+static void AddOutputFormat(std::vector<FmtParams_t>& formats, const FmtParams_t& format)
+{
+	// the first one wins, so formats with alpha are not replaced by the same formats without alpha
+	const bool exists = std::any_of(formats.cbegin(), formats.cend(), [&](const FmtParams_t& f) {
+		return *f.subtype == *format.subtype && f.fourcc == format.fourcc;
+	});
+	if (!exists) {
+		formats.emplace_back(format);
+	}
+}
+
+static void AddOutputFormats(std::vector<FmtParams_t>& formats, const int asFormat)
+{
+	for (const auto& o : s_OutputFormatTable) {
+		if (o.srcASformat == asFormat) {
+			AddOutputFormat(formats, o.params);
+		}
+	}
+}
+
+static void AddDitherFormats(std::vector<FmtParams_t>& formats, const int asFormat, const int ditherMode)
+{
+	for (const auto& o : s_DitherFormatTable) {
+		if (o.srcASformat == asFormat) {
+			FmtParams_t params = o.params;
+			if (ditherMode == DITHER_ERRORDIFFUSION) {
+				params.copyFrame = o.copyFrameErrorDiffusion;
+			}
+			AddOutputFormat(formats, params);
+		}
+	}
+}
+
+std::vector<FmtParams_t> GetOutputFormats(const FmtParams_t& format, const int ditherMode)
+{
+	std::vector<FmtParams_t> formats = { format };
+
+	if (format.ASformat) {
+		AddOutputFormats(formats, format.ASformat);
+
+		// the same formats without the alpha plane
+		const auto& formatNoAlpha = GetFormatParamsAviSynth(GetASformatWithoutAlpha(format.ASformat));
+		if (formatNoAlpha.fourcc != DWORD(-1)) {
+			formats.emplace_back(formatNoAlpha);
+			AddOutputFormats(formats, formatNoAlpha.ASformat);
+		}
+
+		if (ditherMode != DITHER_NONE) {
+			AddDitherFormats(formats, format.ASformat, ditherMode);
+			if (formatNoAlpha.fourcc != DWORD(-1)) {
+				AddDitherFormats(formats, formatNoAlpha.ASformat, ditherMode);
+			}
+		}
+	}
+
+	return formats;
+}
+
+bool IsOutputWithAlpha(const FmtParams_t& format)
+{
+	return format.planes == 4 || *format.subtype == MEDIASUBTYPE_ARGB32 || *format.subtype == MEDIASUBTYPE_BGRA64;
+}
+
+UINT GetOutputPitch(const FmtParams_t& format, const UINT width)
+{
+	if (format.fourcc == FCC('v210')) {
+		// groups of 6 pixels in 16 bytes, rows are aligned to 128 bytes
+		return (width + 47) / 48 * 128;
+	}
+	return width * format.Packsize;
+}
+
+int GetOutputPlanes(const FmtParams_t& format, const BYTE* data, const UINT pitch, const UINT width, const UINT height,
+	const BYTE* planeData[4], int planePitch[4], int rowSize[4], int rows[4])
+{
+	const UINT lumaRowSize = (format.fourcc == FCC('v210')) ? (width + 5) / 6 * 16 : width * format.Packsize;
+
+	if (format.planes <= 1) {
+		planeData[0]  = data;
+		planePitch[0] = pitch;
+		rowSize[0]    = lumaRowSize;
+		rows[0]       = height;
+		return 1;
+	}
+
+	// the output formats have no 4:1:1 subsampling, so the chroma share of buffCoeff gives the subsampling
+	int subW = 0;
+	int subH = 0;
+	if (format.planes == 2) {
+		subH = (format.buffCoeff == 3) ? 1 : 0; // interleaved UV rows have the luma pitch
+	} else {
+		const int chromaCoeff = format.buffCoeff - 2 - (format.planes == 4 ? 2 : 0);
+		subW = (chromaCoeff < 4) ? 1 : 0;
+		subH = (chromaCoeff < 2) ? 1 : 0;
+	}
+
+	const int planes = std::min(format.planes, 4);
+	for (int i = 0; i < planes; i++) {
+		const bool chroma = (i == 1 || i == 2);
+		planeData[i]  = data;
+		planePitch[i] = chroma ? (pitch >> subW) : pitch;
+		rowSize[i]    = chroma ? (lumaRowSize >> subW) : lumaRowSize;
+		rows[i]       = chroma ? (height >> subH) : height;
+		data += (size_t)planePitch[i] * rows[i];
+	}
+
+	return planes;
+}
+
+int FindOutputFormat(const std::vector<FmtParams_t>& formats, const CMediaType& mt)
+{
+	if (mt.formattype != FORMAT_VideoInfo2 || mt.cbFormat < sizeof(VIDEOINFOHEADER2)) {
+		return -1;
+	}
+	const VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mt.pbFormat;
+
+	for (size_t i = 0; i < formats.size(); i++) {
+		const auto& f = formats[i];
+		// LAV_RAWVIDEO is shared by many formats, they only differ in biCompression
+		if (mt.subtype == *f.subtype && (mt.subtype != MEDIASUBTYPE_LAV_RAWVIDEO || vih2->bmiHeader.biCompression == f.fourcc)) {
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+int GetDecimationStep(const double rate, const int64_t fpsNum, const int64_t fpsDen, const int maxRenderFps)
+{
+	if (rate <= 1.0 || maxRenderFps <= 0 || fpsNum <= 0 || fpsDen <= 0) {
+		return 1;
+	}
+
+	const double displayFps = rate * fpsNum / fpsDen;
+
+	return std::max(1, (int)std::ceil(displayFps / maxRenderFps - 0.001));
+}
+
+void SetPictAspectRatio(VIDEOINFOHEADER2* vih2, const int64_t sarNum, const int64_t sarDen)
+{
+	vih2->dwPictAspectRatioX = 0;
+	vih2->dwPictAspectRatioY = 0;
+
+	if (sarNum > 0 && sarDen > 0 && sarNum < INT16_MAX && sarDen < INT16_MAX) {
+		auto parX = sarNum * (vih2->rcSource.right - vih2->rcSource.left);
+		auto parY = sarDen * (vih2->rcSource.bottom - vih2->rcSource.top);
+		const auto gcd = std::gcd(parX, parY);
+		parX /= gcd;
+		parY /= gcd;
+		vih2->dwPictAspectRatioX = (DWORD)parX;
+		vih2->dwPictAspectRatioY = (DWORD)parY;
+	}
+}
+
+void SetWaveFormatExtensible(WAVEFORMATEXTENSIBLE* wfex, const int channels, const int sampleRate, const int blockAlign,
+	const int bitsPerSample, const int validBitsPerSample, const GUID& subtype, const DWORD channelMask)
+{
+	wfex->Format.wFormatTag           = WAVE_FORMAT_EXTENSIBLE;
+	wfex->Format.nChannels            = channels;
+	wfex->Format.nSamplesPerSec       = sampleRate;
+	wfex->Format.nAvgBytesPerSec      = blockAlign * sampleRate;
+	wfex->Format.nBlockAlign          = blockAlign;
+	wfex->Format.wBitsPerSample       = bitsPerSample;
+	wfex->Format.cbSize               = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX); // 22
+	wfex->Samples.wValidBitsPerSample = validBitsPerSample;
+	wfex->dwChannelMask               = channelMask;
+	wfex->SubFormat                   = subtype;
 }
 
 std::unique_ptr<BYTE[]> GetBitmapWithText(const std::wstring& text, const long width, const long height)
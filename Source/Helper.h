@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2025 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -12,9 +12,44 @@
 
 LPCWSTR GetNameAndVersion();
 
+struct VSVideoFormat;
+
+enum {
+	DITHER_NONE = 0,       // no dithered output formats
+	DITHER_ORDERED,        // 8x8 ordered dither
+	DITHER_ERRORDIFFUSION, // Sierra Lite error diffusion
+	DITHER_COUNT
+};
+
+enum {
+	DUPLICATE_COPY = 0, // every frame is copied into the sample buffer
+	DUPLICATE_FRAME,    // same script frame object as the content of the buffer
+	DUPLICATE_HASH,     // same content hash, also finds equal frames rendered separately
+	DUPLICATE_COUNT
+};
+
+// Filter settings that are passed to the script objects in Load
+struct Settings_t {
+	bool bVSProfiling  = false;
+	int  iDitherMode   = DITHER_ORDERED;
+	int  iMaxRenderFps = 60; // cap of rendered frames per second at rates above 1.0, 0 - render every frame
+	int  iPrefetchFrames = 3; // frames rendered on each side of the shown frame while paused, 0 - disabled
+	int  iThumbnailWidth = 160;
+	bool bFrameHashes  = false; // collect the hashes of the delivered samples
+	int  iDuplicateFrames = DUPLICATE_COPY; // detection of repeated frames to skip the copy into the sample buffer
+};
+
+// Returns the number of frames to advance per rendered frame at the playback rate,
+// so that no more than maxRenderFps frames per second are requested from the script.
+int GetDecimationStep(const double rate, const int64_t fpsNum, const int64_t fpsDen, const int maxRenderFps);
+
+// Copies or converts a frame to the sample buffer. The source planes are passed in Y,U,V,A or G,B,R,A order.
+// Returns the number of bytes written.
+typedef UINT(*TransferFrameFn)(BYTE* dst, const UINT dst_pitch, const BYTE* const src[4], const int src_pitch[4], const UINT width, const UINT height);
+
 struct FmtParams_t {
 	DWORD          fourcc;
-	GUID           subtype;
+	const GUID*    subtype;
 	int            ASformat;
 	int            VSformat;
 	const wchar_t* str;
@@ -23,9 +58,37 @@ struct FmtParams_t {
 	int            CDepth;
 	int            planes;
 	int            bitCount;
+	TransferFrameFn copyFrame; // generated at compile time from the other fields
 };
 
 const FmtParams_t& GetFormatParamsAviSynth(const int asFormat);
 const FmtParams_t& GetFormatParamsVapourSynth(const int vsVideoFormat);
+const FmtParams_t& GetFormatParamsVapourSynth(const VSVideoFormat& vf);
+int GetVapourSynthVideoID(const VSVideoFormat& vf);
+
+// Returns the AviSynth+ pixel type with or without the alpha plane, or 0 if there is none.
+int GetASformatWithAlpha(const int asFormat);
+int GetASformatWithoutAlpha(const int asFormat);
+
+// Returns the output formats for the source format, the native format first.
+// Sources with alpha also get the formats without alpha, then come the dithered formats if enabled.
+std::vector<FmtParams_t> GetOutputFormats(const FmtParams_t& format, const int ditherMode);
+// Returns true if the output format carries the alpha plane of a source with alpha.
+bool IsOutputWithAlpha(const FmtParams_t& format);
+// Returns the row size in bytes of the output format for the buffer width in pixels.
+UINT GetOutputPitch(const FmtParams_t& format, const UINT width);
+// Returns the number of planes of the output format in a sample buffer with the pitch,
+// and the start, pitch, visible row size in bytes and number of rows of each plane.
+int GetOutputPlanes(const FmtParams_t& format, const BYTE* data, const UINT pitch, const UINT width, const UINT height,
+	const BYTE* planeData[4], int planePitch[4], int rowSize[4], int rows[4]);
+// Returns the index of the output format matching the media type, or -1.
+int FindOutputFormat(const std::vector<FmtParams_t>& formats, const CMediaType& mt);
+
+// Sets the picture aspect ratio from the sample aspect ratio and rcSource, or clears it if the SAR is invalid.
+void SetPictAspectRatio(VIDEOINFOHEADER2* vih2, const int64_t sarNum, const int64_t sarDen);
+
+// Fills the audio format of the output pins and the exported WAV files.
+void SetWaveFormatExtensible(WAVEFORMATEXTENSIBLE* wfex, const int channels, const int sampleRate, const int blockAlign,
+	const int bitsPerSample, const int validBitsPerSample, const GUID& subtype, const DWORD channelMask);
 
 std::unique_ptr<BYTE[]> GetBitmapWithText(const std::wstring& text, const long width, const long height);
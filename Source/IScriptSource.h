@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2024 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -11,3 +11,11 @@ IScriptSource : public IUnknown {
 	STDMETHOD_(bool, GetActive()) PURE;
 	STDMETHOD(GetScriptInfo) (std::wstring& str) PURE;
 };
+
+interface __declspec(uuid("65077677-7422-4162-8451-1A1217FE10DB"))
+IScriptSource2 : public IScriptSource {
+	// Returns the thumbnail of the frame at the time as top-down 32-bit RGB pixels.
+	// Thumbnails are rendered in the background by a secondary script instance,
+	// S_FALSE means that the thumbnail has been queued and should be requested again later.
+	STDMETHOD(GetThumbnail) (REFERENCE_TIME rt, UINT& width, UINT& height, std::vector<BYTE>& data) PURE;
+};
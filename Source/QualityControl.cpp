@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "QualityControl.h"
+
+//
+// CQualityControl
+//
+
+void CQualityControl::Reset()
+{
+	CAutoLock lock(&m_csLate);
+	m_rtLate = 0;
+}
+
+void CQualityControl::Notify(const Quality& q)
+{
+	CAutoLock lock(&m_csLate);
+	m_rtLate = q.Late;
+}
+
+int CQualityControl::GetFramesToSkip(const REFERENCE_TIME frameDuration, const int maxFrames)
+{
+	if (frameDuration <= 0 || maxFrames <= 0) {
+		return 0;
+	}
+
+	CAutoLock lock(&m_csLate);
+
+	// one frame of lateness is left to dropping cheap frames
+	if (m_rtLate <= 2 * frameDuration) {
+		return 0;
+	}
+
+	const int skip = (int)std::min<REFERENCE_TIME>({ m_rtLate / frameDuration - 1, kMaxSkipFrames, maxFrames });
+
+	// the next report comes only after the next frame is rendered
+	m_rtLate -= skip * frameDuration;
+	m_DroppedFrames += skip;
+
+	DLog(L"CQualityControl: skipped {} frames, {} in total", skip, m_DroppedFrames);
+
+	return skip;
+}
+
+bool CQualityControl::CanDropCheapFrame(const REFERENCE_TIME frameDuration) const
+{
+	CAutoLock lock(&m_csLate);
+	return frameDuration > 0 && m_rtLate > frameDuration / 2;
+}
+
+void CQualityControl::OnFrameDropped(const REFERENCE_TIME frameDuration)
+{
+	CAutoLock lock(&m_csLate);
+	m_rtLate -= frameDuration;
+	m_DroppedFrames++;
+}
+
+int64_t CQualityControl::GetDroppedFrames() const
+{
+	CAutoLock lock(&m_csLate);
+	return m_DroppedFrames;
+}
+
+//
+// CLatencyStats
+//
+
+void CLatencyStats::Add(const REFERENCE_TIME latency)
+{
+	CAutoLock lock(&m_csLatency);
+
+	if (m_Latencies.size() < kMaxLatencies) {
+		m_Latencies.emplace_back(latency);
+	} else {
+		m_Latencies[m_Next] = latency;
+	}
+	m_Next = (m_Next + 1) % kMaxLatencies;
+	m_Count++;
+}
+
+int64_t CLatencyStats::GetCount() const
+{
+	CAutoLock lock(&m_csLatency);
+	return m_Count;
+}
+
+REFERENCE_TIME CLatencyStats::GetPercentile(const int percentile) const
+{
+	std::vector<REFERENCE_TIME> latencies;
+	{
+		CAutoLock lock(&m_csLatency);
+		latencies = m_Latencies;
+	}
+	if (latencies.empty()) {
+		return 0;
+	}
+
+	const size_t rank = std::clamp<size_t>((latencies.size() * std::clamp(percentile, 1, 100) + 99) / 100, 1, latencies.size());
+	auto nth = latencies.begin() + (rank - 1);
+	std::nth_element(latencies.begin(), nth, latencies.end());
+
+	return *nth;
+}
+
+std::wstring CLatencyStats::GetInfo(const std::wstring_view name) const
+{
+	const int64_t count = GetCount();
+	if (!count) {
+		return {};
+	}
+
+	return std::format(L"{} latency [{}]: p50 {:.1f} ms, p90 {:.1f} ms, p99 {:.1f} ms",
+		name, count,
+		GetPercentile(50) / 10000.0,
+		GetPercentile(90) / 10000.0,
+		GetPercentile(99) / 10000.0);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <chrono>
+
+//
+// CQualityControl
+//
+// Tracks the lateness reported by the renderer through IQualityControl::Notify
+// and decides which frames the video stream skips to catch up.
+
+class CQualityControl
+{
+	mutable CCritSec m_csLate;
+
+	REFERENCE_TIME m_rtLate = 0; // last reported lateness minus the time already skipped
+	int64_t m_DroppedFrames = 0;
+
+public:
+	static constexpr int kMaxSkipFrames = 10; // per delivered frame
+
+	void Reset();
+	void Notify(const Quality& q);
+
+	// Returns the number of frames to skip without requesting them from the script.
+	int GetFramesToSkip(const REFERENCE_TIME frameDuration, const int maxFrames);
+	// Returns true if a frame that is cheap to skip (a B-frame) should be dropped.
+	bool CanDropCheapFrame(const REFERENCE_TIME frameDuration) const;
+	void OnFrameDropped(const REFERENCE_TIME frameDuration);
+
+	int64_t GetDroppedFrames() const;
+};
+
+//
+// CLatencyStats
+//
+// Keeps the most recent latencies of an operation for percentile reports.
+
+class CLatencyStats
+{
+	mutable CCritSec m_csLatency;
+
+	std::vector<REFERENCE_TIME> m_Latencies; // ring buffer
+	size_t  m_Next  = 0;
+	int64_t m_Count = 0;
+
+public:
+	static constexpr size_t kMaxLatencies = 256;
+
+	void Add(const REFERENCE_TIME latency);
+
+	int64_t GetCount() const;
+	// Returns the nearest-rank percentile (1-100) of the kept latencies, or 0 if there are none.
+	REFERENCE_TIME GetPercentile(const int percentile) const;
+	std::wstring GetInfo(const std::wstring_view name) const;
+};
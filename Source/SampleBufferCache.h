@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <memory>
+
+//
+// CSampleBufferCache
+//
+// Remembers which content the sample buffers of the allocator hold, so a repeated frame is
+// not copied again into a buffer that already contains it. The key is the address of the
+// script frame, which stays unique while the reference is kept, or a hash of its content.
+// The buffers must not be modified downstream, so it is only used if enabled in the settings
+// or for the static error bitmap.
+
+class CSampleBufferCache
+{
+	struct Entry_t {
+		const BYTE* buffer;
+		uint64_t    key;
+		UINT        size; // data length
+		std::shared_ptr<const void> ref;
+	};
+
+	static constexpr size_t kMaxEntries = 16; // more than the allocators have buffers
+
+	std::vector<Entry_t> m_Entries;
+
+public:
+	// Returns the data length if the buffer holds the content with the key, otherwise 0.
+	UINT Find(const BYTE* buffer, const uint64_t key) const
+	{
+		for (const auto& entry : m_Entries) {
+			if (entry.buffer == buffer) {
+				return (entry.key == key) ? entry.size : 0;
+			}
+		}
+		return 0;
+	}
+
+	void Set(const BYTE* buffer, const uint64_t key, const UINT size, std::shared_ptr<const void> ref)
+	{
+		auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [buffer](const Entry_t& entry) {
+			return entry.buffer == buffer;
+		});
+		if (it == m_Entries.end()) {
+			if (m_Entries.size() >= kMaxEntries) {
+				m_Entries.erase(m_Entries.begin());
+			}
+			it = m_Entries.emplace(m_Entries.end());
+		}
+		*it = { buffer, key, size, std::move(ref) };
+	}
+
+	// The buffer was written with other content.
+	void Reset(const BYTE* buffer)
+	{
+		std::erase_if(m_Entries, [buffer](const Entry_t& entry) {
+			return entry.buffer == buffer;
+		});
+	}
+
+	// The output format or the allocator has changed.
+	void Clear() { m_Entries.clear(); }
+};
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include "Helper.h"
+#include "VUIOptions.h"
+
+struct ScriptVideoInfo_t {
+	FmtParams_t format = {}; // source format, format.copyFrame is the native transfer of the video stream
+	UINT width     = 0;
+	UINT height    = 0;
+	int  numFrames = 0;
+	int64_t fpsNum = 0;
+	int64_t fpsDen = 1;
+	int  planes    = 0; // number of source planes, packed formats have one
+	int  bitDepth  = 0; // per component
+	int  subsamplingW = 0; // log2 of the chroma subsampling
+	int  subsamplingH = 0;
+	bool bFloat    = false;
+	bool bYUV      = false;
+	bool bGray     = false;
+};
+
+struct ScriptFrame_t {
+	const BYTE* data[4] = {}; // Y,U,V,A or G,B,R,A order as passed to TransferFrameFn
+	int pitch[4] = {};
+	MediaTypeProps_t props;
+	int64_t fieldBased = 0; // 0 - progressive, 1 - bottom field first, 2 - top field first
+	std::shared_ptr<const void> ref; // keeps the script frame alive
+};
+
+//
+// CScriptReader
+//
+// Reads the video frames of a secondary script instance without pins for the command
+// line tools. The frames after the requested one are rendered ahead in the background.
+
+class CScriptReader
+{
+protected:
+	ScriptVideoInfo_t m_VideoInfo;
+
+public:
+	virtual ~CScriptReader() = default;
+
+	const ScriptVideoInfo_t& GetVideoInfo() const { return m_VideoInfo; }
+
+	virtual bool ReadFrame(const int frame, ScriptFrame_t& out) = 0;
+};
+
+struct ScriptAudioInfo_t {
+	WAVEFORMATEXTENSIBLE wfex = {}; // wBitsPerSample is the container size
+	int64_t numSamples = 0;
+	int chunkSamples = 0; // samples per media sample of the audio pin
+};
+
+//
+// CScriptAudioReader
+//
+// Reads the audio of a secondary script instance as interleaved samples in the format of the
+// audio output pin.
+
+class CScriptAudioReader
+{
+protected:
+	ScriptAudioInfo_t m_AudioInfo;
+
+public:
+	virtual ~CScriptAudioReader() = default;
+
+	const ScriptAudioInfo_t& GetAudioInfo() const { return m_AudioInfo; }
+
+	virtual bool ReadAudio(BYTE* dst, const int64_t start, const int count) = 0;
+};
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2024 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -40,6 +40,11 @@ CScriptSource::CScriptSource(LPUNKNOWN lpunk, HRESULT* phr)
 CScriptSource::~CScriptSource()
 {
 	DLog(L"~CScriptSource()");
+
+	// the pins use the script objects and may run background threads, so they go first
+	while (m_iPins > 0) {
+		delete m_paStreams[m_iPins - 1]; // the pin removes itself
+	}
 }
 
 STDMETHODIMP CScriptSource::NonDelegatingQueryInterface(REFIID riid, void** ppv)
@@ -51,10 +56,62 @@ STDMETHODIMP CScriptSource::NonDelegatingQueryInterface(REFIID riid, void** ppv)
 		QI(IAMFilterMiscFlags)
 		QI(ISpecifyPropertyPages)
 		QI(IScriptSource)
+		QI(IScriptSource2)
+		QI(IVideoFrameStep)
 		QI(IExFilterConfig)
 		__super::NonDelegatingQueryInterface(riid, ppv);
 }
 
+void CScriptSource::EnablePrefetch(const bool enable)
+{
+	if (m_pAviSynthFile) {
+		m_pAviSynthFile->EnablePrefetch(enable);
+	}
+	else if (m_pVapourSynthFile) {
+		m_pVapourSynthFile->EnablePrefetch(enable);
+	}
+}
+
+const CLatencyStats* CScriptSource::GetStepLatency() const
+{
+	if (m_pAviSynthFile) {
+		return m_pAviSynthFile->GetStepLatency();
+	}
+	if (m_pVapourSynthFile) {
+		return m_pVapourSynthFile->GetStepLatency();
+	}
+	return nullptr;
+}
+
+// IMediaFilter
+
+STDMETHODIMP CScriptSource::Stop()
+{
+	EnablePrefetch(false);
+
+	return __super::Stop();
+}
+
+STDMETHODIMP CScriptSource::Pause()
+{
+	HRESULT hr = __super::Pause();
+	if (SUCCEEDED(hr)) {
+		// the neighbours of the shown frame are rendered for frame stepping
+		EnablePrefetch(true);
+	}
+
+	return hr;
+}
+
+STDMETHODIMP CScriptSource::Run(REFERENCE_TIME tStart)
+{
+	// CBaseFilter::Run goes through Pause when the filter is stopped
+	HRESULT hr = __super::Run(tStart);
+	EnablePrefetch(false);
+
+	return hr;
+}
+
 // IFileSourceFilter
 
 STDMETHODIMP CScriptSource::Load(LPCOLESTR pszFileName, const AM_MEDIA_TYPE* pmt)
@@ -70,10 +127,10 @@ STDMETHODIMP CScriptSource::Load(LPCOLESTR pszFileName, const AM_MEDIA_TYPE* pmt
 
 	HRESULT hr = S_OK;
 	if (ext == L".avs") {
-		m_pAviSynthFile.reset(new(std::nothrow) CAviSynthFile(pszFileName, this, &hr));
+		m_pAviSynthFile.reset(new(std::nothrow) CAviSynthFile(pszFileName, m_Settings, this, &hr));
 	}
 	else if (ext == L".vpy") {
-		m_pVapourSynthFile.reset(new(std::nothrow) CVapourSynthFile(pszFileName, this, &hr));
+		m_pVapourSynthFile.reset(new(std::nothrow) CVapourSynthFile(pszFileName, m_Settings, this, &hr));
 	}
 	else {
 		return E_INVALIDARG;
@@ -141,6 +198,15 @@ STDMETHODIMP CScriptSource::GetScriptInfo(std::wstring& str)
 		}
 		else if (m_pVapourSynthFile) {
 			str.assign(m_pVapourSynthFile->GetInfo());
+			if (m_pVapourSynthFile->IsProfiling()) {
+				str.append(m_pVapourSynthFile->GetProfileInfo());
+			}
+		}
+		if (auto pStepLatency = GetStepLatency(); pStepLatency && pStepLatency->GetCount()) {
+			if (!str.empty() && str.back() != L'\n') {
+				str += L'\n';
+			}
+			str.append(pStepLatency->GetInfo(L"Frame step"));
 		}
 		return S_OK;
 	} else {
@@ -149,6 +215,79 @@ STDMETHODIMP CScriptSource::GetScriptInfo(std::wstring& str)
 	}
 }
 
+// IScriptSource2
+
+STDMETHODIMP CScriptSource::GetThumbnail(REFERENCE_TIME rt, UINT& width, UINT& height, std::vector<BYTE>& data)
+{
+	int frame = -1;
+	if (m_pAviSynthFile) {
+		frame = m_pAviSynthFile->GetFrameNumber(rt);
+	}
+	else if (m_pVapourSynthFile) {
+		frame = m_pVapourSynthFile->GetFrameNumber(rt);
+	}
+	if (frame < 0) {
+		return E_ABORT;
+	}
+
+	CAutoLock lock(&m_csThumbnailer);
+
+	if (!m_pThumbnailer) {
+		// the main script instance is never used, so thumbnails do not seek or stall playback
+		m_pThumbnailer.reset(new CThumbnailer([fn = m_fn, settings = m_Settings, bAviSynth = !!m_pAviSynthFile]() {
+			HRESULT hr = E_FAIL;
+			std::unique_ptr<CThumbnailRenderer> pRenderer;
+			if (bAviSynth) {
+				pRenderer.reset(new(std::nothrow) CAviSynthThumbnailRenderer(fn.c_str(), settings, settings.iThumbnailWidth, &hr));
+			} else {
+				pRenderer.reset(new(std::nothrow) CVapourSynthThumbnailRenderer(fn.c_str(), settings, settings.iThumbnailWidth, &hr));
+			}
+			if (FAILED(hr)) {
+				pRenderer.reset();
+			}
+			return pRenderer;
+		}));
+	}
+
+	return m_pThumbnailer->Get(frame, width, height, data);
+}
+
+// IVideoFrameStep
+
+STDMETHODIMP CScriptSource::Step(DWORD dwFrames, IUnknown* pStepObject)
+{
+	if (m_pAviSynthFile) {
+		return m_pAviSynthFile->Step(dwFrames);
+	}
+	if (m_pVapourSynthFile) {
+		return m_pVapourSynthFile->Step(dwFrames);
+	}
+	return E_NOTIMPL;
+}
+
+STDMETHODIMP CScriptSource::CanStep(long bMultiple, IUnknown* pStepObject)
+{
+	// any number of frames can be stepped
+	if (m_pAviSynthFile) {
+		return m_pAviSynthFile->CanStep();
+	}
+	if (m_pVapourSynthFile) {
+		return m_pVapourSynthFile->CanStep();
+	}
+	return S_FALSE;
+}
+
+STDMETHODIMP CScriptSource::CancelStep()
+{
+	if (m_pAviSynthFile) {
+		return m_pAviSynthFile->CancelStep();
+	}
+	if (m_pVapourSynthFile) {
+		return m_pVapourSynthFile->CancelStep();
+	}
+	return S_FALSE;
+}
+
 // IExFilterConfig
 
 STDMETHODIMP CScriptSource::Flt_GetInt64(LPCSTR field, __int64 *value)
@@ -163,5 +302,182 @@ STDMETHODIMP CScriptSource::Flt_GetInt64(LPCSTR field, __int64 *value)
 		return S_OK;
 	}
 
+	if (!strcmp(field, "droppedFrames")) {
+		if (m_pAviSynthFile) {
+			*value = m_pAviSynthFile->GetDroppedFrames();
+		}
+		else if (m_pVapourSynthFile) {
+			*value = m_pVapourSynthFile->GetDroppedFrames();
+		}
+		else {
+			return E_ABORT;
+		}
+		return S_OK;
+	}
+
+	// in 100 ns units
+	static constexpr std::pair<const char*, int> stepLatencyFields[] = {
+		{ "stepLatencyP50", 50 },
+		{ "stepLatencyP90", 90 },
+		{ "stepLatencyP99", 99 },
+	};
+	for (const auto& [name, percentile] : stepLatencyFields) {
+		if (!strcmp(field, name)) {
+			auto pStepLatency = GetStepLatency();
+			if (!pStepLatency) {
+				return E_ABORT;
+			}
+			*value = pStepLatency->GetPercentile(percentile);
+			return S_OK;
+		}
+	}
+
+	return E_INVALIDARG;
+}
+
+STDMETHODIMP CScriptSource::Flt_GetInt(LPCSTR field, int* value)
+{
+	CheckPointer(value, E_POINTER);
+
+	if (!strcmp(field, "ditherMode")) {
+		*value = m_Settings.iDitherMode;
+		return S_OK;
+	}
+	if (!strcmp(field, "maxRenderFps")) {
+		*value = m_Settings.iMaxRenderFps;
+		return S_OK;
+	}
+	if (!strcmp(field, "prefetchFrames")) {
+		*value = m_Settings.iPrefetchFrames;
+		return S_OK;
+	}
+	if (!strcmp(field, "thumbnailWidth")) {
+		*value = m_Settings.iThumbnailWidth;
+		return S_OK;
+	}
+	if (!strcmp(field, "duplicateFrames")) {
+		*value = m_Settings.iDuplicateFrames;
+		return S_OK;
+	}
+
+	return E_INVALIDARG;
+}
+
+// The string is allocated with LocalAlloc, the caller frees it with LocalFree.
+static HRESULT AllocString(const std::wstring& str, LPWSTR* value, unsigned* chars)
+{
+	*chars = (unsigned)str.size();
+	*value = (LPWSTR)LocalAlloc(LPTR, (str.size() + 1) * sizeof(WCHAR));
+	if (!*value) {
+		return E_OUTOFMEMORY;
+	}
+	memcpy(*value, str.c_str(), (str.size() + 1) * sizeof(WCHAR));
+
+	return S_OK;
+}
+
+STDMETHODIMP CScriptSource::Flt_GetString(LPCSTR field, LPWSTR* value, unsigned* chars)
+{
+	CheckPointer(value, E_POINTER);
+	CheckPointer(chars, E_POINTER);
+
+	if (!strcmp(field, "vsProfile")) {
+		if (!m_pVapourSynthFile || !m_pVapourSynthFile->IsProfiling()) {
+			return E_ABORT;
+		}
+
+		return AllocString(ConvertUtf8ToWide(m_pVapourSynthFile->GetProfileJson()), value, chars);
+	}
+
+	if (!strcmp(field, "frameHashes")) {
+		if (!m_Settings.bFrameHashes) {
+			return E_ABORT;
+		}
+		if (m_pAviSynthFile) {
+			return AllocString(m_pAviSynthFile->GetHashManifest(), value, chars);
+		}
+		if (m_pVapourSynthFile) {
+			return AllocString(m_pVapourSynthFile->GetHashManifest(), value, chars);
+		}
+		return E_ABORT;
+	}
+
+	return E_INVALIDARG;
+}
+
+STDMETHODIMP CScriptSource::Flt_SetBool(LPCSTR field, bool value)
+{
+	if (!strcmp(field, "vsProfiling")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the VapourSynth core is created in Load
+		}
+		m_Settings.bVSProfiling = value;
+		return S_OK;
+	}
+	if (!strcmp(field, "frameHashes")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the settings are passed to the streams in Load
+		}
+		m_Settings.bFrameHashes = value;
+		return S_OK;
+	}
+
+	return E_INVALIDARG;
+}
+
+STDMETHODIMP CScriptSource::Flt_SetInt(LPCSTR field, int value)
+{
+	if (!strcmp(field, "ditherMode")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the output formats are created in Load
+		}
+		if (value < DITHER_NONE || value >= DITHER_COUNT) {
+			return E_INVALIDARG;
+		}
+		m_Settings.iDitherMode = value;
+		return S_OK;
+	}
+	if (!strcmp(field, "maxRenderFps")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the settings are passed to the streams in Load
+		}
+		if (value < 0 || value > 1000) {
+			return E_INVALIDARG;
+		}
+		m_Settings.iMaxRenderFps = value;
+		return S_OK;
+	}
+	if (!strcmp(field, "prefetchFrames")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the settings are passed to the streams in Load
+		}
+		if (value < 0 || value > 16) {
+			return E_INVALIDARG;
+		}
+		m_Settings.iPrefetchFrames = value;
+		return S_OK;
+	}
+	if (!strcmp(field, "duplicateFrames")) {
+		if (GetPinCount() > 0) {
+			return VFW_E_WRONG_STATE; // the settings are passed to the streams in Load
+		}
+		if (value < DUPLICATE_COPY || value >= DUPLICATE_COUNT) {
+			return E_INVALIDARG;
+		}
+		m_Settings.iDuplicateFrames = value;
+		return S_OK;
+	}
+	if (!strcmp(field, "thumbnailWidth")) {
+		CAutoLock lock(&m_csThumbnailer);
+		if (m_pThumbnailer) {
+			return VFW_E_WRONG_STATE; // the thumbnail script instance is already opened
+		}
+		if (value < 32 || value > 1024) {
+			return E_INVALIDARG;
+		}
+		m_Settings.iThumbnailWidth = value;
+		return S_OK;
+	}
+
 	return E_INVALIDARG;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2024 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -23,7 +23,8 @@ class __declspec(uuid(STR_CLSID_ScriptSource))
 	, public IFileSourceFilter
 	, public IAMFilterMiscFlags
 	, public ISpecifyPropertyPages
-	, public IScriptSource
+	, public IScriptSource2
+	, public IVideoFrameStep
 	, public CExFilterConfigImpl
 {
 private:
@@ -32,9 +33,18 @@ private:
 
 	std::wstring m_fn;
 
+	// settings that must be set before Load
+	Settings_t m_Settings;
+
 	std::unique_ptr<CAviSynthFile> m_pAviSynthFile;
 	std::unique_ptr<CVapourSynthFile> m_pVapourSynthFile;
 
+	CCritSec m_csThumbnailer;
+	std::unique_ptr<CThumbnailer> m_pThumbnailer; // created on the first thumbnail request
+
+	void EnablePrefetch(const bool enable);
+	const CLatencyStats* GetStepLatency() const;
+
 public:
 	CScriptSource(LPUNKNOWN lpunk, HRESULT* phr);
 	~CScriptSource();
@@ -42,6 +52,11 @@ public:
 	DECLARE_IUNKNOWN
 	STDMETHODIMP NonDelegatingQueryInterface(REFIID riid, void** ppv);
 
+	// IMediaFilter
+	STDMETHODIMP Stop() override;
+	STDMETHODIMP Pause() override;
+	STDMETHODIMP Run(REFERENCE_TIME tStart) override;
+
 	// IFileSourceFilter
 	STDMETHODIMP Load(LPCOLESTR pszFileName, const AM_MEDIA_TYPE* pmt);
 	STDMETHODIMP GetCurFile(LPOLESTR* ppszFileName, AM_MEDIA_TYPE* pmt);
@@ -56,6 +71,18 @@ public:
 	STDMETHODIMP_(bool) GetActive();
 	STDMETHODIMP GetScriptInfo(std::wstring& str);
 
+	// IScriptSource2
+	STDMETHODIMP GetThumbnail(REFERENCE_TIME rt, UINT& width, UINT& height, std::vector<BYTE>& data);
+
+	// IVideoFrameStep
+	STDMETHODIMP Step(DWORD dwFrames, IUnknown* pStepObject);
+	STDMETHODIMP CanStep(long bMultiple, IUnknown* pStepObject);
+	STDMETHODIMP CancelStep();
+
 	// IExFilterConfig
 	STDMETHODIMP Flt_GetInt64(LPCSTR field, __int64* value) override;
+	STDMETHODIMP Flt_GetString(LPCSTR field, LPWSTR* value, unsigned* chars) override;
+	STDMETHODIMP Flt_GetInt(LPCSTR field, int* value) override;
+	STDMETHODIMP Flt_SetBool(LPCSTR field, bool value) override;
+	STDMETHODIMP Flt_SetInt(LPCSTR field, int value) override;
 };
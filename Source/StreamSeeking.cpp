@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "StreamSeeking.h"
+
+//
+// CStreamSeeking
+//
+
+CStreamSeeking::CStreamSeeking(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT* phr, CCritSec* pLock, const GUID& unitFormat)
+	: CSourceSeeking(pName, pUnk, phr, pLock)
+	, m_UnitFormat(unitFormat)
+{
+}
+
+HRESULT CStreamSeeking::Convert(LONGLONG& target, const GUID& targetFormat, const LONGLONG source, const GUID& sourceFormat) const
+{
+	if (targetFormat == sourceFormat) {
+		target = source;
+		return S_OK;
+	}
+	if (targetFormat == TIME_FORMAT_MEDIA_TIME && sourceFormat == m_UnitFormat) {
+		target = UnitsToTime(source);
+		return S_OK;
+	}
+	if (targetFormat == m_UnitFormat && sourceFormat == TIME_FORMAT_MEDIA_TIME) {
+		target = TimeToUnits(source);
+		return S_OK;
+	}
+
+	return E_INVALIDARG;
+}
+
+STDMETHODIMP CStreamSeeking::IsFormatSupported(const GUID* pFormat)
+{
+	CheckPointer(pFormat, E_POINTER);
+
+	return (*pFormat == TIME_FORMAT_MEDIA_TIME || *pFormat == m_UnitFormat) ? S_OK : S_FALSE;
+}
+
+STDMETHODIMP CStreamSeeking::SetTimeFormat(const GUID* pFormat)
+{
+	CheckPointer(pFormat, E_POINTER);
+
+	if (IsFormatSupported(pFormat) != S_OK) {
+		return E_INVALIDARG;
+	}
+
+	CAutoLock lock(m_pLock);
+	m_TimeFormat = *pFormat;
+
+	return S_OK;
+}
+
+STDMETHODIMP CStreamSeeking::IsUsingTimeFormat(const GUID* pFormat)
+{
+	CheckPointer(pFormat, E_POINTER);
+
+	CAutoLock lock(m_pLock);
+	return (*pFormat == m_TimeFormat) ? S_OK : S_FALSE;
+}
+
+STDMETHODIMP CStreamSeeking::GetTimeFormat(GUID* pFormat)
+{
+	CheckPointer(pFormat, E_POINTER);
+
+	CAutoLock lock(m_pLock);
+	*pFormat = m_TimeFormat;
+
+	return S_OK;
+}
+
+STDMETHODIMP CStreamSeeking::GetDuration(LONGLONG* pDuration)
+{
+	CheckPointer(pDuration, E_POINTER);
+
+	CAutoLock lock(m_pLock);
+	return Convert(*pDuration, m_TimeFormat, m_rtDuration, TIME_FORMAT_MEDIA_TIME);
+}
+
+STDMETHODIMP CStreamSeeking::GetStopPosition(LONGLONG* pStop)
+{
+	CheckPointer(pStop, E_POINTER);
+
+	CAutoLock lock(m_pLock);
+	return Convert(*pStop, m_TimeFormat, m_rtStop, TIME_FORMAT_MEDIA_TIME);
+}
+
+STDMETHODIMP CStreamSeeking::ConvertTimeFormat(LONGLONG* pTarget, const GUID* pTargetFormat, LONGLONG Source, const GUID* pSourceFormat)
+{
+	CheckPointer(pTarget, E_POINTER);
+
+	CAutoLock lock(m_pLock);
+	return Convert(*pTarget, pTargetFormat ? *pTargetFormat : m_TimeFormat, Source, pSourceFormat ? *pSourceFormat : m_TimeFormat);
+}
+
+STDMETHODIMP CStreamSeeking::SetPositions(LONGLONG* pCurrent, DWORD CurrentFlags, LONGLONG* pStop, DWORD StopFlags)
+{
+	const DWORD StartPosBits = CurrentFlags & AM_SEEKING_PositioningBitsMask;
+	const DWORD StopPosBits  = StopFlags & AM_SEEKING_PositioningBitsMask;
+
+	if (StartPosBits) {
+		CheckPointer(pCurrent, E_POINTER);
+		if (StartPosBits != AM_SEEKING_AbsolutePositioning && StartPosBits != AM_SEEKING_RelativePositioning) {
+			return E_INVALIDARG;
+		}
+	}
+	if (StopPosBits) {
+		CheckPointer(pStop, E_POINTER);
+		if (StopPosBits != AM_SEEKING_AbsolutePositioning && StopPosBits != AM_SEEKING_RelativePositioning
+				&& StopPosBits != AM_SEEKING_IncrementalPositioning) {
+			return E_INVALIDARG;
+		}
+	}
+
+	{
+		CAutoLock lock(m_pLock);
+
+		const bool bUnits = (m_TimeFormat == m_UnitFormat);
+
+		if (StartPosBits) {
+			if (bUnits) {
+				m_StartUnit = (StartPosBits == AM_SEEKING_RelativePositioning) ? m_StartUnit + *pCurrent : *pCurrent;
+				m_StartUnit = std::max<int64_t>(m_StartUnit, 0);
+				WaitStartPosition(m_StartUnit, true);
+				m_rtStart = UnitsToTime(m_StartUnit);
+			}
+			else {
+				m_rtStart = (StartPosBits == AM_SEEKING_RelativePositioning) ? (REFERENCE_TIME)m_rtStart + *pCurrent : *pCurrent;
+				WaitStartPosition(std::max<REFERENCE_TIME>(m_rtStart, 0), false);
+				m_StartUnit = TimeToUnits(std::max<REFERENCE_TIME>(m_rtStart, 0));
+			}
+			if (CurrentFlags & AM_SEEKING_ReturnTime) {
+				*pCurrent = bUnits ? m_StartUnit : (REFERENCE_TIME)m_rtStart;
+			}
+		}
+
+		if (StopPosBits) {
+			if (bUnits) {
+				int64_t stopUnit = TimeToUnits(m_rtStop);
+				switch (StopPosBits) {
+				case AM_SEEKING_AbsolutePositioning:    stopUnit = *pStop; break;
+				case AM_SEEKING_RelativePositioning:    stopUnit += *pStop; break;
+				case AM_SEEKING_IncrementalPositioning: stopUnit = m_StartUnit + *pStop; break;
+				}
+				m_rtStop = UnitsToTime(stopUnit);
+			}
+			else {
+				switch (StopPosBits) {
+				case AM_SEEKING_AbsolutePositioning:    m_rtStop = *pStop; break;
+				case AM_SEEKING_RelativePositioning:    m_rtStop = (REFERENCE_TIME)m_rtStop + *pStop; break;
+				case AM_SEEKING_IncrementalPositioning: m_rtStop = (REFERENCE_TIME)m_rtStart + *pStop; break;
+				}
+			}
+			if (StopFlags & AM_SEEKING_ReturnTime) {
+				*pStop = bUnits ? TimeToUnits(m_rtStop) : (REFERENCE_TIME)m_rtStop;
+			}
+		}
+	}
+
+	HRESULT hr = S_OK;
+	if (StopPosBits) {
+		hr = ChangeStop();
+	}
+	if (StartPosBits) {
+		hr = ChangeStart();
+	}
+
+	return hr;
+}
+
+STDMETHODIMP CStreamSeeking::GetPositions(LONGLONG* pCurrent, LONGLONG* pStop)
+{
+	CAutoLock lock(m_pLock);
+
+	const bool bUnits = (m_TimeFormat == m_UnitFormat);
+	if (pCurrent) {
+		*pCurrent = bUnits ? m_StartUnit : (REFERENCE_TIME)m_rtStart;
+	}
+	if (pStop) {
+		*pStop = bUnits ? TimeToUnits(m_rtStop) : (REFERENCE_TIME)m_rtStop;
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+//
+// CStreamSeeking
+//
+// CSourceSeeking with a second time format in the units of the stream, TIME_FORMAT_FRAME
+// for video and TIME_FORMAT_SAMPLE for audio. A start position set in these units is kept
+// exactly in m_StartUnit, so a seek lands on the requested frame or sample without a round
+// trip through the media time.
+
+class CStreamSeeking : public CSourceSeeking
+{
+private:
+	const GUID m_UnitFormat;
+	GUID m_TimeFormat = TIME_FORMAT_MEDIA_TIME;
+
+	HRESULT Convert(LONGLONG& target, const GUID& targetFormat, const LONGLONG source, const GUID& sourceFormat) const;
+
+protected:
+	int64_t m_StartUnit = 0; // start position in stream units, requires m_pLock
+	uint64_t m_SeekGeneration = 0; // changed by every position change, requires m_pLock
+
+	CStreamSeeking(LPCTSTR pName, LPUNKNOWN pUnk, HRESULT* phr, CCritSec* pLock, const GUID& unitFormat);
+
+	virtual REFERENCE_TIME UnitsToTime(const int64_t units) const = 0;
+	virtual int64_t TimeToUnits(const REFERENCE_TIME rt) const = 0; // round down
+	// Called with m_pLock before a new start position is converted to the other format.
+	// A stream whose conversion is not exact yet waits until it is.
+	virtual void WaitStartPosition(const LONGLONG position, const bool bUnits) {}
+
+public:
+	// IMediaSeeking
+	STDMETHODIMP IsFormatSupported(const GUID* pFormat) override;
+	STDMETHODIMP SetTimeFormat(const GUID* pFormat) override;
+	STDMETHODIMP IsUsingTimeFormat(const GUID* pFormat) override;
+	STDMETHODIMP GetTimeFormat(GUID* pFormat) override;
+	STDMETHODIMP GetDuration(LONGLONG* pDuration) override;
+	STDMETHODIMP GetStopPosition(LONGLONG* pStop) override;
+	STDMETHODIMP ConvertTimeFormat(LONGLONG* pTarget, const GUID* pTargetFormat, LONGLONG Source, const GUID* pSourceFormat) override;
+	STDMETHODIMP SetPositions(LONGLONG* pCurrent, DWORD CurrentFlags, LONGLONG* pStop, DWORD StopFlags) override;
+	STDMETHODIMP GetPositions(LONGLONG* pCurrent, LONGLONG* pStop) override;
+};
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "Thumbnailer.h"
+
+//
+// CThumbnailRenderer
+//
+
+UINT CThumbnailRenderer::GetThumbnailHeight(const UINT thumbWidth, const int srcWidth, const int srcHeight)
+{
+	if (srcWidth <= 0 || srcHeight <= 0) {
+		return 0;
+	}
+
+	const UINT height = (UINT)llMulDiv(thumbWidth, srcHeight, srcWidth, 0) & ~1u;
+
+	return std::max(height, 2u);
+}
+
+//
+// CThumbnailStore
+//
+
+void CThumbnailStore::Init(const size_t tileSize, const size_t maxBytes)
+{
+	m_TileSize = tileSize;
+	m_MaxTiles = tileSize ? std::max<size_t>(maxBytes / tileSize, 1) : 0;
+	m_Data.reset(new(std::nothrow) BYTE[m_TileSize * m_MaxTiles]);
+	if (!m_Data) {
+		m_MaxTiles = 0;
+	}
+	m_Tiles.clear();
+	m_Tiles.reserve(m_MaxTiles);
+	m_Index.clear();
+	m_UseCounter = 0;
+}
+
+bool CThumbnailStore::Get(const int frame, BYTE* dst)
+{
+	auto it = m_Index.find(frame);
+	if (it == m_Index.end()) {
+		return false;
+	}
+
+	m_Tiles[it->second].lastUse = ++m_UseCounter;
+	memcpy(dst, m_Data.get() + it->second * m_TileSize, m_TileSize);
+
+	return true;
+}
+
+void CThumbnailStore::Put(const int frame, const BYTE* src)
+{
+	if (!m_MaxTiles) {
+		return;
+	}
+
+	size_t tile;
+	if (auto it = m_Index.find(frame); it != m_Index.end()) {
+		tile = it->second;
+	}
+	else if (m_Tiles.size() < m_MaxTiles) {
+		tile = m_Tiles.size();
+		m_Tiles.emplace_back(Tile_t{ frame, 0 });
+		m_Index.emplace(frame, tile);
+	}
+	else {
+		auto lru = std::min_element(m_Tiles.cbegin(), m_Tiles.cend(), [](const Tile_t& a, const Tile_t& b) {
+			return a.lastUse < b.lastUse;
+		});
+		tile = lru - m_Tiles.cbegin();
+		m_Index.erase(lru->frame);
+		m_Tiles[tile].frame = frame;
+		m_Index.emplace(frame, tile);
+	}
+
+	m_Tiles[tile].lastUse = ++m_UseCounter;
+	memcpy(m_Data.get() + tile * m_TileSize, src, m_TileSize);
+}
+
+//
+// CThumbnailer
+//
+
+CThumbnailer::CThumbnailer(OpenRendererFn openRenderer)
+	: m_OpenRenderer(std::move(openRenderer))
+{
+	m_Thread = std::thread(&CThumbnailer::ThreadProc, this);
+}
+
+CThumbnailer::~CThumbnailer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_cv.notify_all();
+
+	if (m_Thread.joinable()) {
+		m_Thread.join();
+	}
+}
+
+void CThumbnailer::ThreadProc()
+{
+	// thumbnails must not take time away from playback
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_cv.wait(lock, [this] {
+		return m_bStop || !m_Pending.empty();
+	});
+	if (m_bStop) {
+		return;
+	}
+
+	// the script instance is opened and destroyed on this thread
+	lock.unlock();
+	const ULONGLONG startTick = GetTickCount64();
+	std::unique_ptr<CThumbnailRenderer> pRenderer = m_OpenRenderer();
+	lock.lock();
+
+	if (!pRenderer) {
+		DLog(L"CThumbnailer: failed to open the script");
+		m_bFailed = true;
+		m_Pending.clear();
+		m_cv.notify_all();
+		return;
+	}
+
+	m_Width  = pRenderer->GetWidth();
+	m_Height = pRenderer->GetHeight();
+	m_Store.Init((size_t)m_Width * m_Height * 4, kMaxStoreBytes);
+	m_bOpened = true;
+	DLog(L"CThumbnailer: script opened in {} ms, thumbnail size {}x{}", GetTickCount64() - startTick, m_Width, m_Height);
+
+	std::vector<BYTE> data((size_t)m_Width * m_Height * 4);
+
+	for (;;) {
+		m_cv.wait(lock, [this] {
+			return m_bStop || !m_Pending.empty();
+		});
+		if (m_bStop) {
+			break;
+		}
+
+		const int frame = m_Pending.back();
+		m_Pending.pop_back();
+		if (m_Store.Contains(frame)) {
+			continue;
+		}
+
+		lock.unlock();
+		const bool ok = pRenderer->Render(frame, data.data());
+		lock.lock();
+
+		if (ok) {
+			m_Store.Put(frame, data.data());
+		} else {
+			DLog(L"CThumbnailer: failed to render frame {}", frame);
+		}
+	}
+
+	lock.unlock();
+	pRenderer.reset();
+}
+
+HRESULT CThumbnailer::Get(const int frame, UINT& width, UINT& height, std::vector<BYTE>& data)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_bFailed) {
+		return E_FAIL;
+	}
+
+	if (m_bOpened) {
+		data.resize((size_t)m_Width * m_Height * 4);
+		if (m_Store.Get(frame, data.data())) {
+			width  = m_Width;
+			height = m_Height;
+			return S_OK;
+		}
+		data.clear();
+	}
+
+	if (std::find(m_Pending.cbegin(), m_Pending.cend(), frame) == m_Pending.cend()) {
+		if (m_Pending.size() >= kMaxPending) {
+			m_Pending.pop_front();
+		}
+		m_Pending.emplace_back(frame);
+		m_cv.notify_all();
+	}
+
+	return S_FALSE;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+
+//
+// CThumbnailRenderer
+//
+// A secondary script instance without pins that renders the frames downscaled
+// to the thumbnail size. It must be created and used on one thread.
+
+class CThumbnailRenderer
+{
+protected:
+	UINT m_Width  = 0;
+	UINT m_Height = 0;
+	int  m_NumFrames = 0;
+
+public:
+	virtual ~CThumbnailRenderer() = default;
+
+	UINT GetWidth() const { return m_Width; }
+	UINT GetHeight() const { return m_Height; }
+	int GetNumFrames() const { return m_NumFrames; }
+
+	// Renders the frame as top-down 32-bit BGR pixels (m_Width * 4 bytes per row).
+	virtual bool Render(const int frame, BYTE* dst) = 0;
+
+	// Returns the thumbnail height for the source size, rounded down to even.
+	static UINT GetThumbnailHeight(const UINT thumbWidth, const int srcWidth, const int srcHeight);
+};
+
+//
+// CThumbnailStore
+//
+// Fixed-size tiles in one block of memory. The least recently used tile is replaced when the store is full.
+
+class CThumbnailStore
+{
+	struct Tile_t {
+		int      frame;
+		uint64_t lastUse;
+	};
+
+	size_t m_TileSize = 0;
+	size_t m_MaxTiles = 0;
+	std::unique_ptr<BYTE[]> m_Data;
+	std::vector<Tile_t> m_Tiles;
+	std::unordered_map<int, size_t> m_Index; // frame -> tile
+	uint64_t m_UseCounter = 0;
+
+public:
+	void Init(const size_t tileSize, const size_t maxBytes);
+
+	bool Contains(const int frame) const { return m_Index.contains(frame); }
+	bool Get(const int frame, BYTE* dst);
+	void Put(const int frame, const BYTE* src);
+};
+
+//
+// CThumbnailer
+//
+// Renders thumbnails on a thread with the lowest priority, so that playback of the main
+// script instance is not affected. The renderer is opened on the first request.
+// Only the most recent requests are kept, the older ones are dropped.
+
+class CThumbnailer
+{
+public:
+	typedef std::function<std::unique_ptr<CThumbnailRenderer>()> OpenRendererFn;
+
+	static constexpr size_t kMaxPending    = 8;
+	static constexpr size_t kMaxStoreBytes = 16 * 1024 * 1024;
+
+private:
+	std::mutex              m_mutex;
+	std::condition_variable m_cv;
+
+	OpenRendererFn m_OpenRenderer;
+	std::deque<int> m_Pending; // the newest request is rendered first
+	CThumbnailStore m_Store;
+	UINT m_Width    = 0;
+	UINT m_Height   = 0;
+	bool m_bOpened  = false;
+	bool m_bFailed  = false; // the renderer could not be opened
+	bool m_bStop    = false;
+
+	std::thread m_Thread;
+
+	void ThreadProc();
+
+public:
+	CThumbnailer(OpenRendererFn openRenderer);
+	~CThumbnailer();
+
+	// Returns S_OK with the thumbnail, S_FALSE if it has been queued for rendering,
+	// or E_FAIL if the script cannot be opened for thumbnails.
+	HRESULT Get(const int frame, UINT& width, UINT& height, std::vector<BYTE>& data);
+};
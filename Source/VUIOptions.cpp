@@ -5,6 +5,7 @@
  */
 
 #include "stdafx.h"
+#include <array>
 #include <fstream>
 #include <d3d9types.h>
 #include <dxva2api.h>
@@ -12,30 +13,126 @@
 #include "Helper.h"
 #include "VUIOptions.h"
 
+// Perfect hash of the frame property names. The seed is searched at compile time
+// so that every known name gets its own slot.
+
+constexpr size_t s_FramePropSlotCount = 64;
+
+constexpr uint32_t HashFramePropKey(const char* key, const uint32_t seed)
+{
+	// FNV-1a
+	uint32_t hash = seed;
+	while (*key) {
+		hash = (hash ^ (uint8_t)*key++) * 16777619u;
+	}
+	// the low bits of FNV-1a only depend on the low bits of the seed and the key, the slot needs the high bits too
+	return hash ^ (hash >> 15);
+}
+
+constexpr bool IsPerfectFramePropSeed(const uint32_t seed)
+{
+	bool used[s_FramePropSlotCount] = {};
+	for (const char* name : s_FramePropNames) {
+		const size_t slot = HashFramePropKey(name, seed) % s_FramePropSlotCount;
+		if (used[slot]) {
+			return false;
+		}
+		used[slot] = true;
+	}
+	return true;
+}
+
+constexpr uint32_t FindFramePropSeed()
+{
+	uint32_t seed = 2166136261u;
+	while (!IsPerfectFramePropSeed(seed)) {
+		seed++;
+	}
+	return seed;
+}
+
+static constexpr uint32_t s_FramePropSeed = FindFramePropSeed();
+
+constexpr auto MakeFramePropSlots()
+{
+	std::array<int8_t, s_FramePropSlotCount> slots = {};
+	for (auto& slot : slots) {
+		slot = FP_Unknown;
+	}
+	for (int id = 0; id < FP_COUNT; id++) {
+		slots[HashFramePropKey(s_FramePropNames[id], s_FramePropSeed) % s_FramePropSlotCount] = (int8_t)id;
+	}
+	return slots;
+}
+
+static constexpr auto s_FramePropSlots = MakeFramePropSlots();
+
+constexpr bool IsSameFramePropKey(const char* a, const char* b)
+{
+	while (*a && *a == *b) {
+		a++;
+		b++;
+	}
+	return *a == *b;
+}
+
+constexpr FrameProp FindFramePropId(const char* keyName)
+{
+	const int id = s_FramePropSlots[HashFramePropKey(keyName, s_FramePropSeed) % s_FramePropSlotCount];
+	if (id >= 0 && IsSameFramePropKey(keyName, s_FramePropNames[id])) {
+		return (FrameProp)id;
+	}
+	return FP_Unknown;
+}
+
+constexpr bool ValidateFramePropIds()
+{
+	for (int id = 0; id < FP_COUNT; id++) {
+		if (FindFramePropId(s_FramePropNames[id]) != id) {
+			return false;
+		}
+	}
+	// prefixes, extensions and other keys of the hosts
+	for (const char* key : { "", "_", "_Matri", "_Matrix_", "_matrix", "_SARNumX", "_Combed", "_AbsoluteTime", "_SceneChangePrev", "_Alpha" }) {
+		if (FindFramePropId(key) != FP_Unknown) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(ValidateFramePropIds(), "Frame property names do not round-trip through the key table");
+
+FrameProp GetFramePropId(const char* keyName)
+{
+	return FindFramePropId(keyName);
+}
+
 // Rec. ITU-T H.264
 // https://www.itu.int/itu-t/recommendations/rec.aspx?rec=14659
 
-bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t value)
+bool SetColorInfoFromFrameProp(UINT& extFmtValue, const FrameProp id, int64_t value)
 {
 	DXVA2_ExtendedFormat exFmt;
 	exFmt.value = extFmtValue;
 
-	if (strcmp(keyName, "_ChromaLocation") == 0) {
+	switch (id) {
+	case FP_ChromaLocation:
 		// 0=left, 1=center, 2=topleft, 3=top, 4=bottomleft, 5=bottom.
 		switch (value) {
 		case 0: exFmt.VideoChromaSubsampling = DXVA2_VideoChromaSubsampling_MPEG2;   break;
 		case 1: exFmt.VideoChromaSubsampling = DXVA2_VideoChromaSubsampling_MPEG1;   break;
 		case 2: exFmt.VideoChromaSubsampling = DXVA2_VideoChromaSubsampling_Cosited; break;
 		}
-	}
-	else if (strcmp(keyName, "_ColorRange") == 0) {
+		break;
+	case FP_ColorRange:
 		// 0=full range, 1=limited range
 		switch (value) {
 		case 0: exFmt.NominalRange = DXVA2_NominalRange_0_255;  break;
 		case 1: exFmt.NominalRange = DXVA2_NominalRange_16_235; break;
 		}
-	}
-	else if (strcmp(keyName, "_Primaries") == 0) {
+		break;
+	case FP_Primaries:
 		switch (value) {
 		case 1:  exFmt.VideoPrimaries = DXVA2_VideoPrimaries_BT709;         break;
 		case 4:  exFmt.VideoPrimaries = DXVA2_VideoPrimaries_BT470_2_SysM;  break;
@@ -46,8 +143,8 @@ bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t
 		case 10: exFmt.VideoPrimaries = MFVideoPrimaries_XYZ;               break;
 		case 11: exFmt.VideoPrimaries = MFVideoPrimaries_DCI_P3;            break;
 		}
-	}
-	else if (strcmp(keyName, "_Matrix") == 0) {
+		break;
+	case FP_Matrix:
 		switch (value) {
 		case 1:  exFmt.VideoTransferMatrix = DXVA2_VideoTransferMatrix_BT709;     break;
 		case 4:  exFmt.VideoTransferMatrix = VIDEOTRANSFERMATRIX_FCC;             break;
@@ -58,8 +155,8 @@ bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t
 		case 10:
 		case 11: exFmt.VideoTransferMatrix = MFVideoTransferMatrix_BT2020_10;     break;
 		}
-	}
-	else if (strcmp(keyName, "_Transfer") == 0) {
+		break;
+	case FP_Transfer:
 		switch (value) {
 		case 1:
 		case 6:
@@ -74,6 +171,7 @@ bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t
 		case 16: exFmt.VideoTransferFunction = MFVideoTransFunc_2084;     break;
 		case 18: exFmt.VideoTransferFunction = MFVideoTransFunc_HLG;      break;
 		}
+		break;
 	}
 
 	if (exFmt.value != extFmtValue) {
@@ -85,6 +183,70 @@ bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t
 	}
 }
 
+bool SetHdrMetadataFromFrameProp(HdrMetadata_t& hdr, const FrameProp id, const int index, const double value)
+{
+	switch (id) {
+	case FP_ContentLightLevelMax:         hdr.maxCLL       = (int64_t)value; break;
+	case FP_ContentLightLevelAverage:     hdr.maxFALL      = (int64_t)value; break;
+	case FP_MasteringDisplayMinLuminance: hdr.minLuminance = value;          break;
+	case FP_MasteringDisplayMaxLuminance: hdr.maxLuminance = value;          break;
+	case FP_MasteringDisplayWhitePointX:  hdr.whitePointX  = value;          break;
+	case FP_MasteringDisplayWhitePointY:  hdr.whitePointY  = value;          break;
+	case FP_MasteringDisplayPrimariesX:
+		if (index < 0 || index >= 3) {
+			return false;
+		}
+		hdr.primariesX[index] = value;
+		break;
+	case FP_MasteringDisplayPrimariesY:
+		if (index < 0 || index >= 3) {
+			return false;
+		}
+		hdr.primariesY[index] = value;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+std::wstring HdrMetadata_t::GetInfo() const
+{
+	std::wstring str = std::format(L"HDR: MaxCLL {}, MaxFALL {}", maxCLL, maxFALL);
+	if (maxLuminance > 0) {
+		str += std::format(L", mastering display {:.4f}-{:.0f} cd/m2, white point {:.4f},{:.4f}",
+			minLuminance, maxLuminance, whitePointX, whitePointY);
+	}
+	return str;
+}
+
+void FrameProps_t::SetInt(const FrameProp id, const int64_t value)
+{
+	switch (id) {
+	case FP_DurationNum: durNum     = value; break;
+	case FP_DurationDen: durDen     = value; break;
+	case FP_FieldBased:  fieldBased = value; break;
+	default:
+		if (const int i = MediaTypeProps_t::IndexOf(id); i >= 0) {
+			mediaType.values[i] = value;
+		}
+	}
+}
+
+UINT MediaTypeProps_t::GetColorInfo() const
+{
+	UINT color_info = 0;
+	for (size_t i = 0; i < std::size(ids); i++) {
+		// the SAR is not part of the color info and is ignored
+		if (values[i] != missing) {
+			SetColorInfoFromFrameProp(color_info, ids[i], values[i]);
+		}
+	}
+
+	return color_info ? (color_info | AMCONTROL_USED | AMCONTROL_COLORINFO_PRESENT) : 0;
+}
+
 /*
 "Video Usability Info" https://code.videolan.org/videolan/x264/-/blob/master/x264.c
 
@@ -6,6 +6,127 @@
 
 #pragma once
 
-bool SetColorInfoFromFrameFrops(UINT& extFmtValue, const char* keyName, int64_t value);
+// Frame properties known to the filter
+enum FrameProp : int {
+	FP_Unknown = -1,
+	FP_ChromaLocation = 0,
+	FP_ColorRange,
+	FP_Primaries,
+	FP_Matrix,
+	FP_Transfer,
+	FP_SARNum,
+	FP_SARDen,
+	FP_PictType,
+	FP_DurationNum,
+	FP_DurationDen,
+	FP_FieldBased,
+	// HDR metadata
+	FP_ContentLightLevelMax,
+	FP_ContentLightLevelAverage,
+	FP_MasteringDisplayMinLuminance,
+	FP_MasteringDisplayMaxLuminance,
+	FP_MasteringDisplayPrimariesX,
+	FP_MasteringDisplayPrimariesY,
+	FP_MasteringDisplayWhitePointX,
+	FP_MasteringDisplayWhitePointY,
+	FP_COUNT
+};
+
+inline constexpr const char* s_FramePropNames[FP_COUNT] = {
+	"_ChromaLocation",
+	"_ColorRange",
+	"_Primaries",
+	"_Matrix",
+	"_Transfer",
+	"_SARNum",
+	"_SARDen",
+	"_PictType",
+	"_DurationNum",
+	"_DurationDen",
+	"_FieldBased",
+	"ContentLightLevelMax",
+	"ContentLightLevelAverage",
+	"MasteringDisplayMinLuminance",
+	"MasteringDisplayMaxLuminance",
+	"MasteringDisplayPrimariesX",
+	"MasteringDisplayPrimariesY",
+	"MasteringDisplayWhitePointX",
+	"MasteringDisplayWhitePointY",
+};
+
+// Returns the id of the frame property key using a perfect hash, so any key costs one string compare.
+FrameProp GetFramePropId(const char* keyName);
+
+bool SetColorInfoFromFrameProp(UINT& extFmtValue, const FrameProp id, int64_t value);
+
+struct HdrMetadata_t {
+	int64_t maxCLL  = 0; // cd/m2
+	int64_t maxFALL = 0;
+	double minLuminance = 0; // mastering display, cd/m2
+	double maxLuminance = 0;
+	double primariesX[3] = {}; // R, G, B
+	double primariesY[3] = {};
+	double whitePointX = 0;
+	double whitePointY = 0;
+
+	bool IsValid() const { return maxCLL > 0 || maxLuminance > 0; }
+	std::wstring GetInfo() const;
+};
+
+// Sets a value of the HDR metadata. Returns false for other frame properties.
+bool SetHdrMetadataFromFrameProp(HdrMetadata_t& hdr, const FrameProp id, const int index, const double value);
+
+// Frame properties that are reflected in the media type.
+// FillBuffer compares them with the previous frame to detect changes.
+struct MediaTypeProps_t {
+	static constexpr FrameProp ids[] = {
+		FP_ChromaLocation, FP_ColorRange, FP_Primaries, FP_Matrix, FP_Transfer, // color info
+		FP_SARNum, FP_SARDen
+	};
+	static constexpr int64_t missing = INT64_MIN;
+
+	// Returns the index of the property in values, or -1.
+	static constexpr int IndexOf(const FrameProp id)
+	{
+		for (size_t i = 0; i < std::size(ids); i++) {
+			if (ids[i] == id) {
+				return (int)i;
+			}
+		}
+		return -1;
+	}
+
+	int64_t values[std::size(ids)];
+
+	MediaTypeProps_t() { std::fill(std::begin(values), std::end(values), missing); }
+
+	bool operator==(const MediaTypeProps_t&) const = default;
+
+	template <FrameProp Id>
+	int64_t Get() const
+	{
+		static_assert(IndexOf(Id) >= 0, "The frame property is not in MediaTypeProps_t");
+		return values[IndexOf(Id)];
+	}
+
+	UINT GetColorInfo() const; // dwControlFlags value
+	int64_t GetSarNum() const { return Get<FP_SARNum>() != missing ? Get<FP_SARNum>() : 0; }
+	int64_t GetSarDen() const { return Get<FP_SARDen>() != missing ? Get<FP_SARDen>() : 0; }
+};
+
+// Frame properties that are read from every frame. The keys of the frame are walked once
+// and each known key is dispatched on its FrameProp id.
+struct FrameProps_t {
+	MediaTypeProps_t mediaType;
+	int64_t durNum     = 0; // frame duration in seconds
+	int64_t durDen     = 0;
+	int64_t fieldBased = 0;
+	char    pictType   = 0;
+
+	void SetInt(const FrameProp id, const int64_t value);
+	bool HasDuration() const { return durNum > 0 && durDen > 0; }
+	// B-frames of the source are not referenced by other frames, so they are the first to drop
+	bool IsCheapToSkip() const { return pictType == 'B' || pictType == 'b'; }
+};
 
 bool SetColorInfoFromVUIOptions(UINT& extFmtValue, LPCWSTR scriptfile);
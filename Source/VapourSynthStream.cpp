@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2025 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -9,6 +9,7 @@
 #include "ScriptSource.h"
 
 #include "VapourSynthStream.h"
+#include "FrameTransfer.h"
 
 #include <mmreg.h>
 
@@ -16,7 +17,9 @@
  // CVapourSynthFile
  //
 
-CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT* phr)
+CVapourSynthFile::CVapourSynthFile(const WCHAR* name, const Settings_t& settings, CSource* pParent, HRESULT* phr)
+	: m_Settings(settings)
+	, m_pHashManifest(settings.bFrameHashes ? new CHashManifest : nullptr)
 {
 	try {
 		m_hVSScriptDll = LoadLibraryW(L"vsscript.dll");
@@ -50,7 +53,12 @@ CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT*
 	std::wstring error;
 
 	try {
-		m_vsScript = m_vsScriptAPI->createScript(nullptr);
+		if (m_Settings.bVSProfiling) {
+			VSCore* vsCore = m_vsAPI->createCore(ccfEnableGraphInspection);
+			m_vsScript = m_vsScriptAPI->createScript(vsCore); // takes ownership of the core
+		} else {
+			m_vsScript = m_vsScriptAPI->createScript(nullptr);
+		}
 		//m_vsScriptAPI->evalSetWorkingDir(m_vsScript, 1);
 
 		std::string utf8file = ConvertWideToUtf8(name);
@@ -61,6 +69,19 @@ CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT*
 
 		SetVSNodes();
 
+		if (m_Settings.bVSProfiling) {
+			InitProfileNodes();
+		}
+
+		if (!pParent) {
+			// a secondary instance without pins for the thumbnails and the command line tools
+			if (!m_vsNodeVideo && !m_vsNodeAudio) {
+				throw std::exception("VapourSynth script does not return video or audio");
+			}
+			*phr = S_OK;
+			return;
+		}
+
 		if (m_vsNodeVideo) {
 			auto pVideoStream = new CVapourSynthVideoStream(this, pParent, &hr);
 			if (FAILED(hr)) {
@@ -71,6 +92,7 @@ CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT*
 			else {
 				m_FileInfo.append(pVideoStream->GetInfo());
 				m_FileInfo += (L'\n');
+				m_pVideoStream = pVideoStream;
 			}
 		}
 
@@ -91,7 +113,7 @@ CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT*
 		hr = E_FAIL;
 		DLog(ConvertAnsiToWide(e.what()));
 
-		if (error.length()) {
+		if (error.length() && pParent) {
 			DLog(error);
 			new CAviSynthVideoStream(error, pParent, &hr);
 			if (SUCCEEDED(hr)) {
@@ -105,10 +127,16 @@ CVapourSynthFile::CVapourSynthFile(const WCHAR* name, CSource* pParent, HRESULT*
 
 CVapourSynthFile::~CVapourSynthFile()
 {
+	m_ProfileNodes.clear();
+
 	if (m_vsNodeVideo) {
 		m_vsAPI->freeNode(m_vsNodeVideo);
 		m_vsNodeVideo = nullptr;
 	}
+	if (m_vsNodeAlpha) {
+		m_vsAPI->freeNode(m_vsNodeAlpha);
+		m_vsNodeAlpha = nullptr;
+	}
 	if (m_vsNodeAudio) {
 		m_vsAPI->freeNode(m_vsNodeAudio);
 		m_vsNodeAudio = nullptr;
@@ -126,6 +154,48 @@ CVapourSynthFile::~CVapourSynthFile()
 	}
 }
 
+int64_t CVapourSynthFile::GetDroppedFrames() const
+{
+	return m_pVideoStream ? m_pVideoStream->GetDroppedFrames() : 0;
+}
+
+std::wstring CVapourSynthFile::GetHashManifest() const
+{
+	return m_pHashManifest ? m_pHashManifest->GetText() : std::wstring();
+}
+
+void CVapourSynthFile::EnablePrefetch(const bool enable)
+{
+	if (m_pVideoStream) {
+		m_pVideoStream->EnablePrefetch(enable);
+	}
+}
+
+HRESULT CVapourSynthFile::Step(const DWORD frames)
+{
+	return m_pVideoStream ? m_pVideoStream->Step(frames) : E_NOTIMPL;
+}
+
+HRESULT CVapourSynthFile::CanStep() const
+{
+	return m_pVideoStream ? m_pVideoStream->CanStep() : S_FALSE;
+}
+
+HRESULT CVapourSynthFile::CancelStep()
+{
+	return m_pVideoStream ? m_pVideoStream->CancelStep() : S_FALSE;
+}
+
+const CLatencyStats* CVapourSynthFile::GetStepLatency() const
+{
+	return m_pVideoStream ? &m_pVideoStream->GetStepLatency() : nullptr;
+}
+
+int CVapourSynthFile::GetFrameNumber(const REFERENCE_TIME rt) const
+{
+	return m_pVideoStream ? m_pVideoStream->GetFrameNumber(rt) : -1;
+}
+
 void CVapourSynthFile::SetVSNodes()
 {
 	VSNode* vsNode = m_vsScriptAPI->getOutputNode(m_vsScript, 0);
@@ -136,9 +206,7 @@ void CVapourSynthFile::SetVSNodes()
 	auto vi = m_vsAPI->getVideoInfo(vsNode);
 
 	if (vi && vi->format.colorFamily != cfUndefined && vi->width > 0 && vi->height > 0) {
-		const auto& vf = vi->format;
-		const auto videoID = ((vf.colorFamily << 28) | (vf.sampleType << 24) | (vf.bitsPerSample << 16) | (vf.subSamplingW << 8) | (vf.subSamplingH << 0));
-		auto& Format = GetFormatParamsVapourSynth(videoID);
+		auto& Format = GetFormatParamsVapourSynth(vi->format);
 		if (Format.fourcc == DWORD(-1)) {
 			char formatname[32] = {};
 			m_vsAPI->getVideoFormatName(&vi->format, formatname);
@@ -151,6 +219,21 @@ void CVapourSynthFile::SetVSNodes()
 
 		m_vsNodeVideo = vsNode;
 		vsNode = nullptr;
+
+		// the alpha clip must be a grayscale clip with the same size and sample type
+		VSNode* vsNodeAlpha = m_vsScriptAPI->getOutputAlphaNode(m_vsScript, 0);
+		if (vsNodeAlpha) {
+			auto vi_alpha = m_vsAPI->getVideoInfo(vsNodeAlpha);
+			if (vi_alpha && vi_alpha->format.colorFamily == cfGray
+					&& vi_alpha->format.sampleType == vi->format.sampleType
+					&& vi_alpha->format.bitsPerSample == vi->format.bitsPerSample
+					&& vi_alpha->width == vi->width && vi_alpha->height == vi->height) {
+				m_vsNodeAlpha = vsNodeAlpha;
+			} else {
+				DLog(L"VapourSynth alpha output node is ignored, it does not match the video node");
+				m_vsAPI->freeNode(vsNodeAlpha);
+			}
+		}
 	}
 
 	if (!vsNode) {
@@ -170,13 +253,266 @@ void CVapourSynthFile::SetVSNodes()
 	}
 }
 
+void CVapourSynthFile::InitProfileNodes()
+{
+	// Walk the dependency graph of the output nodes once. The graph does not change after
+	// the script has been evaluated, so only the filter times are polled later.
+	// A node shared with the video graph is counted as video.
+	const std::pair<VSNode*, ProfileOutput> outputs[] = {
+		{ m_vsNodeVideo, PROFILE_VIDEO },
+		{ m_vsNodeAlpha, PROFILE_ALPHA },
+		{ m_vsNodeAudio, PROFILE_AUDIO },
+	};
+
+	for (const auto& [outputNode, output] : outputs) {
+		std::vector<VSNode*> queue;
+		if (outputNode) {
+			queue.emplace_back(outputNode);
+		}
+
+		while (queue.size()) {
+			VSNode* node = queue.back();
+			queue.pop_back();
+
+			if (std::any_of(m_ProfileNodes.cbegin(), m_ProfileNodes.cend(), [node](const ProfileNode_t& item) { return item.node == node; })) {
+				continue;
+			}
+
+			const char* name = m_vsAPI->getNodeName(node);
+			m_ProfileNodes.emplace_back(node, name ? name : "", 0, output);
+
+			const VSFilterDependency* deps = m_vsAPI->getNodeDependencies(node);
+			const int numDeps = m_vsAPI->getNumNodeDependencies(node);
+			for (int i = 0; i < numDeps && deps; i++) {
+				if (deps[i].source) {
+					queue.emplace_back(deps[i].source);
+				}
+			}
+		}
+	}
+
+	DLog(L"VapourSynth profiling enabled, {} nodes", m_ProfileNodes.size());
+}
+
+void CVapourSynthFile::UpdateProfile(const int64_t frames, const int64_t alphaFrames)
+{
+	// Called from the video streaming thread after the frame is rendered. The prefetch, the
+	// frame request, the timeline index and the audio pin are quiesced: their new requests
+	// wait and the requests in flight are finished first.
+	std::unique_lock<std::mutex> lockRequests(m_mutexRequests);
+	m_bRequestsHeld = true;
+	m_cvRequests.wait(lockRequests, [this] { return m_RequestsInFlight == 0; });
+
+	{
+		CAutoLock lock(&m_csProfile);
+
+		for (auto& item : m_ProfileNodes) {
+			item.time_ns = m_vsAPI->getNodeFilterTime(item.node);
+		}
+		m_ProfileFrames      = frames;
+		m_ProfileAlphaFrames = alphaFrames;
+	}
+
+	m_bRequestsHeld = false;
+	m_cvRequests.notify_all();
+}
+
+void CVapourSynthFile::BeginFrameRequest()
+{
+	if (!m_Settings.bVSProfiling) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutexRequests);
+	m_cvRequests.wait(lock, [this] { return !m_bRequestsHeld; });
+	m_RequestsInFlight++;
+}
+
+void CVapourSynthFile::EndFrameRequest()
+{
+	if (!m_Settings.bVSProfiling) {
+		return;
+	}
+
+	// notified under the lock, UpdateProfile may return and the file be destroyed right after
+	std::lock_guard<std::mutex> lock(m_mutexRequests);
+	if (--m_RequestsInFlight == 0 && m_bRequestsHeld) {
+		m_cvRequests.notify_all();
+	}
+}
+
+const VSFrame* CVapourSynthFile::GetFrame(const int n, VSNode* node, char* errorMsg, const int bufSize)
+{
+	BeginFrameRequest();
+	const VSFrame* frame = m_vsAPI->getFrame(n, node, errorMsg, bufSize);
+	EndFrameRequest();
+
+	return frame;
+}
+
+double CVapourSynthFile::GetFrameBudget() const
+{
+	if (m_vsNodeVideo) {
+		auto vi = m_vsAPI->getVideoInfo(m_vsNodeVideo);
+		if (vi && vi->fpsNum > 0 && vi->fpsDen > 0) {
+			return 1000.0 * vi->fpsDen / vi->fpsNum;
+		}
+	}
+	return 0.0;
+}
+
+double CVapourSynthFile::GetProfileFrameMs(const ProfileNode_t& item) const
+{
+	// the alpha node is only requested for the frames delivered with an alpha plane
+	const int64_t frames = (item.output == PROFILE_ALPHA) ? m_ProfileAlphaFrames : m_ProfileFrames;
+	return frames ? item.time_ns / 1000000.0 / frames : 0.0;
+}
+
+std::wstring CVapourSynthFile::GetProfileInfo() const
+{
+	CAutoLock lock(&m_csProfile);
+
+	if (m_ProfileNodes.empty()) {
+		return {};
+	}
+
+	const double frameBudget_ms = GetFrameBudget();
+
+	std::wstring str = std::format(L"Profiling [{} frames]:", m_ProfileFrames);
+	str += std::format(L"\n {:<18} {:>10} {:>10} {:>8}", L"filter", L"total ms", L"ms/frame", L"budget");
+
+	for (const auto& item : m_ProfileNodes) {
+		if (item.output == PROFILE_AUDIO) {
+			continue;
+		}
+		const double total_ms = item.time_ns / 1000000.0;
+		const double frame_ms = GetProfileFrameMs(item);
+		str += std::format(L"\n {:<18} {:>10.1f} {:>10.3f}", A2WStr(item.name), total_ms, frame_ms);
+		if (frameBudget_ms > 0) {
+			str += std::format(L" {:>7.1f}%", 100.0 * frame_ms / frameBudget_ms);
+		}
+	}
+
+	// the audio is not rendered per video frame, only the total time is shown
+	bool bAudio = false;
+	for (const auto& item : m_ProfileNodes) {
+		if (item.output == PROFILE_AUDIO) {
+			if (!bAudio) {
+				str += std::format(L"\n {:<18} {:>10}", L"audio filter", L"total ms");
+				bAudio = true;
+			}
+			str += std::format(L"\n {:<18} {:>10.1f}", A2WStr(item.name), item.time_ns / 1000000.0);
+		}
+	}
+
+	return str;
+}
+
+std::string CVapourSynthFile::GetProfileJson() const
+{
+	CAutoLock lock(&m_csProfile);
+
+	const double frameBudget_ms = GetFrameBudget();
+
+	std::string str = std::format("{{\"frames\":{},\"frameBudgetMs\":{:.3f},\"filters\":[", m_ProfileFrames, frameBudget_ms);
+	std::string audio;
+
+	for (const auto& item : m_ProfileNodes) {
+
+		std::string name;
+		for (const char c : item.name) {
+			if (c == '"' || c == '\\') {
+				name += '\\';
+			}
+			if ((unsigned char)c >= 0x20) {
+				name += c;
+			}
+		}
+
+		if (item.output == PROFILE_AUDIO) {
+			audio += std::format("{}{{\"name\":\"{}\",\"timeNs\":{}}}", audio.size() ? "," : "", name, item.time_ns);
+			continue;
+		}
+
+		const double frame_ms = GetProfileFrameMs(item);
+		str += std::format("{}{{\"name\":\"{}\",\"timeNs\":{},\"msPerFrame\":{:.3f},\"budgetShare\":{:.4f}}}",
+			str.back() == '[' ? "" : ",", name, item.time_ns, frame_ms, frameBudget_ms > 0 ? frame_ms / frameBudget_ms : 0.0);
+	}
+	str += "],\"audioFilters\":[" + audio + "]}";
+
+	return str;
+}
+
 //
 // CVapourSynthVideoStream
 //
 
+static void GetFrameProps(const VSAPI* vsAPI, const VSFrame* frame, FrameProps_t& props)
+{
+	const VSMap* vsMap = vsAPI->getFramePropertiesRO(frame);
+	if (!vsMap) {
+		return;
+	}
+
+	const int numKeys = vsAPI->mapNumKeys(vsMap);
+	for (int i = 0; i < numKeys; i++) {
+		const char* keyName = vsAPI->mapGetKey(vsMap, i);
+		const FrameProp id = keyName ? GetFramePropId(keyName) : FP_Unknown;
+		int err = 0;
+		switch (id) {
+		case FP_Unknown:
+			break;
+		case FP_PictType:
+			if (const char* pictType = vsAPI->mapGetData(vsMap, keyName, 0, &err); !err && pictType) {
+				props.pictType = pictType[0];
+			}
+			break;
+		default:
+			if (const int64_t value = vsAPI->mapGetInt(vsMap, keyName, 0, &err); !err) {
+				props.SetInt(id, value);
+			}
+		}
+	}
+}
+
+static VSFramePtr GetVideoFrame(const VSAPI* vsAPI, VSNode* node, const int n, char* errorMsg, const int bufSize)
+{
+	const VSFrame* frame = vsAPI->getFrame(n, node, errorMsg, bufSize);
+	if (!frame) {
+		return nullptr;
+	}
+
+	return VSFramePtr(frame, [vsAPI](const VSFrame* f) {
+		vsAPI->freeFrame(f);
+	});
+}
+
+struct FrameRequestContext_t {
+	const VSAPI* vsAPI;
+	CVapourSynthFile* pFile;
+	CFrameRequest<VSFramePtr>::CompleteFn complete;
+};
+
+static void VS_CC FrameRequestDoneCallback(void* userData, const VSFrame* f, int n, VSNode* node, const char* errorMsg)
+{
+	std::unique_ptr<FrameRequestContext_t> pContext(static_cast<FrameRequestContext_t*>(userData));
+	pContext->pFile->EndFrameRequest();
+
+	if (!f) {
+		DLog(L"CVapourSynthVideoStream: frame {} - {}", n, ConvertUtf8ToWide(errorMsg ? errorMsg : ""));
+		pContext->complete(false, nullptr);
+		return;
+	}
+
+	const VSAPI* vsAPI = pContext->vsAPI;
+	pContext->complete(true, VSFramePtr(f, [vsAPI](const VSFrame* p) {
+		vsAPI->freeFrame(p);
+	}));
+}
+
 CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthFile, CSource* pParent, HRESULT* phr)
 	: CSourceStream(L"Video", phr, pParent, L"Video")
-	, CSourceSeeking(L"Video", (IPin*)this, phr, &m_cSharedState)
+	, CStreamSeeking(L"Video", (IPin*)this, phr, &m_cSharedState, TIME_FORMAT_FRAME)
 	, m_pVapourSynthFile(pVapourSynthFile)
 {
 	CAutoLock cAutoLock(&m_cSharedState);
@@ -187,9 +523,7 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 	try {
 		m_vsVideoInfo = m_pVapourSynthFile->m_vsAPI->getVideoInfo(m_pVapourSynthFile->m_vsNodeVideo);
 
-		const auto& vf = m_vsVideoInfo->format;
-		const auto videoID = ((vf.colorFamily << 28) | (vf.sampleType << 24) | (vf.bitsPerSample << 16) | (vf.subSamplingW << 8) | (vf.subSamplingH << 0));
-		m_Format = GetFormatParamsVapourSynth(videoID);
+		m_Format = GetFormatParamsVapourSynth(m_vsVideoInfo->format);
 
 		char formatname[32] = {};
 		m_pVapourSynthFile->m_vsAPI->getVideoFormatName(&m_vsVideoInfo->format, formatname);
@@ -198,20 +532,16 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 			throw std::exception(std::format("Unsuported pixel type {}", formatname).c_str());
 		}
 
+		if (m_pVapourSynthFile->m_vsNodeAlpha) {
+			auto& FormatAlpha = GetFormatParamsAviSynth(GetASformatWithAlpha(m_Format.ASformat));
+			if (FormatAlpha.fourcc != DWORD(-1)) {
+				m_Format = FormatAlpha;
+			}
+		}
+
 		m_Width = m_vsVideoInfo->width;
 		m_Height = m_vsVideoInfo->height;
-		m_fpsNum = m_vsVideoInfo->fpsNum;
-		m_fpsDen = m_vsVideoInfo->fpsDen;
 		m_NumFrames = m_vsVideoInfo->numFrames;
-		m_AvgTimePerFrame = llMulDiv(UNITS, m_fpsDen, m_fpsNum, 0);
-		m_rtDuration = m_rtStop = llMulDiv(UNITS * m_NumFrames, m_fpsDen, m_fpsNum, 0);
-
-		UINT color_info = 0;
-		m_StreamInfo = std::format(
-			L"Script type : VapourSynth\n"
-			L"Video stream: {} {}x{} {:.3f} fps",
-			m_Format.str, m_Width, m_Height, (double)m_fpsNum / m_fpsDen
-		);
 
 		const VSFrame* frame = m_pVapourSynthFile->m_vsAPI->getFrame(0, m_pVapourSynthFile->m_vsNodeVideo, m_vsErrorMessage, sizeof(m_vsErrorMessage));
 		if (!frame) {
@@ -222,6 +552,57 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 		m_PitchBuff = m_Pitch;
 		m_BufferSize = m_PitchBuff * m_Height * m_Format.buffCoeff / 2;
 
+		FrameProps_t props;
+		GetFrameProps(m_pVapourSynthFile->m_vsAPI, frame, props);
+
+		if (m_vsVideoInfo->fpsNum > 0 && m_vsVideoInfo->fpsDen > 0) {
+			m_fpsNum = m_vsVideoInfo->fpsNum;
+			m_fpsDen = m_vsVideoInfo->fpsDen;
+			m_Timeline.Init(m_NumFrames, m_fpsNum, m_fpsDen);
+		}
+		else {
+			// variable frame rate, the duration of the first frame is used as the nominal frame rate
+			if (props.HasDuration()) {
+				m_fpsNum = props.durDen;
+				m_fpsDen = props.durNum;
+			} else {
+				m_fpsNum = 25;
+				m_fpsDen = 1;
+			}
+			m_Timeline.InitVariable(m_NumFrames, m_fpsNum, m_fpsDen, [this](const int n, int64_t& num, int64_t& den) {
+				return ReadFrameDuration(n, num, den);
+			});
+		}
+		m_AvgTimePerFrame = llMulDiv(UNITS, m_fpsDen, m_fpsNum, 0);
+		m_rtDuration = m_rtStop = m_Timeline.GetDuration();
+
+		m_Prefetch.Start(m_NumFrames, m_pVapourSynthFile->m_Settings.iPrefetchFrames, [this](const int n, VSFramePtr& out) {
+			char errorMsg[1024];
+			m_pVapourSynthFile->BeginFrameRequest();
+			out = GetVideoFrame(m_pVapourSynthFile->m_vsAPI, m_pVapourSynthFile->m_vsNodeVideo, n, errorMsg, sizeof(errorMsg));
+			m_pVapourSynthFile->EndFrameRequest();
+			return out != nullptr;
+		});
+		m_FrameRequest.StartAsync([this](const int n, CFrameRequest<VSFramePtr>::CompleteFn complete) {
+			auto pContext = new FrameRequestContext_t{ m_pVapourSynthFile->m_vsAPI, m_pVapourSynthFile, std::move(complete) };
+			m_pVapourSynthFile->BeginFrameRequest();
+			m_pVapourSynthFile->m_vsAPI->getFrameAsync(n, m_pVapourSynthFile->m_vsNodeVideo, FrameRequestDoneCallback, pContext);
+		});
+		if (m_pVapourSynthFile->m_vsNodeAlpha) {
+			m_AlphaRequest.StartAsync([this](const int n, CFrameRequest<VSFramePtr>::CompleteFn complete) {
+				auto pContext = new FrameRequestContext_t{ m_pVapourSynthFile->m_vsAPI, m_pVapourSynthFile, std::move(complete) };
+				m_pVapourSynthFile->BeginFrameRequest();
+				m_pVapourSynthFile->m_vsAPI->getFrameAsync(n, m_pVapourSynthFile->m_vsNodeAlpha, FrameRequestDoneCallback, pContext);
+			});
+		}
+
+		UINT color_info = 0;
+		m_StreamInfo = std::format(
+			L"Script type : VapourSynth\n"
+			L"Video stream: {} {}x{} {:.3f} fps{}",
+			m_Format.str, m_Width, m_Height, (double)m_fpsNum / m_fpsDen, m_Timeline.IsVariable() ? L" (variable)" : L""
+		);
+
 		const VSMap* vsMap = m_pVapourSynthFile->m_vsAPI->getFramePropertiesRO(frame);
 		if (vsMap) {
 			int numKeys = m_pVapourSynthFile->m_vsAPI->mapNumKeys(vsMap);
@@ -229,6 +610,8 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 				m_StreamInfo += std::format(L"\nProperties [{}]:", numKeys);
 			}
 
+			HdrMetadata_t hdr;
+
 			for (int i = 0; i < numKeys; i++) {
 				const char* keyName = m_pVapourSynthFile->m_vsAPI->mapGetKey(vsMap, i);
 				if (keyName && keyName[0]) {
@@ -237,6 +620,7 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 					const char* val_Data = 0;
 					int err = 0;
 					const char keyType = m_pVapourSynthFile->m_vsAPI->mapGetType(vsMap, keyName);
+					const FrameProp id = GetFramePropId(keyName);
 
 					m_StreamInfo += std::format(L"\n{:>2}: ", i);
 
@@ -245,14 +629,15 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 						val_Int = m_pVapourSynthFile->m_vsAPI->mapGetInt(vsMap, keyName, 0, &err);
 						if (!err) {
 							m_StreamInfo += std::format(L"<i> '{}' = {}", A2WStr(keyName), val_Int);
-							if (strcmp(keyName, "_SARNum") == 0) {
-								m_Sar.num = val_Int;
-							}
-							else if (strcmp(keyName, "_SARDen") == 0) {
-								m_Sar.den = val_Int;
-							}
-							else {
-								SetColorInfoFromFrameFrops(color_info, keyName, val_Int);
+							switch (id) {
+							case FP_SARNum: m_Sar.num = val_Int; break;
+							case FP_SARDen: m_Sar.den = val_Int; break;
+							case FP_ContentLightLevelMax:
+							case FP_ContentLightLevelAverage:
+								SetHdrMetadataFromFrameProp(hdr, id, 0, (double)val_Int);
+								break;
+							default:
+								SetColorInfoFromFrameProp(color_info, id, val_Int);
 							}
 						}
 						break;
@@ -260,6 +645,15 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 						val_Float = m_pVapourSynthFile->m_vsAPI->mapGetFloat(vsMap, keyName, 0, &err);
 						if (!err) {
 							m_StreamInfo += std::format(L"<f> '{}' = {:.3f}", A2WStr(keyName), val_Float);
+							if (id != FP_Unknown) {
+								const int numElements = m_pVapourSynthFile->m_vsAPI->mapNumElements(vsMap, keyName);
+								for (int k = 0; k < numElements; k++) {
+									val_Float = m_pVapourSynthFile->m_vsAPI->mapGetFloat(vsMap, keyName, k, &err);
+									if (!err) {
+										SetHdrMetadataFromFrameProp(hdr, id, k, val_Float);
+									}
+								}
+							}
 						}
 						break;
 					case ptData:
@@ -267,7 +661,7 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 						if (!err) {
 							const int dataSize = m_pVapourSynthFile->m_vsAPI->mapGetDataSize(vsMap, keyName, 0, &err);
 							if (!err) {
-								if (dataSize == 1 && strcmp(keyName, "_PictType") == 0) {
+								if (dataSize == 1 && id == FP_PictType) {
 									m_StreamInfo += std::format(L"<b> '{}' = {}", A2WStr(keyName), val_Data[0]);
 								}
 								else {
@@ -279,7 +673,14 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 					}
 				}
 			}
+
+			if (hdr.IsValid()) {
+				m_StreamInfo += L"\n" + hdr.GetInfo();
+			}
 		}
+
+		m_Props = props.mediaType;
+
 		m_pVapourSynthFile->m_vsAPI->freeFrame(frame);
 
 		if (m_vsVideoInfo->format.colorFamily == cfRGB) {
@@ -288,25 +689,16 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 			m_Planes[1] = 2;
 			m_Planes[2] = 0;
 		}
-		else if (m_vsVideoInfo->format.colorFamily == cfYUV) {
-			if (m_Format.CDepth == 8) {
-				// swap U and V for YV12, YV16, YV24.
-				m_Planes[0] = 0;
-				m_Planes[1] = 2;
-				m_Planes[2] = 1;
-			}
-			else {
-				m_Planes[0] = 0;
-				m_Planes[1] = 1;
-				m_Planes[2] = 2;
-			}
-		}
 
 		if (color_info) {
 			m_ColorInfo = color_info | (AMCONTROL_USED | AMCONTROL_COLORINFO_PRESENT);
 		}
 
-		InitVideoMediaType();
+		m_OutputFormats = GetOutputFormats(m_Format, m_pVapourSynthFile->m_Settings.iDitherMode);
+		m_OutFormat = m_Format;
+		m_TransferFrame = m_OutFormat.copyFrame;
+		m_bOutputAlpha = (m_Format.planes == 4);
+		InitVideoMediaType(m_mt, m_OutFormat);
 
 		DLog(m_StreamInfo);
 
@@ -323,6 +715,10 @@ CVapourSynthVideoStream::CVapourSynthVideoStream(CVapourSynthFile* pVapourSynthF
 
 CVapourSynthVideoStream::~CVapourSynthVideoStream()
 {
+	m_AlphaRequest.Stop();
+	m_FrameRequest.Stop();
+	m_Prefetch.Stop();
+	m_Timeline.StopIndex();
 }
 
 STDMETHODIMP CVapourSynthVideoStream::NonDelegatingQueryInterface(REFIID riid, void** ppv)
@@ -338,7 +734,8 @@ HRESULT CVapourSynthVideoStream::OnThreadCreate()
 	CAutoLock cAutoLockShared(&m_cSharedState);
 
 	m_FrameCounter = 0;
-	m_CurrentFrame = (int)llMulDiv(m_rtStart, m_fpsNum, m_fpsDen * UNITS, 0); // round down
+	m_CurrentFrame = (int)std::min<int64_t>(m_StartUnit, m_NumFrames);
+	m_LastFrame = -1;
 
 	return CSourceStream::OnThreadCreate();
 }
@@ -346,6 +743,7 @@ HRESULT CVapourSynthVideoStream::OnThreadCreate()
 HRESULT CVapourSynthVideoStream::OnThreadStartPlay()
 {
 	m_bDiscontinuity = TRUE;
+	m_QualityControl.Reset();
 	return DeliverNewSegment(m_rtStart, m_rtStop, m_dRateSeeking);
 }
 
@@ -360,8 +758,13 @@ void CVapourSynthVideoStream::UpdateFromSeek()
 		m_bFlushing = TRUE;
 
 		DeliverBeginFlush();
+		// the delivery thread does not wait for the frame being rendered, a late frame is dropped
+		m_FrameRequest.Cancel();
+		m_AlphaRequest.Cancel();
 		// make sure we have stopped pushing
 		Stop();
+		m_FrameRequest.Reset();
+		m_AlphaRequest.Reset();
 		// complete the flush
 		DeliverEndFlush();
 
@@ -372,16 +775,68 @@ void CVapourSynthVideoStream::UpdateFromSeek()
 	}
 }
 
+bool CVapourSynthVideoStream::ReadFrameDuration(const int frame, int64_t& num, int64_t& den)
+{
+	// a request of its own, the core serves it next to the requests of the delivery
+	char errorMessage[256];
+	const VSFrame* vsFrame = m_pVapourSynthFile->GetFrame(frame, m_pVapourSynthFile->m_vsNodeVideo, errorMessage, sizeof(errorMessage));
+	if (!vsFrame) {
+		return false;
+	}
+
+	FrameProps_t props;
+	GetFrameProps(m_pVapourSynthFile->m_vsAPI, vsFrame, props);
+	m_pVapourSynthFile->m_vsAPI->freeFrame(vsFrame);
+	num = props.durNum;
+	den = props.durDen;
+
+	return props.HasDuration();
+}
+
+void CVapourSynthVideoStream::UpdateFromFrameProps(const MediaTypeProps_t& props, const int frame, IMediaSample* pSample)
+{
+	const UINT colorInfo = props.GetColorInfo();
+	const int64_t sarNum = props.GetSarNum();
+	const int64_t sarDen = props.GetSarDen();
+	if (colorInfo == m_ColorInfo && sarNum == m_Sar.num && sarDen == m_Sar.den) {
+		return;
+	}
+
+	CMediaType mt(m_mt);
+	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mt.Format();
+	vih2->dwControlFlags = colorInfo;
+	SetPictAspectRatio(vih2, sarNum, sarDen);
+
+	// the values describe the current media type, a rejected change leaves them as they are
+	if (m_Connected && m_Connected->QueryAccept(&mt) == S_OK && SUCCEEDED(pSample->SetMediaType(&mt))) {
+		DLog(L"CVapourSynthVideoStream: media type changed at frame {}", frame);
+		m_ColorInfo = colorInfo;
+		m_Sar.num = sarNum;
+		m_Sar.den = sarDen;
+		m_mt = mt;
+	}
+}
+
 HRESULT CVapourSynthVideoStream::SetRate(double dRate)
 {
-	if (dRate <= 0) {
+	if (dRate == 0) {
 		return E_INVALIDARG;
 	}
 
+	const bool bReverse = dRate < 0;
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
+		if (bReverse != (m_dRateSeeking < 0)) {
+			// the playback turns around at the shown frame
+			if (m_LastFrame >= 0) {
+				m_CurrentFrame = m_LastFrame + (bReverse ? -1 : 1);
+			}
+			m_FrameCounter = 0;
+			m_SeekGeneration++;
+		}
 		m_dRateSeeking = dRate;
 	}
+	m_Prefetch.SetReverse(bReverse);
 
 	UpdateFromSeek();
 
@@ -393,14 +848,40 @@ HRESULT CVapourSynthVideoStream::ChangeStart()
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
 		m_FrameCounter = 0;
-		m_CurrentFrame = (int)llMulDiv(m_rtStart, m_fpsNum, m_fpsDen * UNITS, 0); // round down
+		m_CurrentFrame = (int)std::min<int64_t>(m_StartUnit, m_NumFrames);
+		m_LastFrame = -1;
+		m_StepFrame = -1;
+		m_SeekGeneration++;
+		// the frames around the new position may already be in the window
+		m_Prefetch.MoveCursor(m_CurrentFrame);
 	}
+	m_QualityControl.Reset();
 
 	UpdateFromSeek();
 
 	return S_OK;
 }
 
+REFERENCE_TIME CVapourSynthVideoStream::UnitsToTime(const int64_t units) const
+{
+	return m_Timeline.GetFrameTime((int)std::clamp<int64_t>(units, 0, m_NumFrames));
+}
+
+int64_t CVapourSynthVideoStream::TimeToUnits(const REFERENCE_TIME rt) const
+{
+	return m_Timeline.GetFrameNumber(rt);
+}
+
+void CVapourSynthVideoStream::WaitStartPosition(const LONGLONG position, const bool bUnits)
+{
+	// the seek lands on the exact time of the frame, the delivery waits on m_pLock meanwhile
+	if (bUnits) {
+		m_Timeline.WaitIndexedFrame((int)std::clamp<int64_t>(position, 0, m_NumFrames));
+	} else {
+		m_Timeline.WaitIndexedTime(position);
+	}
+}
+
 HRESULT CVapourSynthVideoStream::ChangeStop()
 {
 	{
@@ -416,39 +897,35 @@ HRESULT CVapourSynthVideoStream::ChangeStop()
 	return S_OK;
 }
 
-void CVapourSynthVideoStream::InitVideoMediaType()
+void CVapourSynthVideoStream::InitVideoMediaType(CMediaType& mt, const FmtParams_t& format)
 {
-	m_mt.InitMediaType();
-	m_mt.SetType(&MEDIATYPE_Video);
-	m_mt.SetSubtype(&m_Format.subtype);
-	m_mt.SetFormatType(&FORMAT_VideoInfo2);
-	m_mt.SetTemporalCompression(FALSE);
-	m_mt.SetSampleSize(m_BufferSize);
-
-	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)m_mt.AllocFormatBuffer(sizeof(VIDEOINFOHEADER2));
+	// the buffer width in pixels is the source pitch
+	const UINT widthBuff = m_Pitch / m_Format.Packsize;
+	const UINT bufferSize = GetOutputPitch(format, widthBuff) * m_Height * format.buffCoeff / 2;
+
+	mt.InitMediaType();
+	mt.SetType(&MEDIATYPE_Video);
+	mt.SetSubtype(format.subtype);
+	mt.SetFormatType(&FORMAT_VideoInfo2);
+	mt.SetTemporalCompression(FALSE);
+	mt.SetSampleSize(bufferSize);
+
+	VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)mt.AllocFormatBuffer(sizeof(VIDEOINFOHEADER2));
 	ZeroMemory(vih2, sizeof(VIDEOINFOHEADER2));
 	vih2->rcSource = { 0, 0, (long)m_Width, (long)m_Height };
 	vih2->rcTarget = vih2->rcSource;
 	vih2->AvgTimePerFrame         = m_AvgTimePerFrame;
 	vih2->bmiHeader.biSize        = sizeof(vih2->bmiHeader);
-	vih2->bmiHeader.biWidth       = m_PitchBuff / m_Format.Packsize;
-	vih2->bmiHeader.biHeight      = (m_Format.fourcc == BI_RGB) ? -(long)m_Height : m_Height;
+	vih2->bmiHeader.biWidth       = widthBuff;
+	vih2->bmiHeader.biHeight      = (format.fourcc == BI_RGB) ? -(long)m_Height : m_Height;
 	vih2->bmiHeader.biPlanes      = 1;
-	vih2->bmiHeader.biBitCount    = m_Format.bitCount;
-	vih2->bmiHeader.biCompression = m_Format.fourcc;
-	vih2->bmiHeader.biSizeImage   = m_BufferSize;
+	vih2->bmiHeader.biBitCount    = format.bitCount;
+	vih2->bmiHeader.biCompression = format.fourcc;
+	vih2->bmiHeader.biSizeImage   = bufferSize;
 
 	vih2->dwControlFlags = m_ColorInfo;
 
-	if (m_Sar.num > 0 && m_Sar.den > 0 && m_Sar.num < INT16_MAX && m_Sar.den < INT16_MAX) {
-		auto parX = m_Sar.num * m_Width;
-		auto parY = m_Sar.den * m_Height;
-		const auto gcd = std::gcd(parX, parY);
-		parX /= gcd;
-		parY /= gcd;
-		vih2->dwPictAspectRatioX = parX;
-		vih2->dwPictAspectRatioY = parY;
-	}
+	SetPictAspectRatio(vih2, m_Sar.num, m_Sar.den);
 }
 
 HRESULT CVapourSynthVideoStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCATOR_PROPERTIES* pProperties)
@@ -473,44 +950,75 @@ HRESULT CVapourSynthVideoStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCAT
 	}
 	ASSERT(Actual.cBuffers == pProperties->cBuffers);
 
+	m_SampleCache.Clear(); // a new allocator
+
 	return NOERROR;
 }
 
 HRESULT CVapourSynthVideoStream::FillBuffer(IMediaSample* pSample)
 {
+	// the frame is rendered without the seeking lock, see CAviSynthVideoStream::FillBuffer
+	bool bReverse;
+	double rate;
+	int step;
+	int currentFrame;
+	int frameCounter;
+	uint64_t seekGeneration;
 	{
 		CAutoLock cAutoLockShared(&m_cSharedState);
 
-		if (m_CurrentFrame >= m_NumFrames) {
-			return S_FALSE;
-		}
+		// negative rates play backwards
+		bReverse = m_dRateSeeking < 0;
+		rate = std::abs(m_dRateSeeking);
 
-		AM_MEDIA_TYPE* pmt;
-		if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
-			CMediaType mt(*pmt);
-			SetMediaType(&mt);
-			DeleteMediaType(pmt);
+		if (bReverse && m_CurrentFrame >= m_NumFrames) {
+			m_CurrentFrame = m_NumFrames - 1; // started from the end
 		}
-
-		if (m_mt.formattype != FORMAT_VideoInfo2) {
+		if (bReverse ? m_CurrentFrame < 0 : m_CurrentFrame >= m_NumFrames) {
 			return S_FALSE;
 		}
 
-		BYTE* dst_data = nullptr;
-		HRESULT hr = pSample->GetPointer(&dst_data);
-		if (FAILED(hr) || !dst_data) {
-			return S_FALSE;
-		}
+		// fast forward renders only the frames needed for the display rate
+		step = m_BitmapError ? 1 : GetDecimationStep(rate, m_fpsNum, m_fpsDen, m_pVapourSynthFile->m_Settings.iMaxRenderFps);
 
-		long buffSize = pSample->GetSize();
-		if (buffSize < (long)m_BufferSize) {
-			return S_FALSE;
-		}
+		currentFrame   = m_CurrentFrame;
+		frameCounter   = m_FrameCounter;
+		seekGeneration = m_SeekGeneration;
+	}
+	const int dir = bReverse ? -1 : 1;
 
-		UINT DataLength = 0;
+	AM_MEDIA_TYPE* pmt;
+	if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
+		CMediaType mt(*pmt);
+		SetMediaType(&mt);
+		DeleteMediaType(pmt);
+	}
 
-		if (m_BitmapError) {
+	if (m_mt.formattype != FORMAT_VideoInfo2) {
+		return S_FALSE;
+	}
+
+	BYTE* dst_data = nullptr;
+	HRESULT hr = pSample->GetPointer(&dst_data);
+	if (FAILED(hr) || !dst_data) {
+		return S_FALSE;
+	}
+
+	long buffSize = pSample->GetSize();
+	if (buffSize < (long)m_BufferSize) {
+		return S_FALSE;
+	}
+
+	UINT DataLength = 0;
+	VSFramePtr frame;
+
+	if (m_BitmapError) {
+		// the bitmap does not change, a buffer that already holds it is not copied again
+		const uint64_t key = (uint64_t)(uintptr_t)m_BitmapError.get();
+		DataLength = m_SampleCache.Find(dst_data, key);
+		if (!DataLength) {
 			DataLength = m_PitchBuff * m_Height;
+			m_SampleCache.Set(dst_data, key, DataLength, nullptr);
 
 			const BYTE* src_data = m_BitmapError.get();
 			if (m_Pitch == m_PitchBuff) {
@@ -525,59 +1033,185 @@ HRESULT CVapourSynthVideoStream::FillBuffer(IMediaSample* pSample)
 				}
 			}
 		}
-		else {
-			const VSFrame* frame = m_pVapourSynthFile->m_vsAPI->getFrame(m_CurrentFrame, m_pVapourSynthFile->m_vsNodeVideo, m_vsErrorMessage, sizeof(m_vsErrorMessage));
-			if (!frame) {
-				DLog(ConvertUtf8ToWide(m_vsErrorMessage));
+	}
+	else {
+		// catch up with the renderer, the sample times stay relative to the first frame
+		const REFERENCE_TIME frameDuration = (REFERENCE_TIME)(m_AvgTimePerFrame * step / rate);
+		const int framesLeft = bReverse ? currentFrame : m_NumFrames - 1 - currentFrame;
+		const int skip = step * m_QualityControl.GetFramesToSkip(frameDuration, framesLeft / step);
+		frameCounter += skip;
+		currentFrame += dir * skip;
+
+		FrameProps_t props;
+		for (;;) {
+			if (!m_Prefetch.Get(currentFrame, frame)) {
+				hr = m_FrameRequest.Get(currentFrame, frame);
+				if (hr == E_ABORT) {
+					// the stream is flushed, the sample is discarded
+					pSample->SetActualDataLength(0);
+					return S_OK;
+				}
+				if (FAILED(hr)) {
+					return E_FAIL;
+				}
+			}
+
+			props = {};
+			GetFrameProps(m_pVapourSynthFile->m_vsAPI, frame.get(), props);
+
+			if ((bReverse ? currentFrame > 0 : currentFrame + 1 < m_NumFrames)
+					&& m_QualityControl.CanDropCheapFrame(frameDuration)
+					&& props.IsCheapToSkip()) {
+				m_QualityControl.OnFrameDropped(frameDuration);
+				frameCounter++;
+				currentFrame += dir;
+				continue;
+			}
+			break;
+		}
+
+		VSFramePtr frameAlpha;
+		if (m_bOutputAlpha) {
+			// requested like the frame, so that a flush does not wait for it either
+			hr = m_AlphaRequest.Get(currentFrame, frameAlpha);
+			if (hr == E_ABORT) {
+				pSample->SetActualDataLength(0);
+				return S_OK;
+			}
+			if (FAILED(hr)) {
 				return E_FAIL;
 			}
+		}
 
-			const int num_planes = m_vsVideoInfo->format.numPlanes;
-			for (int i = 0; i < num_planes; i++) {
-				const int plane = m_Planes[i];
-				const BYTE* src_data = m_pVapourSynthFile->m_vsAPI->getReadPtr(frame, plane);
-				int src_pitch = m_pVapourSynthFile->m_vsAPI->getStride(frame, plane);
-				const UINT height = m_pVapourSynthFile->m_vsAPI->getFrameHeight(frame, plane);
-				UINT dst_pitch = m_PitchBuff;
-				if (i > 0) {
-					dst_pitch >>= m_vsVideoInfo->format.subSamplingW;
-				}
+		if (!m_Timeline.IsIndexed(currentFrame)) {
+			// sequential playback helps the index
+			m_Timeline.AddFrameDuration(currentFrame, props.durNum, props.durDen);
+		}
 
-				if (m_Format.fourcc == BI_RGB) {
-					src_data += src_pitch * (height - 1);
-					src_pitch = -src_pitch;
-				}
+		if (props.mediaType != m_Props) {
+			m_Props = props.mediaType;
+			UpdateFromFrameProps(props.mediaType, currentFrame, pSample);
+		}
 
-				if (src_pitch == dst_pitch) {
-					memcpy(dst_data, src_data, dst_pitch * height);
-					dst_data += dst_pitch * height;
-				}
-				else {
-					UINT linesize = std::min((UINT)abs(src_pitch), dst_pitch);
-					for (UINT y = 0; y < height; y++) {
-						memcpy(dst_data, src_data, linesize);
-						src_data += src_pitch;
-						dst_data += dst_pitch;
-					}
-				}
-				DataLength += dst_pitch * height;
+		const BYTE* src_data[4] = {};
+		int src_pitch[4] = {};
+		for (int i = 0; i < std::min(m_Format.planes, 3); i++) {
+			src_data[i]  = m_pVapourSynthFile->m_vsAPI->getReadPtr(frame.get(), m_Planes[i]);
+			src_pitch[i] = (int)m_pVapourSynthFile->m_vsAPI->getStride(frame.get(), m_Planes[i]);
+		}
+		if (frameAlpha) {
+			src_data[3]  = m_pVapourSynthFile->m_vsAPI->getReadPtr(frameAlpha.get(), 0);
+			src_pitch[3] = (int)m_pVapourSynthFile->m_vsAPI->getStride(frameAlpha.get(), 0);
+		}
+
+		// a repeated frame is not copied again into a buffer that already holds it,
+		// the frame address is not used with a separate alpha frame
+		const int duplicateFrames = m_pVapourSynthFile->m_Settings.iDuplicateFrames;
+		uint64_t key = 0;
+		if (duplicateFrames == DUPLICATE_FRAME && !frameAlpha) {
+			key = (uint64_t)(uintptr_t)frame.get();
+		}
+		else if (duplicateFrames == DUPLICATE_HASH) {
+			const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+			const int planes = std::min(m_Format.planes, 3);
+			const int bytesPerSample = vsAPI->getVideoFrameFormat(frame.get())->bytesPerSample;
+			int rowSize[4] = {};
+			int rows[4] = {};
+			for (int i = 0; i < planes; i++) {
+				rowSize[i] = vsAPI->getFrameWidth(frame.get(), m_Planes[i]) * bytesPerSample;
+				rows[i]    = vsAPI->getFrameHeight(frame.get(), m_Planes[i]);
+			}
+			if (frameAlpha) {
+				rowSize[3] = vsAPI->getFrameWidth(frameAlpha.get(), 0) * bytesPerSample;
+				rows[3]    = vsAPI->getFrameHeight(frameAlpha.get(), 0);
 			}
+			key = GetPlanesHash(frameAlpha ? 4 : planes, src_data, src_pitch, rowSize, rows);
 		}
 
-		pSample->SetActualDataLength(DataLength);
+		DataLength = key ? m_SampleCache.Find(dst_data, key) : 0;
+		if (!DataLength) {
+			DataLength = m_TransferFrame(dst_data, m_PitchBuff, src_data, src_pitch, m_Width, m_Height);
+			if (key) {
+				// the reference keeps the frame address unique while the buffer holds its content
+				m_SampleCache.Set(dst_data, key, DataLength, (duplicateFrames == DUPLICATE_FRAME) ? frame : nullptr);
+			} else {
+				m_SampleCache.Reset(dst_data);
+			}
+		}
+		if (m_pVapourSynthFile->m_pHashManifest) {
+			m_pVapourSynthFile->m_pHashManifest->AddVideo(currentFrame, m_OutFormat, dst_data, m_PitchBuff, m_Width, m_Height);
+		}
 
-		// Sample time
-		REFERENCE_TIME rtStart = llMulDiv(UNITS * m_FrameCounter, m_fpsDen, m_fpsNum, 0);
-		REFERENCE_TIME rtStop  = llMulDiv(UNITS * (m_FrameCounter+1), m_fpsDen, m_fpsNum, 0);
-		// The sample times are modified by the current rate.
-		if (m_dRateSeeking != 1.0) {
-			rtStart = static_cast<REFERENCE_TIME>(rtStart / m_dRateSeeking);
-			rtStop = static_cast<REFERENCE_TIME>(rtStop / m_dRateSeeking);
+		if (m_pVapourSynthFile->m_Settings.bVSProfiling) {
+			m_ProfileFrames++;
+			if (frameAlpha) {
+				m_ProfileAlphaFrames++;
+			}
+			if (m_ProfileFrames % 25 == 0) {
+				m_pVapourSynthFile->UpdateProfile(m_ProfileFrames, m_ProfileAlphaFrames);
+			}
 		}
-		pSample->SetTime(&rtStart, &rtStop);
+	}
 
-		m_FrameCounter++;
-		m_CurrentFrame++;
+	pSample->SetActualDataLength(DataLength);
+
+	// Sample time
+	REFERENCE_TIME rtStart;
+	REFERENCE_TIME rtStop;
+	if (bReverse) {
+		// the frames are shown from the end of the first frame backwards
+		const int firstFrame = currentFrame + frameCounter;
+		const int nextFrame = std::max(currentFrame - step, -1);
+		const REFERENCE_TIME rtFirst = m_Timeline.GetSegmentTime(seekGeneration, firstFrame + 1);
+		rtStart = rtFirst - m_Timeline.GetFrameTime(currentFrame + 1);
+		rtStop  = rtFirst - m_Timeline.GetFrameTime(nextFrame + 1);
+	}
+	else {
+		const int firstFrame = currentFrame - frameCounter;
+		const int nextFrame = std::min(currentFrame + step, m_NumFrames);
+		const REFERENCE_TIME rtFirst = m_Timeline.GetSegmentTime(seekGeneration, firstFrame);
+		rtStart = m_Timeline.GetFrameTime(currentFrame) - rtFirst;
+		rtStop  = m_Timeline.GetFrameTime(nextFrame) - rtFirst;
+	}
+	// The sample times are modified by the current rate.
+	if (rate != 1.0) {
+		rtStart = static_cast<REFERENCE_TIME>(rtStart / rate);
+		rtStop  = static_cast<REFERENCE_TIME>(rtStop / rate);
+	}
+	pSample->SetTime(&rtStart, &rtStop);
+
+	bool bStepComplete = false;
+	{
+		CAutoLock cAutoLockShared(&m_cSharedState);
+
+		if (seekGeneration == m_SeekGeneration) {
+			if (frame) {
+				m_Prefetch.SetCursor(currentFrame, frame);
+			}
+
+			m_LastFrame = currentFrame;
+			m_LastFrameCounter = frameCounter;
+			if (m_StepFrame >= 0 && (bReverse ? currentFrame <= m_StepFrame : currentFrame >= m_StepFrame)) {
+				const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_StepStart);
+				m_StepLatency.Add(latency.count() * 10);
+				m_StepFrame = -1;
+				bStepComplete = true;
+			}
+
+			m_FrameCounter = frameCounter + step;
+			m_CurrentFrame = currentFrame + dir * step;
+		}
+
+		if (m_Timeline.IsVariable()) {
+			// the duration is exact once the index is complete
+			const REFERENCE_TIME rtDuration = m_Timeline.GetDuration();
+			if (rtDuration != m_rtDuration) {
+				if (m_rtStop == m_rtDuration) {
+					m_rtStop = rtDuration;
+				}
+				m_rtDuration = rtDuration;
+			}
+		}
 	}
 
 	pSample->SetSyncPoint(TRUE);
@@ -587,14 +1221,18 @@ HRESULT CVapourSynthVideoStream::FillBuffer(IMediaSample* pSample)
 		m_bDiscontinuity = FALSE;
 	}
 
+	if (bStepComplete) {
+		m_pFilter->NotifyEvent(EC_STEP_COMPLETE, FALSE, 0);
+	}
+
 	return S_OK;
 }
 
 HRESULT CVapourSynthVideoStream::CheckMediaType(const CMediaType* pmt)
 {
 	if (pmt->majortype == MEDIATYPE_Video
-		&& pmt->subtype == m_Format.subtype
-		&& pmt->formattype == FORMAT_VideoInfo2) {
+		&& pmt->formattype == FORMAT_VideoInfo2
+		&& FindOutputFormat(m_OutputFormats, *pmt) >= 0) {
 
 		VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)pmt->Format();
 		if (vih2->bmiHeader.biWidth >= (long)m_Width && abs(vih2->bmiHeader.biHeight) == (long)m_Height) {
@@ -607,13 +1245,22 @@ HRESULT CVapourSynthVideoStream::CheckMediaType(const CMediaType* pmt)
 
 HRESULT CVapourSynthVideoStream::SetMediaType(const CMediaType* pMediaType)
 {
+	const int iFormat = FindOutputFormat(m_OutputFormats, *pMediaType);
+	if (iFormat < 0) {
+		return E_INVALIDARG;
+	}
+
 	HRESULT hr = __super::SetMediaType(pMediaType);
 
 	if (SUCCEEDED(hr)) {
+		m_OutFormat = m_OutputFormats[iFormat];
 		VIDEOINFOHEADER2* vih2 = (VIDEOINFOHEADER2*)pMediaType->Format();
-		m_PitchBuff = m_Format.Packsize * vih2->bmiHeader.biWidth;
-		ASSERT(m_PitchBuff >= m_Pitch);
-		m_BufferSize = m_PitchBuff * abs(vih2->bmiHeader.biHeight) * m_Format.buffCoeff / 2;
+		ASSERT(vih2->bmiHeader.biWidth >= (long)m_Width);
+		m_PitchBuff = GetOutputPitch(m_OutFormat, vih2->bmiHeader.biWidth);
+		m_BufferSize = m_PitchBuff * abs(vih2->bmiHeader.biHeight) * m_OutFormat.buffCoeff / 2;
+		m_TransferFrame = m_OutFormat.copyFrame;
+		m_bOutputAlpha = (m_Format.planes == 4 && IsOutputWithAlpha(m_OutFormat));
+		m_SampleCache.Clear();
 
 		DLog(L"SetMediaType with subtype {}", GUIDtoWString(m_mt.subtype));
 	}
@@ -628,22 +1275,123 @@ HRESULT CVapourSynthVideoStream::GetMediaType(int iPosition, CMediaType* pmt)
 	if (iPosition < 0) {
 		return E_INVALIDARG;
 	}
-	if (iPosition >= 1) {
+	if (iPosition >= (int)m_OutputFormats.size()) {
 		return VFW_S_NO_MORE_ITEMS;
 	}
 
-	*pmt = m_mt;
+	InitVideoMediaType(*pmt, m_OutputFormats[iPosition]);
+
+	return S_OK;
+}
+
+// IQualityControl
+
+STDMETHODIMP CVapourSynthVideoStream::Notify(IBaseFilter* pSender, Quality q)
+{
+	m_QualityControl.Notify(q);
+	return S_OK;
+}
+
+// IVideoFrameStep of the filter
+
+HRESULT CVapourSynthVideoStream::Step(const DWORD frames)
+{
+	if (m_BitmapError) {
+		return E_NOTIMPL;
+	}
+	if (!frames) {
+		return E_INVALIDARG;
+	}
+
+	FILTER_STATE state = State_Stopped;
+	m_pFilter->GetState(0, &state);
+	if (state != State_Paused || !ThreadExists()) {
+		return VFW_E_WRONG_STATE;
+	}
+
+	{
+		CAutoLock lock(CSourceSeeking::m_pLock);
+
+		// steps follow the playback direction
+		const bool bReverse = m_dRateSeeking < 0;
+		const int shownFrame = (m_LastFrame >= 0) ? m_LastFrame : m_CurrentFrame + (bReverse ? 1 : -1);
+		const int frame = bReverse
+			? (int)std::max<int64_t>((int64_t)shownFrame - frames, 0)
+			: (int)std::min<int64_t>((int64_t)shownFrame + frames, m_NumFrames - 1);
+		if (frame == shownFrame) {
+			return S_FALSE; // at the end
+		}
+
+		// the frame takes the place of the shown frame, so the stream time goes on from it
+		if (m_LastFrame >= 0) {
+			m_FrameCounter = m_LastFrameCounter;
+		}
+		m_CurrentFrame = frame;
+		m_StepFrame = frame;
+		m_StepStart = std::chrono::steady_clock::now();
+		m_SeekGeneration++;
+	}
+
+	// the delivery thread is blocked by the paused renderer
+	UpdateFromSeek();
+
+	return S_OK;
+}
+
+HRESULT CVapourSynthVideoStream::CanStep() const
+{
+	return m_BitmapError ? S_FALSE : S_OK;
+}
+
+HRESULT CVapourSynthVideoStream::CancelStep()
+{
+	CAutoLock lock(CSourceSeeking::m_pLock);
+
+	if (m_StepFrame < 0) {
+		return S_FALSE;
+	}
+	m_StepFrame = -1;
 
 	return S_OK;
 }
 
+int CVapourSynthVideoStream::GetFrameNumber(const REFERENCE_TIME rt) const
+{
+	if (m_NumFrames <= 0) {
+		return -1;
+	}
+	return std::clamp(m_Timeline.GetFrameNumber(std::max<REFERENCE_TIME>(rt, 0)), 0, m_NumFrames - 1);
+}
+
+// Interleaves the planar channels of a VapourSynth audio frame, the pointers are advanced.
+template <typename T>
+static void InterleaveSamples(BYTE* dst, std::vector<const uint8_t*>& src, const int samples)
+{
+	T* dstT = (T*)dst;
+	for (int i = 0; i < samples; i++) {
+		for (auto& ptr : src) {
+			*dstT++ = *(const T*)ptr;
+			ptr += sizeof(T);
+		}
+	}
+}
+
+static void InterleaveAudio(BYTE* dst, std::vector<const uint8_t*>& src, const int samples, const int sampleSize)
+{
+	switch (sampleSize) {
+	case 1: InterleaveSamples<uint8_t>(dst, src, samples);  break;
+	case 2: InterleaveSamples<uint16_t>(dst, src, samples); break;
+	case 4: InterleaveSamples<uint32_t>(dst, src, samples); break;
+	}
+}
+
 //
 // CVapourSynthAudioStream
 //
 
 CVapourSynthAudioStream::CVapourSynthAudioStream(CVapourSynthFile* pVapourSynthFile, CSource* pParent, HRESULT* phr)
 	: CSourceStream(L"Audio", phr, pParent, L"Audio")
-	, CSourceSeeking(L"Audio", (IPin*)this, phr, &m_cSharedState)
+	, CStreamSeeking(L"Audio", (IPin*)this, phr, &m_cSharedState, TIME_FORMAT_SAMPLE)
 	, m_pVapourSynthFile(pVapourSynthFile)
 {
 	CAutoLock cAutoLock(&m_cSharedState);
@@ -693,16 +1441,9 @@ CVapourSynthAudioStream::CVapourSynthAudioStream(CVapourSynthFile* pVapourSynthF
 		m_mt.SetSampleSize(m_BytesPerSample);
 
 		WAVEFORMATEXTENSIBLE* wfex = (WAVEFORMATEXTENSIBLE*)m_mt.AllocFormatBuffer(sizeof(WAVEFORMATEXTENSIBLE));
-		wfex->Format.wFormatTag           = WAVE_FORMAT_EXTENSIBLE;
-		wfex->Format.nChannels            = m_Channels;
-		wfex->Format.nSamplesPerSec       = m_SampleRate;
-		wfex->Format.nAvgBytesPerSec      = m_BytesPerSample * m_SampleRate;
-		wfex->Format.nBlockAlign          = m_BytesPerSample;
-		wfex->Format.wBitsPerSample       = m_BitDepth;
-		wfex->Format.cbSize               = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX); // 22
-		wfex->Samples.wValidBitsPerSample = m_BitDepth;
-		wfex->dwChannelMask               = (DWORD)m_vsAudioInfo->format.channelLayout;
-		wfex->SubFormat                   = m_Subtype;
+		// 24-bit samples are stored in 32-bit containers, wBitsPerSample is the container size
+		SetWaveFormatExtensible(wfex, m_Channels, m_SampleRate, m_BytesPerSample, m_vsAudioInfo->format.bytesPerSample * 8, m_BitDepth,
+			m_Subtype, (DWORD)m_vsAudioInfo->format.channelLayout);
 
 		m_StreamInfo = std::format(L"Audio stream: {} channels, {} Hz, ", m_Channels, m_SampleRate);
 		if (m_SampleType == stFloat) {
@@ -742,7 +1483,8 @@ HRESULT CVapourSynthAudioStream::OnThreadCreate()
 	CAutoLock cAutoLockShared(&m_cSharedState);
 
 	m_FrameCounter = 0;
-	m_CurrentFrame = (int)llMulDiv(m_rtStart, m_SampleRate, m_FrameSamples * UNITS, 0); // round down
+	m_CurrentFrame = (int)(m_StartUnit / m_FrameSamples);
+	m_SampleOffset = (int)(m_StartUnit % m_FrameSamples);
 
 	return CSourceStream::OnThreadCreate();
 }
@@ -778,7 +1520,7 @@ void CVapourSynthAudioStream::UpdateFromSeek()
 
 HRESULT CVapourSynthAudioStream::SetRate(double dRate)
 {
-	if (dRate <= 0) {
+	if (dRate == 0) {
 		return E_INVALIDARG;
 	}
 
@@ -797,7 +1539,9 @@ HRESULT CVapourSynthAudioStream::ChangeStart()
 	{
 		CAutoLock lock(CSourceSeeking::m_pLock);
 		m_FrameCounter = 0;
-		m_CurrentFrame = (int)llMulDiv(m_rtStart, m_SampleRate, m_FrameSamples * UNITS, 0); // round down
+		m_CurrentFrame = (int)(m_StartUnit / m_FrameSamples);
+		m_SampleOffset = (int)(m_StartUnit % m_FrameSamples);
+		m_SeekGeneration++;
 	}
 
 	UpdateFromSeek();
@@ -805,6 +1549,16 @@ HRESULT CVapourSynthAudioStream::ChangeStart()
 	return S_OK;
 }
 
+REFERENCE_TIME CVapourSynthAudioStream::UnitsToTime(const int64_t units) const
+{
+	return llMulDiv(units, UNITS, m_SampleRate, 0);
+}
+
+int64_t CVapourSynthAudioStream::TimeToUnits(const REFERENCE_TIME rt) const
+{
+	return llMulDiv(rt, m_SampleRate, UNITS, 0); // round down
+}
+
 HRESULT CVapourSynthAudioStream::ChangeStop()
 {
 	{
@@ -847,38 +1601,72 @@ HRESULT CVapourSynthAudioStream::DecideBufferSize(IMemAllocator* pAlloc, ALLOCAT
 
 HRESULT CVapourSynthAudioStream::FillBuffer(IMediaSample* pSample)
 {
+	// the audio is rendered without the seeking lock, see CAviSynthVideoStream::FillBuffer
+	bool bReverse;
+	double rate;
+	int currentFrame;
+	int frameCounter;
+	int sampleOffset;
+	uint64_t seekGeneration;
 	{
 		CAutoLock cAutoLockShared(&m_cSharedState);
 
-		if (m_CurrentFrame >= m_NumFrames) {
-			return S_FALSE;
-		}
+		// negative rates play backwards
+		bReverse = m_dRateSeeking < 0;
+		rate = std::abs(m_dRateSeeking);
 
-		AM_MEDIA_TYPE* pmt;
-		if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
-			CMediaType mt(*pmt);
-			SetMediaType(&mt);
-			DeleteMediaType(pmt);
+		if (bReverse && m_CurrentFrame >= m_NumFrames) {
+			m_CurrentFrame = m_NumFrames - 1; // started from the end
 		}
-
-		if (m_mt.formattype != FORMAT_WaveFormatEx) {
+		if (bReverse ? m_CurrentFrame < 0 : m_CurrentFrame >= m_NumFrames) {
 			return S_FALSE;
 		}
 
-		BYTE* dst_data = nullptr;
-		HRESULT hr = pSample->GetPointer(&dst_data);
-		if (FAILED(hr) || !dst_data) {
-			return S_FALSE;
-		}
+		currentFrame   = m_CurrentFrame;
+		frameCounter   = m_FrameCounter;
+		// a start position in samples may be inside the first frame
+		sampleOffset   = bReverse ? 0 : m_SampleOffset;
+		seekGeneration = m_SeekGeneration;
+	}
 
-		long buffSize = pSample->GetSize();
+	AM_MEDIA_TYPE* pmt;
+	if (SUCCEEDED(pSample->GetMediaType(&pmt)) && pmt) {
+		CMediaType mt(*pmt);
+		SetMediaType(&mt);
+		DeleteMediaType(pmt);
+	}
+
+	if (m_mt.formattype != FORMAT_WaveFormatEx) {
+		return S_FALSE;
+	}
+
+	BYTE* dst_data = nullptr;
+	HRESULT hr = pSample->GetPointer(&dst_data);
+	if (FAILED(hr) || !dst_data) {
+		return S_FALSE;
+	}
+
+	long buffSize = pSample->GetSize();
 
-		const VSFrame* frame = m_pVapourSynthFile->m_vsAPI->getFrame(m_CurrentFrame, m_pVapourSynthFile->m_vsNodeAudio, m_vsErrorMessage, sizeof(m_vsErrorMessage));
+	const int skipSamples = frameCounter ? 0 : sampleOffset;
+
+	if (bReverse || rate > 1.0) {
+		// fast forward and reverse playback are muted, the script audio is not rendered
+		const int64_t frameSamples = std::min<int64_t>(m_FrameSamples, m_NumSamples - (int64_t)currentFrame * m_FrameSamples) - skipSamples;
+		const int frameSize = (int)frameSamples * m_BytesPerSample;
+		if (frameSize <= 0 || buffSize < (long)frameSize) {
+			return S_FALSE;
+		}
+		memset(dst_data, (m_BitDepth == 8) ? 0x80 : 0, frameSize);
+		pSample->SetActualDataLength(frameSize);
+	}
+	else {
+		const VSFrame* frame = m_pVapourSynthFile->GetFrame(currentFrame, m_pVapourSynthFile->m_vsNodeAudio, m_vsErrorMessage, sizeof(m_vsErrorMessage));
 		if (!frame) {
 			DLog(ConvertUtf8ToWide(m_vsErrorMessage));
 			return E_FAIL;
 		}
-		const int frameSamples = m_pVapourSynthFile->m_vsAPI->getFrameLength(frame);
+		const int frameSamples = m_pVapourSynthFile->m_vsAPI->getFrameLength(frame) - skipSamples;
 		int frameSize = frameSamples * m_BytesPerSample;
 
 		std::vector<const uint8_t*> frameptrs(m_Channels, nullptr);
@@ -888,65 +1676,42 @@ HRESULT CVapourSynthAudioStream::FillBuffer(IMediaSample* pSample)
 				frameSize = 0;
 				break;
 			}
+			frameptrs[ch] += skipSamples * (m_BytesPerSample / m_Channels);
 		}
 
-		if (!frameSize || buffSize < (long)(frameSize)) {
+		if (frameSize <= 0 || buffSize < (long)(frameSize)) {
 			m_pVapourSynthFile->m_vsAPI->freeFrame(frame);
 			return S_FALSE;
 		}
 
-		switch (m_BitDepth) {
-		case 8:
-		{
-			uint8_t* dst8 = dst_data;
-			for (int i = 0; i < frameSamples; i++) {
-				for (int ch = 0; ch < m_Channels; ch++) {
-					*dst8++ = *frameptrs[ch]++;
-				}
-			}
-			break;
-		}
-		case 16:
-		{
-			uint16_t* dst16 = (uint16_t*)dst_data;
-			for (int i = 0; i < frameSamples; i++) {
-				for (int ch = 0; ch < m_Channels; ch++) {
-					*dst16++ = *(uint16_t*)frameptrs[ch];
-					frameptrs[ch] += sizeof(uint16_t);
-				}
-			}
-			break;
-		}
-		case 32:
-		{
-			uint32_t* dst32 = (uint32_t*)dst_data;
-			for (int i = 0; i < frameSamples; i++) {
-				for (int ch = 0; ch < m_Channels; ch++) {
-					*dst32++ = *(uint32_t*)frameptrs[ch];
-					frameptrs[ch] += sizeof(uint32_t);
-				}
-			}
-			break;
-		}
+		InterleaveAudio(dst_data, frameptrs, frameSamples, m_BytesPerSample / m_Channels);
+		if (m_pVapourSynthFile->m_pHashManifest) {
+			m_pVapourSynthFile->m_pHashManifest->AddAudio((int64_t)currentFrame * m_FrameSamples + skipSamples, dst_data, frameSize);
 		}
 
 		m_pVapourSynthFile->m_vsAPI->freeFrame(frame);
 
 		pSample->SetActualDataLength(frameSize);
+	}
 
-		// Sample time
-		REFERENCE_TIME rtStart = llMulDiv(m_FrameCounter,     UNITS * m_FrameSamples, m_SampleRate, 0);
-		REFERENCE_TIME rtStop  = llMulDiv(m_FrameCounter + 1, UNITS * m_FrameSamples, m_SampleRate, 0);
+	// Sample time
+	REFERENCE_TIME rtStart = llMulDiv((int64_t)frameCounter * m_FrameSamples + skipSamples - sampleOffset, UNITS, m_SampleRate, 0);
+	REFERENCE_TIME rtStop  = llMulDiv((int64_t)(frameCounter + 1) * m_FrameSamples - sampleOffset, UNITS, m_SampleRate, 0);
 
-		// The sample times are modified by the current rate.
-		if (m_dRateSeeking != 1.0) {
-			rtStart = static_cast<REFERENCE_TIME>(rtStart / m_dRateSeeking);
-			rtStop = static_cast<REFERENCE_TIME>(rtStop / m_dRateSeeking);
-		}
-		pSample->SetTime(&rtStart, &rtStop);
+	// The sample times are modified by the current rate.
+	if (rate != 1.0) {
+		rtStart = static_cast<REFERENCE_TIME>(rtStart / rate);
+		rtStop = static_cast<REFERENCE_TIME>(rtStop / rate);
+	}
+	pSample->SetTime(&rtStart, &rtStop);
 
-		m_FrameCounter++;
-		m_CurrentFrame++;
+	{
+		CAutoLock cAutoLockShared(&m_cSharedState);
+
+		if (seekGeneration == m_SeekGeneration) {
+			m_FrameCounter = frameCounter + 1;
+			m_CurrentFrame = currentFrame + (bReverse ? -1 : 1);
+		}
 	}
 
 	pSample->SetSyncPoint(TRUE);
@@ -969,7 +1734,7 @@ HRESULT CVapourSynthAudioStream::CheckMediaType(const CMediaType* pmt)
 		if ((int)wfe->nChannels >= m_Channels
 			&& (int)wfe->nSamplesPerSec == m_SampleRate
 			&& (int)wfe->nBlockAlign == m_BytesPerSample
-			&& (int)wfe->wBitsPerSample == m_BitDepth) {
+			&& (int)wfe->wBitsPerSample == m_vsAudioInfo->format.bytesPerSample * 8) {
 			return S_OK;
 		}
 	}
@@ -1002,4 +1767,333 @@ HRESULT CVapourSynthAudioStream::GetMediaType(int iPosition, CMediaType* pmt)
 	*pmt = m_mt;
 
 	return S_OK;
-}
\ No newline at end of file
+}
+//
+// CVapourSynthThumbnailRenderer
+//
+
+CVapourSynthThumbnailRenderer::CVapourSynthThumbnailRenderer(const WCHAR* filepath, const Settings_t& settings, const UINT width, HRESULT* phr)
+{
+	Settings_t thumbSettings = settings;
+	thumbSettings.bVSProfiling = false;
+
+	HRESULT hr = E_FAIL;
+	m_pVapourSynthFile.reset(new(std::nothrow) CVapourSynthFile(filepath, thumbSettings, nullptr, &hr));
+	if (!m_pVapourSynthFile || hr != S_OK || !m_pVapourSynthFile->m_vsNodeVideo) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+	VSNode* vsNodeVideo = m_pVapourSynthFile->m_vsNodeVideo;
+	VSCore* vsCore = m_pVapourSynthFile->m_vsScriptAPI->getCore(m_pVapourSynthFile->m_vsScript);
+
+	// the secondary core must not compete with the main one for all CPU cores
+	vsAPI->setThreadCount(kMaxThreads, vsCore);
+
+	VSPlugin* vsResize = vsAPI->getPluginByID("com.vapoursynth.resize", vsCore);
+	if (!vsResize) {
+		DLog(L"CVapourSynthThumbnailRenderer: the resize plugin is not available");
+		*phr = E_FAIL;
+		return;
+	}
+
+	const VSVideoInfo* vi = vsAPI->getVideoInfo(vsNodeVideo);
+	m_Width  = std::max(std::min<UINT>(width, vi->width) & ~1u, 2u);
+	m_Height = GetThumbnailHeight(m_Width, vi->width, vi->height);
+	m_NumFrames = vi->numFrames;
+
+	VSMap* vsArgs = vsAPI->createMap();
+	vsAPI->mapSetNode(vsArgs, "clip", vsNodeVideo, maReplace);
+	vsAPI->mapSetInt(vsArgs, "width", m_Width, maReplace);
+	vsAPI->mapSetInt(vsArgs, "height", m_Height, maReplace);
+	vsAPI->mapSetInt(vsArgs, "format", pfRGB24, maReplace);
+
+	if (vi->format.colorFamily == cfYUV) {
+		// the resizer fails on untagged YUV, the matrix is guessed from the frame size as the renderers do
+		int err = 1;
+		int64_t matrix = 2; // unspecified
+		char errorMsg[1024];
+		if (VSFramePtr frame = GetVideoFrame(vsAPI, vsNodeVideo, 0, errorMsg, sizeof(errorMsg))) {
+			matrix = vsAPI->mapGetInt(vsAPI->getFramePropertiesRO(frame.get()), "_Matrix", 0, &err);
+		}
+		if (err || matrix == 2) {
+			vsAPI->mapSetData(vsArgs, "matrix_in_s", vi->height > 576 ? "709" : "170m", -1, dtUtf8, maReplace);
+		}
+	}
+
+	VSMap* vsResult = vsAPI->invoke(vsResize, "Bilinear", vsArgs);
+	vsAPI->freeMap(vsArgs);
+
+	if (const char* error = vsAPI->mapGetError(vsResult)) {
+		DLog(L"CVapourSynthThumbnailRenderer: {}", ConvertUtf8ToWide(error));
+		*phr = E_FAIL;
+	} else {
+		m_vsNode = vsAPI->mapGetNode(vsResult, "clip", 0, nullptr);
+		*phr = m_vsNode ? S_OK : E_FAIL;
+	}
+	vsAPI->freeMap(vsResult);
+}
+
+CVapourSynthThumbnailRenderer::~CVapourSynthThumbnailRenderer()
+{
+	if (m_vsNode) {
+		m_pVapourSynthFile->m_vsAPI->freeNode(m_vsNode); // must be released before the script
+		m_vsNode = nullptr;
+	}
+	m_pVapourSynthFile.reset();
+}
+
+bool CVapourSynthThumbnailRenderer::Render(const int frame, BYTE* dst)
+{
+	const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+
+	char errorMsg[1024];
+	VSFramePtr vsFrame = GetVideoFrame(vsAPI, m_vsNode, frame, errorMsg, sizeof(errorMsg));
+	if (!vsFrame) {
+		DLog(L"CVapourSynthThumbnailRenderer: {}", ConvertUtf8ToWide(errorMsg));
+		return false;
+	}
+
+	// VapourSynth RGB planes are R,G,B, the transfer takes G,B,R
+	static constexpr int planes[3] = { 1, 2, 0 };
+	const BYTE* src_data[4] = {};
+	int src_pitch[4] = {};
+	for (int i = 0; i < 3; i++) {
+		src_data[i]  = vsAPI->getReadPtr(vsFrame.get(), planes[i]);
+		src_pitch[i] = (int)vsAPI->getStride(vsFrame.get(), planes[i]);
+	}
+
+	CopyFrameToRGB32<false>(dst, m_Width * 4, src_data, src_pitch, m_Width, m_Height);
+
+	return true;
+}
+
+//
+// CVapourSynthReader
+//
+
+CVapourSynthReader::CVapourSynthReader(const WCHAR* filepath, const Settings_t& settings, const int lookahead, HRESULT* phr)
+{
+	Settings_t readerSettings = settings;
+	readerSettings.bVSProfiling = false;
+
+	HRESULT hr = E_FAIL;
+	m_pVapourSynthFile.reset(new(std::nothrow) CVapourSynthFile(filepath, readerSettings, nullptr, &hr));
+	if (!m_pVapourSynthFile || hr != S_OK || !m_pVapourSynthFile->m_vsNodeVideo) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+	const VSVideoInfo* vsVideoInfo = vsAPI->getVideoInfo(m_pVapourSynthFile->m_vsNodeVideo);
+
+	auto& vi = m_VideoInfo;
+	vi.format       = GetFormatParamsVapourSynth(vsVideoInfo->format);
+	if (vi.format.fourcc == DWORD(-1)) {
+		DLog(L"CVapourSynthReader: unsuported video format {}", GetVapourSynthVideoID(vsVideoInfo->format));
+		*phr = E_FAIL;
+		return;
+	}
+	vi.width        = vsVideoInfo->width;
+	vi.height       = vsVideoInfo->height;
+	vi.numFrames    = vsVideoInfo->numFrames;
+	vi.fpsNum       = vsVideoInfo->fpsNum;
+	vi.fpsDen       = vsVideoInfo->fpsDen;
+	vi.planes       = vsVideoInfo->format.numPlanes;
+	vi.bitDepth     = vsVideoInfo->format.bitsPerSample;
+	vi.subsamplingW = vsVideoInfo->format.subSamplingW;
+	vi.subsamplingH = vsVideoInfo->format.subSamplingH;
+	vi.bFloat       = vsVideoInfo->format.sampleType == stFloat;
+	vi.bYUV         = vsVideoInfo->format.colorFamily == cfYUV;
+	vi.bGray        = vsVideoInfo->format.colorFamily == cfGray;
+
+	if (vsVideoInfo->format.colorFamily == cfRGB) {
+		m_Planes[0] = 1;
+		m_Planes[1] = 2;
+		m_Planes[2] = 0;
+	}
+
+	if (lookahead > 0) {
+		m_Lookahead = lookahead;
+	} else {
+		VSCoreInfo coreInfo = {};
+		vsAPI->getCoreInfo(m_pVapourSynthFile->m_vsScriptAPI->getCore(m_pVapourSynthFile->m_vsScript), &coreInfo);
+		m_Lookahead = std::max(coreInfo.numThreads, 1);
+	}
+
+	*phr = S_OK;
+}
+
+CVapourSynthReader::~CVapourSynthReader()
+{
+	// the callbacks must not come after the reader is gone
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this] {
+		return m_InFlight.empty();
+	});
+	m_Frames.clear();
+	lock.unlock();
+
+	m_pVapourSynthFile.reset();
+}
+
+void VS_CC CVapourSynthReader::FrameDoneCallback(void* userData, const VSFrame* f, int n, VSNode* node, const char* errorMsg)
+{
+	auto pReader = static_cast<CVapourSynthReader*>(userData);
+	const VSAPI* vsAPI = pReader->m_pVapourSynthFile->m_vsAPI;
+
+	VSFramePtr frame;
+	if (f) {
+		frame = VSFramePtr(f, [vsAPI](const VSFrame* p) {
+			vsAPI->freeFrame(p);
+		});
+	} else {
+		DLog(L"CVapourSynthReader: frame {} - {}", n, ConvertUtf8ToWide(errorMsg ? errorMsg : ""));
+	}
+
+	// notified under the lock, the destructor may free the reader as soon as m_InFlight is empty
+	std::lock_guard<std::mutex> lock(pReader->m_mutex);
+	pReader->m_InFlight.erase(n);
+	pReader->m_Frames.insert_or_assign(n, std::move(frame));
+	pReader->m_cv.notify_all();
+}
+
+bool CVapourSynthReader::ReadFrame(const int frame, ScriptFrame_t& out)
+{
+	if (frame < 0 || frame >= m_VideoInfo.numFrames) {
+		return false;
+	}
+
+	const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// the frames behind the reading position are not needed anymore
+	std::erase_if(m_Frames, [frame](const auto& item) {
+		return item.first < frame;
+	});
+	if (!m_Frames.contains(frame) && !m_InFlight.contains(frame)) {
+		m_NextRequest = frame; // not sequential, start a new window
+	}
+
+	std::vector<int> requests;
+	const int end = std::min(frame + m_Lookahead, m_VideoInfo.numFrames - 1);
+	for (int n = std::max(m_NextRequest, frame); n <= end; n++) {
+		if (!m_Frames.contains(n) && m_InFlight.emplace(n).second) {
+			requests.emplace_back(n);
+		}
+	}
+	m_NextRequest = std::max(m_NextRequest, end + 1);
+
+	lock.unlock();
+	for (const int n : requests) {
+		vsAPI->getFrameAsync(n, m_pVapourSynthFile->m_vsNodeVideo, FrameDoneCallback, this);
+	}
+	lock.lock();
+
+	m_cv.wait(lock, [this, frame] {
+		return m_Frames.contains(frame);
+	});
+	VSFramePtr vsFrame = std::move(m_Frames[frame]);
+	m_Frames.erase(frame);
+	lock.unlock();
+
+	if (!vsFrame) {
+		return false;
+	}
+
+	for (int i = 0; i < m_VideoInfo.planes; i++) {
+		out.data[i]  = vsAPI->getReadPtr(vsFrame.get(), m_Planes[i]);
+		out.pitch[i] = (int)vsAPI->getStride(vsFrame.get(), m_Planes[i]);
+	}
+
+	FrameProps_t props;
+	GetFrameProps(vsAPI, vsFrame.get(), props);
+	out.props = props.mediaType;
+	out.fieldBased = props.fieldBased;
+
+	out.ref = std::move(vsFrame);
+
+	return true;
+}
+
+//
+// CVapourSynthAudioReader
+//
+
+CVapourSynthAudioReader::CVapourSynthAudioReader(const WCHAR* filepath, const Settings_t& settings, HRESULT* phr)
+{
+	Settings_t readerSettings = settings;
+	readerSettings.bVSProfiling = false;
+
+	HRESULT hr = E_FAIL;
+	m_pVapourSynthFile.reset(new(std::nothrow) CVapourSynthFile(filepath, readerSettings, nullptr, &hr));
+	if (!m_pVapourSynthFile || hr != S_OK || !m_pVapourSynthFile->m_vsNodeAudio) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	const VSAudioInfo* vsAudioInfo = m_pVapourSynthFile->m_vsAPI->getAudioInfo(m_pVapourSynthFile->m_vsNodeAudio);
+	if (vsAudioInfo->format.sampleType != stFloat && vsAudioInfo->format.sampleType != stInteger) {
+		*phr = E_FAIL;
+		return;
+	}
+
+	// 24-bit samples are stored in 32 bits
+	const int channels = vsAudioInfo->format.numChannels;
+	m_SampleSize = vsAudioInfo->format.bytesPerSample;
+
+	SetWaveFormatExtensible(&m_AudioInfo.wfex, channels, vsAudioInfo->sampleRate, m_SampleSize * channels,
+		m_SampleSize * 8, vsAudioInfo->format.bitsPerSample,
+		(vsAudioInfo->format.sampleType == stFloat) ? MEDIASUBTYPE_IEEE_FLOAT : MEDIASUBTYPE_PCM,
+		(DWORD)vsAudioInfo->format.channelLayout);
+	m_AudioInfo.numSamples = vsAudioInfo->numSamples;
+	m_AudioInfo.chunkSamples = VS_AUDIO_FRAME_SAMPLES; // one audio frame per media sample
+
+	*phr = S_OK;
+}
+
+CVapourSynthAudioReader::~CVapourSynthAudioReader()
+{
+	m_pVapourSynthFile.reset();
+}
+
+bool CVapourSynthAudioReader::ReadAudio(BYTE* dst, const int64_t start, const int count)
+{
+	const VSAPI* vsAPI = m_pVapourSynthFile->m_vsAPI;
+	const int channels = m_AudioInfo.wfex.Format.nChannels;
+
+	int64_t pos = start;
+	const int64_t end = start + count;
+
+	while (pos < end) {
+		// all audio frames except the last one have VS_AUDIO_FRAME_SAMPLES samples
+		const int n = (int)(pos / VS_AUDIO_FRAME_SAMPLES);
+		const int skipSamples = (int)(pos % VS_AUDIO_FRAME_SAMPLES);
+
+		char errorMsg[1024];
+		VSFramePtr frame = GetVideoFrame(vsAPI, m_pVapourSynthFile->m_vsNodeAudio, n, errorMsg, sizeof(errorMsg));
+		if (!frame) {
+			DLog(ConvertUtf8ToWide(errorMsg));
+			return false;
+		}
+
+		const int samples = (int)std::min<int64_t>(vsAPI->getFrameLength(frame.get()) - skipSamples, end - pos);
+		if (samples <= 0) {
+			return false;
+		}
+
+		std::vector<const uint8_t*> frameptrs(channels, nullptr);
+		for (int ch = 0; ch < channels; ch++) {
+			frameptrs[ch] = vsAPI->getReadPtr(frame.get(), ch) + skipSamples * m_SampleSize;
+		}
+
+		InterleaveAudio(dst, frameptrs, samples, m_SampleSize);
+
+		dst += (size_t)samples * m_SampleSize * channels;
+		pos += samples;
+	}
+
+	return true;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (C) 2020-2025 v0lt
+ * Copyright (C) 2020-2026 v0lt
  *
  * SPDX-License-Identifier: LGPL-2.1-only
  */
@@ -7,9 +7,22 @@
 #pragma once
 
 #ifndef VSSCRIPT_H
+#define VS_GRAPH_API
 #include "../Include/VSScript4.h"
 #endif
+#include <set>
 #include "Helper.h"
+#include "FrameHash.h"
+#include "FramePrefetch.h"
+#include "FrameRequest.h"
+#include "FrameTimeline.h"
+#include "QualityControl.h"
+#include "SampleBufferCache.h"
+#include "ScriptReader.h"
+#include "StreamSeeking.h"
+#include "Thumbnailer.h"
+
+typedef std::shared_ptr<const VSFrame> VSFramePtr; // released with VSAPI::freeFrame
 
  //
  // CVapourSynthFile
@@ -19,6 +32,9 @@ class CVapourSynthFile
 {
 	friend class CVapourSynthVideoStream;
 	friend class CVapourSynthAudioStream;
+	friend class CVapourSynthThumbnailRenderer;
+	friend class CVapourSynthReader;
+	friend class CVapourSynthAudioReader;
 
 	HMODULE m_hVSScriptDll = nullptr;
 
@@ -26,17 +42,72 @@ class CVapourSynthFile
 	const VSSCRIPTAPI* m_vsScriptAPI = nullptr;
 	VSScript* m_vsScript = nullptr;
 	VSNode* m_vsNodeVideo = nullptr;
+	VSNode* m_vsNodeAlpha = nullptr; // frames are only requested when an alpha type is connected
 	VSNode* m_vsNodeAudio = nullptr;
 
 	std::wstring m_FileInfo;
 
+	class CVapourSynthVideoStream* m_pVideoStream = nullptr;
+
+	// profiling (the core is created with ccfEnableGraphInspection)
+	enum ProfileOutput {
+		PROFILE_VIDEO,
+		PROFILE_ALPHA, // only used by the alpha node
+		PROFILE_AUDIO,
+	};
+	struct ProfileNode_t {
+		VSNode*     node;
+		std::string name;
+		int64_t     time_ns; // cumulative filter time
+		ProfileOutput output;
+	};
+	const Settings_t m_Settings;
+	mutable CCritSec m_csProfile;
+	std::vector<ProfileNode_t> m_ProfileNodes;
+	int64_t m_ProfileFrames      = 0;
+	int64_t m_ProfileAlphaFrames = 0;
+
+	// The graph inspection functions are not safe to use concurrently with frame requests.
+	// While profiling, the frame requests of the filter are counted and UpdateProfile holds
+	// new requests back until the counted ones are done.
+	std::mutex              m_mutexRequests;
+	std::condition_variable m_cvRequests;
+	int  m_RequestsInFlight = 0; // requires m_mutexRequests
+	bool m_bRequestsHeld    = false;
+
+	const std::unique_ptr<CHashManifest> m_pHashManifest; // if enabled in the settings
+
 	void SetVSNodes();
+	void InitProfileNodes();
+	void UpdateProfile(const int64_t frames, const int64_t alphaFrames);
+	double GetFrameBudget() const; // in milliseconds
+	double GetProfileFrameMs(const ProfileNode_t& item) const; // requires m_csProfile
 
 public:
-	CVapourSynthFile(const WCHAR* filepath, CSource* pParent, HRESULT* phr);
+	CVapourSynthFile(const WCHAR* filepath, const Settings_t& settings, CSource* pParent, HRESULT* phr);
 	~CVapourSynthFile();
 
 	std::wstring_view GetInfo() { return m_FileInfo; }
+	int64_t GetDroppedFrames() const;
+	std::wstring GetHashManifest() const;
+
+	// frame stepping of the video stream
+	void EnablePrefetch(const bool enable);
+	HRESULT Step(const DWORD frames);
+	HRESULT CanStep() const;
+	HRESULT CancelStep();
+	const CLatencyStats* GetStepLatency() const;
+
+	// the frame of the video stream at the time, or -1 if there is no video
+	int GetFrameNumber(const REFERENCE_TIME rt) const;
+
+	bool IsProfiling() const { return m_Settings.bVSProfiling; }
+	// Every frame request of the pins is enclosed by these calls, asynchronous requests end in the callback.
+	void BeginFrameRequest();
+	void EndFrameRequest();
+	const VSFrame* GetFrame(const int n, VSNode* node, char* errorMsg, const int bufSize);
+	std::wstring GetProfileInfo() const;
+	std::string GetProfileJson() const;
 };
 
 //
@@ -45,17 +116,18 @@ public:
 
 class CVapourSynthVideoStream
 	: public CSourceStream
-	, public CSourceSeeking
+	, public CStreamSeeking
 {
 private:
 	CCritSec m_cSharedState;
 
-	const CVapourSynthFile* m_pVapourSynthFile;
+	CVapourSynthFile* m_pVapourSynthFile; // not const, the profile is updated by the stream
 
 	const VSVideoInfo* m_vsVideoInfo  = nullptr;
-	int                m_Planes[4] = { 0, 1, 2, 3 };
+	int                m_Planes[3] = { 0, 1, 2 }; // the alpha plane comes from m_vsNodeAlpha
 
 	std::unique_ptr<BYTE[]> m_BitmapError;
+	CSampleBufferCache m_SampleCache;
 
 	REFERENCE_TIME m_AvgTimePerFrame = 0;
 	int m_FrameCounter = 0;
@@ -64,22 +136,42 @@ private:
 	BOOL m_bDiscontinuity = FALSE;
 	BOOL m_bFlushing = FALSE;
 
-	FmtParams_t m_Format = {};
+	FmtParams_t m_Format = {};    // source format
+	FmtParams_t m_OutFormat = {}; // connected output format
+	std::vector<FmtParams_t> m_OutputFormats;
 	UINT m_Width   = 0;
 	UINT m_Height  = 0;
 	UINT m_Pitch   = 0;
 	UINT m_PitchBuff  = 0;
 	UINT m_BufferSize = 0;
 
+	TransferFrameFn m_TransferFrame = nullptr;
+	bool m_bOutputAlpha = false; // the connected type carries the alpha plane
+
 	UINT m_ColorInfo = 0;
 	struct {
 		int64_t num = 0;
 		int64_t den = 0;
 	} m_Sar;
+	MediaTypeProps_t m_Props; // media type props of the last frame, accepted or not
 
 	int m_NumFrames = 0;
 	int64_t m_fpsNum = 1;
 	int64_t m_fpsDen = 1;
+	CFrameTimeline m_Timeline;
+	CQualityControl m_QualityControl;
+
+	CFramePrefetch<VSFramePtr> m_Prefetch;
+	CFrameRequest<VSFramePtr> m_FrameRequest; // the frame of the delivery thread
+	CFrameRequest<VSFramePtr> m_AlphaRequest; // its alpha frame, if an alpha type is connected
+	int m_LastFrame        = -1; // the last delivered frame
+	int m_LastFrameCounter = 0;
+	int m_StepFrame        = -1; // the frame requested by Step
+	std::chrono::steady_clock::time_point m_StepStart;
+	CLatencyStats m_StepLatency;
+
+	int64_t m_ProfileFrames      = 0;
+	int64_t m_ProfileAlphaFrames = 0;
 
 	char m_vsErrorMessage[1024] = {};
 	std::wstring m_StreamInfo;
@@ -97,6 +189,8 @@ private:
 	HRESULT OnThreadStartPlay() override;
 
 	void UpdateFromSeek();
+	bool ReadFrameDuration(const int frame, int64_t& num, int64_t& den);
+	void UpdateFromFrameProps(const MediaTypeProps_t& props, const int frame, IMediaSample* pSample);
 
 	// IMediaSeeking
 	STDMETHODIMP SetRate(double dRate) override;
@@ -105,7 +199,12 @@ private:
 	HRESULT ChangeStop() override;
 	HRESULT ChangeRate() override { return S_OK; }
 
-	void InitVideoMediaType();
+	// CStreamSeeking
+	REFERENCE_TIME UnitsToTime(const int64_t units) const override;
+	int64_t TimeToUnits(const REFERENCE_TIME rt) const override;
+	void WaitStartPosition(const LONGLONG position, const bool bUnits) override;
+
+	void InitVideoMediaType(CMediaType& mt, const FmtParams_t& format);
 
 public:
 	HRESULT DecideBufferSize(IMemAllocator* pIMemAlloc, ALLOCATOR_PROPERTIES* pProperties) override;
@@ -115,7 +214,16 @@ public:
 	HRESULT GetMediaType(int iPosition, CMediaType* pmt) override;
 
 	// IQualityControl
-	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override { return E_NOTIMPL; }
+	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override;
+
+	int64_t GetDroppedFrames() const { return m_QualityControl.GetDroppedFrames(); }
+
+	void EnablePrefetch(const bool enable) { m_Prefetch.Enable(enable); }
+	HRESULT Step(const DWORD frames);
+	HRESULT CanStep() const;
+	HRESULT CancelStep();
+	const CLatencyStats& GetStepLatency() const { return m_StepLatency; }
+	int GetFrameNumber(const REFERENCE_TIME rt) const;
 };
 
 //
@@ -124,7 +232,7 @@ public:
 
 class CVapourSynthAudioStream
 	: public CSourceStream
-	, public CSourceSeeking
+	, public CStreamSeeking
 {
 private:
 	CCritSec m_cSharedState;
@@ -149,6 +257,7 @@ private:
 
 	int m_FrameCounter = 0;
 	int m_CurrentFrame = 0;
+	int m_SampleOffset = 0; // samples of the first frame before the start position
 
 	char m_vsErrorMessage[1024] = {};
 	std::wstring m_StreamInfo;
@@ -173,6 +282,10 @@ private:
 	HRESULT ChangeStop() override;
 	HRESULT ChangeRate() override { return S_OK; }
 
+	// CStreamSeeking
+	REFERENCE_TIME UnitsToTime(const int64_t units) const override;
+	int64_t TimeToUnits(const REFERENCE_TIME rt) const override;
+
 public:
 	HRESULT DecideBufferSize(IMemAllocator* pIMemAlloc, ALLOCATOR_PROPERTIES* pProperties) override;
 	HRESULT FillBuffer(IMediaSample* pSample) override;
@@ -183,3 +296,64 @@ public:
 	// IQualityControl
 	STDMETHODIMP Notify(IBaseFilter* pSender, Quality q) override { return E_NOTIMPL; }
 };
+
+//
+// CVapourSynthThumbnailRenderer
+//
+
+class CVapourSynthThumbnailRenderer : public CThumbnailRenderer
+{
+	std::unique_ptr<CVapourSynthFile> m_pVapourSynthFile;
+	VSNode* m_vsNode = nullptr; // downscaled RGB24
+
+public:
+	static constexpr int kMaxThreads = 2; // threads of the secondary core
+
+	CVapourSynthThumbnailRenderer(const WCHAR* filepath, const Settings_t& settings, const UINT width, HRESULT* phr);
+	~CVapourSynthThumbnailRenderer();
+
+	bool Render(const int frame, BYTE* dst) override;
+};
+
+//
+// CVapourSynthReader
+//
+// Keeps up to the lookahead number of asynchronous frame requests in flight,
+// so that the core renders several frames in parallel.
+
+class CVapourSynthReader : public CScriptReader
+{
+	std::unique_ptr<CVapourSynthFile> m_pVapourSynthFile;
+	int m_Planes[3] = { 0, 1, 2 };
+	int m_Lookahead = 0;
+
+	std::mutex              m_mutex;
+	std::condition_variable m_cv;
+	std::map<int, VSFramePtr> m_Frames; // completed requests, nullptr if the request failed
+	std::set<int> m_InFlight;
+	int m_NextRequest = 0;
+
+	static void VS_CC FrameDoneCallback(void* userData, const VSFrame* f, int n, VSNode* node, const char* errorMsg);
+
+public:
+	CVapourSynthReader(const WCHAR* filepath, const Settings_t& settings, const int lookahead, HRESULT* phr);
+	~CVapourSynthReader();
+
+	bool ReadFrame(const int frame, ScriptFrame_t& out) override;
+};
+
+//
+// CVapourSynthAudioReader
+//
+
+class CVapourSynthAudioReader : public CScriptAudioReader
+{
+	std::unique_ptr<CVapourSynthFile> m_pVapourSynthFile;
+	int m_SampleSize = 0; // bytes per channel
+
+public:
+	CVapourSynthAudioReader(const WCHAR* filepath, const Settings_t& settings, HRESULT* phr);
+	~CVapourSynthAudioReader();
+
+	bool ReadAudio(BYTE* dst, const int64_t start, const int count) override;
+};
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "AsyncWriter.h"
+
+//
+// CAsyncWriter
+//
+
+CAsyncWriter::~CAsyncWriter()
+{
+	Close();
+}
+
+bool CAsyncWriter::Open(const std::wstring& filepath)
+{
+	Close();
+
+	if (filepath == L"-") {
+		m_hFile = GetStdHandle(STD_OUTPUT_HANDLE);
+		m_bStdout = true;
+	} else {
+		m_hFile = CreateFileW(filepath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		m_bStdout = false;
+	}
+	if (m_hFile == INVALID_HANDLE_VALUE || !m_hFile) {
+		m_hFile = INVALID_HANDLE_VALUE;
+		return false;
+	}
+
+	m_Free.clear();
+	m_Full.clear();
+	for (auto& buffer : m_Buffers) {
+		if (!buffer.data) {
+			buffer.data.reset(new BYTE[kBufferSize]);
+		}
+		buffer.size = 0;
+		m_Free.emplace_back(&buffer);
+	}
+	m_pCurrent = m_Free.front();
+	m_Free.pop_front();
+
+	m_Written = 0;
+	m_bFailed = false;
+	m_bStop   = false;
+	m_Thread  = std::thread(&CAsyncWriter::ThreadProc, this);
+
+	return true;
+}
+
+void CAsyncWriter::ThreadProc()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (;;) {
+		m_cv.wait(lock, [this] {
+			return m_bStop || !m_Full.empty();
+		});
+		if (m_Full.empty()) {
+			break; // stopped
+		}
+
+		Buffer_t* pBuffer = m_Full.front();
+		m_Full.pop_front();
+		const bool bFailed = m_bFailed;
+		lock.unlock();
+
+		if (!bFailed) {
+			DWORD written = 0;
+			const BOOL ok = WriteFile(m_hFile, pBuffer->data.get(), (DWORD)pBuffer->size, &written, nullptr);
+			if (!ok || written != pBuffer->size) {
+				DLog(L"CAsyncWriter: WriteFile failed, {}", HR2Str(HRESULT_FROM_WIN32(GetLastError())));
+				std::lock_guard<std::mutex> failLock(m_mutex);
+				m_bFailed = true;
+			}
+		}
+
+		lock.lock();
+		pBuffer->size = 0;
+		m_Free.emplace_back(pBuffer);
+		m_cv.notify_all();
+	}
+}
+
+void CAsyncWriter::Submit()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_Full.emplace_back(m_pCurrent);
+	m_cv.notify_all();
+
+	m_cv.wait(lock, [this] {
+		return !m_Free.empty();
+	});
+	m_pCurrent = m_Free.front();
+	m_Free.pop_front();
+}
+
+void CAsyncWriter::Flush()
+{
+	if (m_pCurrent->size) {
+		Submit();
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cv.wait(lock, [this] {
+		return m_Free.size() + 1 == kBuffers;
+	});
+}
+
+void CAsyncWriter::Write(const void* data, const size_t size)
+{
+	auto src = (const BYTE*)data;
+	size_t left = size;
+
+	while (left) {
+		const size_t count = std::min(left, kBufferSize - m_pCurrent->size);
+		memcpy(m_pCurrent->data.get() + m_pCurrent->size, src, count);
+		m_pCurrent->size += count;
+		src  += count;
+		left -= count;
+
+		if (m_pCurrent->size == kBufferSize) {
+			Submit();
+		}
+	}
+
+	m_Written += size;
+}
+
+bool CAsyncWriter::Close()
+{
+	if (!m_Thread.joinable()) {
+		return !m_bFailed;
+	}
+
+	Flush();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_cv.notify_all();
+	m_Thread.join();
+
+	if (!m_bStdout) {
+		CloseHandle(m_hFile);
+	}
+	m_hFile = INVALID_HANDLE_VALUE;
+
+	return !m_bFailed;
+}
+
+bool CAsyncWriter::IsFailed()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_bFailed;
+}
+
+bool CAsyncWriter::Rewrite(const uint64_t offset, const void* data, const size_t size)
+{
+	if (m_bStdout || !m_Thread.joinable()) {
+		return false;
+	}
+
+	Flush();
+
+	LARGE_INTEGER pos;
+	pos.QuadPart = offset;
+	DWORD written = 0;
+	bool ok = SetFilePointerEx(m_hFile, pos, nullptr, FILE_BEGIN)
+		&& WriteFile(m_hFile, data, (DWORD)size, &written, nullptr) && written == size;
+
+	pos.QuadPart = 0;
+	ok = SetFilePointerEx(m_hFile, pos, nullptr, FILE_END) && ok;
+
+	return ok;
+}
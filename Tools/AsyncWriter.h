@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+//
+// CAsyncWriter
+//
+// Collects the output in large buffers. A full buffer is written to the file by a separate
+// thread while the next one is filled, so rendering and writing overlap.
+
+class CAsyncWriter
+{
+public:
+	static constexpr size_t kBufferSize = 8 * 1024 * 1024;
+	static constexpr size_t kBuffers    = 2;
+
+private:
+	struct Buffer_t {
+		std::unique_ptr<BYTE[]> data;
+		size_t size = 0;
+	};
+
+	HANDLE m_hFile  = INVALID_HANDLE_VALUE;
+	bool   m_bStdout = false;
+
+	std::mutex              m_mutex;
+	std::condition_variable m_cv;
+	Buffer_t m_Buffers[kBuffers];
+	std::deque<Buffer_t*> m_Free;
+	std::deque<Buffer_t*> m_Full;
+	Buffer_t* m_pCurrent = nullptr;
+	bool m_bFailed = false;
+	bool m_bStop   = false;
+
+	uint64_t m_Written = 0; // bytes passed to Write
+
+	std::thread m_Thread;
+
+	void ThreadProc();
+	void Submit();
+	void Flush(); // waits until all buffered data has been written
+
+public:
+	~CAsyncWriter();
+
+	// "-" writes to stdout.
+	bool Open(const std::wstring& filepath);
+	void Write(const void* data, const size_t size);
+	// Writes all buffered data and closes the file. Returns false if any write failed.
+	bool Close();
+
+	uint64_t GetWritten() const { return m_Written; }
+	bool IsFailed();
+
+	// Overwrites data at the offset after all buffered data has been written, for example
+	// the sizes in a file header. Not possible for stdout.
+	bool Rewrite(const uint64_t offset, const void* data, const size_t size);
+};
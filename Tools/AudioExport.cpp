@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <ksmedia.h>
+#include "ScriptReader.h"
+#include "AsyncWriter.h"
+#include "ToolUtils.h"
+
+#include "AudioExport.h"
+
+// Sony Wave64 chunk IDs
+static const GUID s_W64_riff = { 0x66666972, 0x912E, 0x11CF, { 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00 } };
+static const GUID s_W64_wave = { 0x65766177, 0xACF3, 0x11D3, { 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A } };
+static const GUID s_W64_fmt  = { 0x20746D66, 0xACF3, 0x11D3, { 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A } };
+static const GUID s_W64_data = { 0x61746164, 0xACF3, 0x11D3, { 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A } };
+
+// The usual speaker layout for the number of channels if the script does not have one.
+static DWORD GetDefaultChannelMask(const int channels)
+{
+	switch (channels) {
+	case 1: return KSAUDIO_SPEAKER_MONO;
+	case 2: return KSAUDIO_SPEAKER_STEREO;
+	case 3: return KSAUDIO_SPEAKER_STEREO | SPEAKER_FRONT_CENTER;
+	case 4: return KSAUDIO_SPEAKER_QUAD;
+	case 5: return KSAUDIO_SPEAKER_QUAD | SPEAKER_FRONT_CENTER;
+	case 6: return KSAUDIO_SPEAKER_5POINT1;
+	case 7: return KSAUDIO_SPEAKER_5POINT1 | SPEAKER_BACK_CENTER;
+	case 8: return KSAUDIO_SPEAKER_7POINT1_SURROUND;
+	default: return 0;
+	}
+}
+
+template <typename T>
+static void AppendValue(std::vector<BYTE>& header, const T& value)
+{
+	header.insert(header.end(), (const BYTE*)&value, (const BYTE*)&value + sizeof(value));
+}
+
+// W64 chunks are aligned to 8 bytes, RIFF chunks to 2 bytes
+static uint64_t GetWavePadding(const uint64_t dataSize, const bool bW64)
+{
+	return bW64 ? (8 - dataSize % 8) % 8 : (dataSize & 1);
+}
+
+static std::vector<BYTE> GetWaveHeader(const WAVEFORMATEXTENSIBLE& wfex, const uint64_t dataSize, const bool bW64)
+{
+	std::vector<BYTE> header;
+
+	if (bW64) {
+		// the chunk sizes include the 24 byte chunk headers
+		const uint64_t fmtSize  = 24 + sizeof(wfex);
+		const uint64_t riffSize = 40 + fmtSize + 24 + dataSize + GetWavePadding(dataSize, true);
+
+		AppendValue(header, s_W64_riff);
+		AppendValue(header, riffSize);
+		AppendValue(header, s_W64_wave);
+		AppendValue(header, s_W64_fmt);
+		AppendValue(header, fmtSize);
+		AppendValue(header, wfex);
+		AppendValue(header, s_W64_data);
+		AppendValue(header, (uint64_t)(24 + dataSize));
+	} else {
+		const uint32_t riffSize = (uint32_t)(4 + 8 + sizeof(wfex) + 8 + dataSize + GetWavePadding(dataSize, false));
+
+		AppendValue(header, FCC('RIFF'));
+		AppendValue(header, riffSize);
+		AppendValue(header, FCC('WAVE'));
+		AppendValue(header, FCC('fmt '));
+		AppendValue(header, (uint32_t)sizeof(wfex));
+		AppendValue(header, wfex);
+		AppendValue(header, FCC('data'));
+		AppendValue(header, (uint32_t)dataSize);
+	}
+
+	return header;
+}
+
+int RunAudioExport(const std::wstring& script, const AudioExportOptions_t& options)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto pReader = CreateScriptAudioReader(script, Settings_t());
+	if (!pReader) {
+		PrintLine(std::format(L"failed to open the audio of {}", script));
+		return 1;
+	}
+	const double evalMs = GetElapsedMs(start);
+
+	const auto& info = pReader->GetAudioInfo();
+	WAVEFORMATEXTENSIBLE wfex = info.wfex;
+	if (!wfex.dwChannelMask) {
+		wfex.dwChannelMask = GetDefaultChannelMask(wfex.Format.nChannels);
+	}
+
+	const UINT blockAlign = wfex.Format.nBlockAlign;
+	const uint64_t dataSize = info.numSamples * blockAlign;
+	const bool bW64 = options.bW64 || dataSize + 128 > UINT32_MAX;
+
+	CAsyncWriter writer;
+	if (!writer.Open(options.output)) {
+		PrintLine(std::format(L"failed to open {}", options.output));
+		return 1;
+	}
+
+	// the sizes are known in advance, so stdout gets a valid header too
+	const std::vector<BYTE> header = GetWaveHeader(wfex, dataSize, bW64);
+	writer.Write(header.data(), header.size());
+
+	// about a second of audio per request, the writer thread writes while the next part is rendered
+	const int blockSamples = std::max<int>(wfex.Format.nSamplesPerSec, 1);
+	std::vector<BYTE> block((size_t)blockSamples * blockAlign);
+
+	start = std::chrono::steady_clock::now();
+	int64_t pos = 0;
+	bool ok = true;
+
+	while (pos < info.numSamples && !writer.IsFailed()) {
+		const int count = (int)std::min<int64_t>(blockSamples, info.numSamples - pos);
+		if (!pReader->ReadAudio(block.data(), pos, count)) {
+			PrintLine(std::format(L"failed to render the audio at sample {}", pos));
+			ok = false;
+			break;
+		}
+		writer.Write(block.data(), (size_t)count * blockAlign);
+		pos += count;
+	}
+
+	const uint64_t written = pos * blockAlign;
+	const uint64_t padding = GetWavePadding(written, bW64);
+	if (padding) {
+		const BYTE zeros[8] = {};
+		writer.Write(zeros, (size_t)padding);
+	}
+
+	if (written != dataSize) {
+		// an incomplete file still gets correct sizes
+		const std::vector<BYTE> realHeader = GetWaveHeader(wfex, written, bW64);
+		writer.Rewrite(0, realHeader.data(), realHeader.size());
+	}
+
+	if (!writer.Close()) {
+		PrintLine(std::format(L"failed to write {}", options.output));
+		ok = false;
+	}
+
+	const double renderMs = GetElapsedMs(start);
+	PrintLine(std::format(L"{}: {}, {} channels, {} Hz, {}-bit {}, {} samples, {:.1f} MB, eval {:.1f} ms, {:.1f} ms",
+		script, bW64 ? L"w64" : L"wav", wfex.Format.nChannels, wfex.Format.nSamplesPerSec,
+		wfex.Samples.wValidBitsPerSample, (wfex.SubFormat == MEDIASUBTYPE_IEEE_FLOAT) ? L"float" : L"int",
+		pos, writer.GetWritten() / (1024.0 * 1024.0), evalMs, renderMs));
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,15 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+struct AudioExportOptions_t {
+	std::wstring output;  // file path or "-" for stdout
+	bool bW64 = false;    // Sony Wave64 even if the data fits in a RIFF file
+};
+
+// Writes the audio of the script as WAV, or as W64 if it is larger than 4 GB. Returns 0 on success.
+int RunAudioExport(const std::wstring& script, const AudioExportOptions_t& options);
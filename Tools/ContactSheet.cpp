@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include "Thumbnailer.h"
+#include "ToolUtils.h"
+
+#include "ContactSheet.h"
+
+struct SheetResult_t {
+	std::wstring sheet; // file name in outDir
+	std::wstring error;
+	std::vector<int> frames;
+	int  numFrames   = 0;
+	UINT thumbWidth  = 0;
+	UINT thumbHeight = 0;
+	int  columns     = 0;
+	double evalMs    = 0.0;
+	double renderMs  = 0.0;
+};
+
+static std::vector<int> GetSheetFrames(const ContactSheetOptions_t& options, const int numFrames)
+{
+	std::vector<int> frames;
+
+	if (options.frames.size()) {
+		for (const int frame : options.frames) {
+			if (frame >= 0 && frame < numFrames) {
+				frames.emplace_back(frame);
+			}
+		}
+	} else {
+		// the middles of equal parts, the first and last frames are often black
+		const int count = std::min(options.count, numFrames);
+		for (int i = 0; i < count; i++) {
+			frames.emplace_back((int)((int64_t)numFrames * (2 * i + 1) / (2 * count)));
+		}
+	}
+
+	return frames;
+}
+
+static void RenderContactSheet(const std::wstring& script, const size_t index, const ContactSheetOptions_t& options, SheetResult_t& result)
+{
+	// The thumbnails are scaled and converted to RGB by the script, as the seekbar thumbnails are
+	// (BilinearResize/ConvertToRGB32 in AviSynth, resize.Bilinear to RGB24 in VapourSynth). The
+	// output pins copy the frames with s_FormatTable and leave YUV to the renderer, so a sheet
+	// does not show the colors of the connected renderer.
+	auto start = std::chrono::steady_clock::now();
+	auto pRenderer = CreateThumbnailRenderer(script, Settings_t(), options.width);
+	result.evalMs = GetElapsedMs(start);
+
+	if (!pRenderer) {
+		result.error = L"failed to open the script";
+		return;
+	}
+
+	result.numFrames   = pRenderer->GetNumFrames();
+	result.thumbWidth  = pRenderer->GetWidth();
+	result.thumbHeight = pRenderer->GetHeight();
+	result.frames      = GetSheetFrames(options, result.numFrames);
+	if (result.frames.empty()) {
+		result.error = L"no frames to render";
+		return;
+	}
+
+	const int count = (int)result.frames.size();
+	result.columns = (options.columns > 0) ? std::min(options.columns, count) : (int)std::ceil(std::sqrt(count));
+	const int rows = (count + result.columns - 1) / result.columns;
+
+	const UINT thumbPitch = result.thumbWidth * 4;
+	const UINT sheetPitch = thumbPitch * result.columns;
+	const UINT sheetHeight = result.thumbHeight * rows;
+	std::vector<BYTE> sheet((size_t)sheetPitch * sheetHeight);
+	std::vector<BYTE> thumb((size_t)thumbPitch * result.thumbHeight);
+
+	start = std::chrono::steady_clock::now();
+	int failed = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (!pRenderer->Render(result.frames[i], thumb.data())) {
+			failed++;
+			continue; // the tile stays black
+		}
+
+		BYTE* dst = sheet.data() + (size_t)sheetPitch * result.thumbHeight * (i / result.columns) + thumbPitch * (i % result.columns);
+		const BYTE* src = thumb.data();
+		for (UINT y = 0; y < result.thumbHeight; y++) {
+			memcpy(dst, src, thumbPitch);
+			dst += sheetPitch;
+			src += thumbPitch;
+		}
+	}
+
+	result.renderMs = GetElapsedMs(start);
+	pRenderer.reset();
+
+	if (failed) {
+		result.error = std::format(L"{} of {} frames failed to render", failed, count);
+	}
+
+	result.sheet = std::format(L"{:05}_{}.bmp", index, std::filesystem::path(script).stem().wstring());
+	if (!WriteBitmapFile((std::filesystem::path(options.outDir) / result.sheet).wstring(), sheet.data(), sheetPitch / 4, sheetHeight)) {
+		result.error = L"failed to write the contact sheet";
+		result.sheet.clear();
+	}
+}
+
+static bool WriteIndexFile(const std::wstring& filepath, const std::vector<std::wstring>& scripts, const std::vector<SheetResult_t>& results, const double totalMs)
+{
+	std::ofstream file(std::filesystem::path(filepath), std::ios::binary);
+
+	file << "{\n" << std::format("  \"total_ms\": {:.1f},\n", totalMs) << "  \"scripts\": [";
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& result = results[i];
+
+		std::string frames;
+		for (const int frame : result.frames) {
+			frames += std::format("{}{}", frames.empty() ? "" : ", ", frame);
+		}
+
+		file << (i ? ",\n" : "\n") << "    {\n"
+			<< "      \"script\": " << JsonString(scripts[i]) << ",\n"
+			<< "      \"sheet\": " << JsonString(result.sheet) << ",\n"
+			<< std::format("      \"num_frames\": {},\n", result.numFrames)
+			<< std::format("      \"frames\": [{}],\n", frames)
+			<< std::format("      \"thumbnail_width\": {},\n", result.thumbWidth)
+			<< std::format("      \"thumbnail_height\": {},\n", result.thumbHeight)
+			<< std::format("      \"columns\": {},\n", result.columns)
+			<< std::format("      \"eval_ms\": {:.1f},\n", result.evalMs)
+			<< std::format("      \"render_ms\": {:.1f},\n", result.renderMs)
+			<< "      \"error\": " << JsonString(result.error) << "\n"
+			<< "    }";
+	}
+
+	file << "\n  ]\n}\n";
+
+	return file.good();
+}
+
+int RunContactSheets(const std::vector<std::wstring>& scripts, const ContactSheetOptions_t& options)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(options.outDir, ec);
+
+	// every job opens its own script environment, the scripts are not shared between threads
+	size_t jobs = (options.jobs > 0) ? options.jobs : std::max(std::thread::hardware_concurrency(), 1u);
+	jobs = std::min(jobs, scripts.size());
+
+	std::vector<SheetResult_t> results(scripts.size());
+	std::atomic<size_t> next = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (size_t j = 0; j < jobs; j++) {
+		threads.emplace_back([&] {
+			for (size_t i = next++; i < scripts.size(); i = next++) {
+				auto& result = results[i];
+				RenderContactSheet(scripts[i], i, options, result);
+				PrintLine(std::format(L"{}: eval {:.1f} ms, render {:.1f} ms{}{}",
+					scripts[i], result.evalMs, result.renderMs, result.error.size() ? L", " : L"", result.error));
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	const double totalMs = GetElapsedMs(start);
+
+	const int failed = (int)std::count_if(results.cbegin(), results.cend(), [](const SheetResult_t& result) {
+		return result.sheet.empty();
+	});
+	PrintLine(std::format(L"{} scripts in {:.1f} ms with {} jobs, {} failed", scripts.size(), totalMs, jobs, failed));
+
+	if (!WriteIndexFile((std::filesystem::path(options.outDir) / L"index.json").wstring(), scripts, results, totalMs)) {
+		PrintLine(L"failed to write index.json");
+		return std::max(failed, 1);
+	}
+
+	return failed;
+}
@@ -0,0 +1,20 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+struct ContactSheetOptions_t {
+	std::wstring outDir;
+	std::vector<int> frames; // frame numbers, evenly spaced frames are used if empty
+	int  count   = 16;       // number of evenly spaced frames
+	UINT width   = 160;      // thumbnail width
+	int  columns = 0;        // 0 - square grid
+	int  jobs    = 0;        // scripts opened at the same time, 0 - number of CPU cores
+};
+
+// Renders a contact sheet for every script into outDir and writes "index.json" with the frame
+// numbers and the evaluation and render time of each script. Returns the number of failed scripts.
+int RunContactSheets(const std::vector<std::wstring>& scripts, const ContactSheetOptions_t& options);
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "FrameHash.h"
+#include "ScriptReader.h"
+#include "AsyncWriter.h"
+#include "ToolUtils.h"
+
+#include "HashManifest.h"
+
+// A missing stream is not an error, the script may have only video or only audio.
+static bool HashVideo(const std::wstring& script, const HashOptions_t& options, CHashManifest& manifest, int& frames)
+{
+	auto pReader = CreateScriptReader(script, Settings_t(), options.lookahead);
+	if (!pReader) {
+		PrintLine(std::format(L"{}: no video", script));
+		return true;
+	}
+
+	const auto& vi = pReader->GetVideoInfo();
+	const int first = std::min(options.start, vi.numFrames);
+	const int end   = (options.count > 0) ? std::min(first + options.count, vi.numFrames) : vi.numFrames;
+
+	// the frames are hashed as the video pin writes them in the native format
+	const UINT pitch = GetOutputPitch(vi.format, vi.width);
+	std::vector<BYTE> buffer((size_t)pitch * vi.height * vi.format.buffCoeff / 2);
+
+	for (int n = first; n < end; n++) {
+		ScriptFrame_t frame;
+		if (!pReader->ReadFrame(n, frame)) {
+			PrintLine(std::format(L"failed to render frame {}", n));
+			return false;
+		}
+		vi.format.copyFrame(buffer.data(), pitch, frame.data, frame.pitch, vi.width, vi.height);
+		manifest.AddVideo(n, vi.format, buffer.data(), pitch, vi.width, vi.height);
+		frames++;
+	}
+
+	return true;
+}
+
+static bool HashAudio(const std::wstring& script, CHashManifest& manifest, int64_t& samples)
+{
+	auto pReader = CreateScriptAudioReader(script, Settings_t());
+	if (!pReader) {
+		PrintLine(std::format(L"{}: no audio", script));
+		return true;
+	}
+
+	const auto& info = pReader->GetAudioInfo();
+	const UINT blockAlign = info.wfex.Format.nBlockAlign;
+	const int chunkSamples = std::max(info.chunkSamples, 1);
+	std::vector<BYTE> chunk((size_t)chunkSamples * blockAlign);
+
+	for (int64_t pos = 0; pos < info.numSamples; pos += chunkSamples) {
+		const int count = (int)std::min<int64_t>(chunkSamples, info.numSamples - pos);
+		if (!pReader->ReadAudio(chunk.data(), pos, count)) {
+			PrintLine(std::format(L"failed to render the audio at sample {}", pos));
+			return false;
+		}
+		manifest.AddAudio(pos, chunk.data(), (size_t)count * blockAlign);
+		samples += count;
+	}
+
+	return true;
+}
+
+int RunHashManifest(const std::wstring& script, const HashOptions_t& options)
+{
+	CHashManifest manifest;
+	int frames = 0;
+	int64_t samples = 0;
+	bool ok = true;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	if (options.bVideo) {
+		ok = HashVideo(script, options, manifest, frames) && ok;
+	}
+	if (options.bAudio) {
+		ok = HashAudio(script, manifest, samples) && ok;
+	}
+
+	const double totalMs = GetElapsedMs(start);
+
+	if (!frames && !samples) {
+		PrintLine(std::format(L"failed to open {}", script));
+		return 1;
+	}
+
+	const std::string text = ConvertWideToUtf8(manifest.GetText());
+	CAsyncWriter writer;
+	if (!writer.Open(options.output)) {
+		PrintLine(std::format(L"failed to open {}", options.output));
+		return 1;
+	}
+	writer.Write(text.data(), text.size());
+	if (!writer.Close()) {
+		PrintLine(std::format(L"failed to write {}", options.output));
+		ok = false;
+	}
+
+	PrintLine(std::format(L"{}: {} frames, {} audio samples, {:.1f} ms, {:.2f} fps",
+		script, frames, samples, totalMs, totalMs > 0 ? frames * 1000.0 / totalMs : 0.0));
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+struct HashOptions_t {
+	std::wstring output;    // file path or "-" for stdout
+	int  start     = 0;
+	int  count     = 0;     // 0 - up to the end
+	int  lookahead = 0;     // frames rendered ahead, 0 - default
+	bool bVideo    = true;
+	bool bAudio    = true;
+};
+
+// Writes the hashes of the video frames in the native output format and of the audio chunks
+// as the output pins deliver them. The text has the format of the "frameHashes" filter manifest.
+// Returns 0 on success.
+int RunHashManifest(const std::wstring& script, const HashOptions_t& options);
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <atomic>
+#include <thread>
+#include "Thumbnailer.h"
+#include "ToolUtils.h"
+
+#include "OpenStress.h"
+
+static constexpr UINT kStressWidth = 64;
+
+// Renders the middle frame of the script with a new instance, the instance is closed on return.
+static bool RenderOnce(const std::wstring& script, std::vector<BYTE>& pixels)
+{
+	auto pRenderer = CreateThumbnailRenderer(script, Settings_t(), kStressWidth);
+	if (!pRenderer || pRenderer->GetNumFrames() <= 0) {
+		return false;
+	}
+
+	pixels.resize((size_t)pRenderer->GetWidth() * 4 * pRenderer->GetHeight());
+	return pRenderer->Render(pRenderer->GetNumFrames() / 2, pixels.data());
+}
+
+int RunOpenStress(const std::vector<std::wstring>& scripts, const OpenStressOptions_t& options)
+{
+	// the reference renders are made before any other instance exists
+	std::vector<std::vector<BYTE>> references(scripts.size());
+	for (size_t i = 0; i < scripts.size(); i++) {
+		if (!RenderOnce(scripts[i], references[i])) {
+			PrintLine(std::format(L"{}: failed to render with a single instance", scripts[i]));
+			references[i].clear();
+		}
+	}
+
+	const int jobs = (options.jobs > 0) ? options.jobs : (int)std::max(std::thread::hardware_concurrency(), 1u);
+	std::atomic<int> renders = 0;
+	std::atomic<int> failed  = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (int j = 0; j < jobs; j++) {
+		threads.emplace_back([&, j] {
+			std::vector<BYTE> pixels;
+			for (int round = 0; round < options.rounds; round++) {
+				// the jobs start at different scripts, so the instances are opened and closed in different orders
+				for (size_t n = 0; n < scripts.size(); n++) {
+					const size_t i = (n + j) % scripts.size();
+					if (references[i].empty()) {
+						continue;
+					}
+					renders++;
+					if (!RenderOnce(scripts[i], pixels) || pixels != references[i]) {
+						failed++;
+						PrintLine(std::format(L"{}: job {} round {} rendered a different frame", scripts[i], j, round));
+					}
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	PrintLine(std::format(L"{} renders in {:.1f} ms with {} jobs, {} failed", renders.load(), GetElapsedMs(start), jobs, failed.load()));
+
+	return failed;
+}
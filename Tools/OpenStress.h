@@ -0,0 +1,17 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+struct OpenStressOptions_t {
+	int rounds = 10; // times every job opens each script
+	int jobs   = 0;  // threads, 0 - number of CPU cores
+};
+
+// Opens, renders and closes the scripts from several threads at the same time, so that
+// instances are created and destroyed while others are still rendering. Every render is
+// compared with a render made by a single instance. Returns the number of failed renders.
+int RunOpenStress(const std::vector<std::wstring>& scripts, const OpenStressOptions_t& options);
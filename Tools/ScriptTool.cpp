@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <InitGuid.h>
+#include "Helper.h"
+#include "ToolUtils.h"
+#include "AudioExport.h"
+#include "ContactSheet.h"
+#include "HashManifest.h"
+#include "OpenStress.h"
+#include "VideoExport.h"
+
+// the filter code is linked statically, the DirectShow class factory is not used
+CFactoryTemplate g_Templates[] = { {} };
+int g_cTemplates = 0;
+
+static const wchar_t s_Usage[] =
+	L"Usage:\n"
+	L"  ScriptTool thumbs <list.txt> <outdir> [-count N | -frames N,N,...] [-width W] [-columns C] [-jobs J]\n"
+	L"    Renders a contact sheet for every .avs/.vpy file listed in list.txt and writes outdir\\index.json.\n"
+	L"  ScriptTool y4m <script> <output|-> [-start N] [-count N] [-lookahead N]\n"
+	L"    Writes the video of an .avs/.vpy file as YUV4MPEG2 to a file or stdout.\n"
+	L"  ScriptTool raw <script> <output|-> [-start N] [-count N] [-lookahead N]\n"
+	L"    Writes the video frames in the output format of the filter without a header.\n"
+	L"  ScriptTool wav <script> <output|-> [-w64]\n"
+	L"    Writes the audio of an .avs/.vpy file as WAV, or as W64 if it is larger than 4 GB.\n"
+	L"  ScriptTool hash <script> <manifest|-> [-start N] [-count N] [-lookahead N] [-novideo] [-noaudio]\n"
+	L"    Writes the hashes of the video frames and audio chunks as the output pins deliver them.\n"
+	L"  ScriptTool stress <list.txt> [-rounds N] [-jobs J]\n"
+	L"    Opens, renders and closes the listed scripts from several threads at the same time.\n";
+
+static bool ParseInt(const wchar_t* str, int& value)
+{
+	wchar_t* end = nullptr;
+	const long val = wcstol(str, &end, 10);
+	if (end == str || *end) {
+		return false;
+	}
+	value = (int)val;
+	return true;
+}
+
+static int RunThumbs(const int argc, wchar_t* argv[])
+{
+	if (argc < 4) {
+		return -1;
+	}
+
+	std::vector<std::wstring> scripts;
+	if (!ReadListFile(argv[2], scripts)) {
+		PrintLine(std::format(L"failed to read {}", argv[2]));
+		return 1;
+	}
+
+	ContactSheetOptions_t options;
+	options.outDir = argv[3];
+
+	for (int i = 4; i < argc; i++) {
+		const std::wstring_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		int value = 0;
+
+		if (arg == L"-frames" && hasValue) {
+			std::vector<std::wstring> tokens;
+			str_split(argv[++i], tokens, L',');
+			for (const auto& token : tokens) {
+				if (!ParseInt(token.c_str(), value) || value < 0) {
+					return -1;
+				}
+				options.frames.emplace_back(value);
+			}
+		}
+		else if (arg == L"-count" && hasValue && ParseInt(argv[++i], value) && value > 0) {
+			options.count = value;
+		}
+		else if (arg == L"-width" && hasValue && ParseInt(argv[++i], value) && value >= 16 && value <= 4096) {
+			options.width = value;
+		}
+		else if (arg == L"-columns" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.columns = value;
+		}
+		else if (arg == L"-jobs" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.jobs = value;
+		}
+		else {
+			return -1;
+		}
+	}
+
+	return RunContactSheets(scripts, options);
+}
+
+static int RunExport(const int argc, wchar_t* argv[], const bool bRaw)
+{
+	if (argc < 4) {
+		return -1;
+	}
+
+	VideoExportOptions_t options;
+	options.output = argv[3];
+	options.bRaw = bRaw;
+
+	for (int i = 4; i < argc; i++) {
+		const std::wstring_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		int value = 0;
+
+		if (arg == L"-start" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.start = value;
+		}
+		else if (arg == L"-count" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.count = value;
+		}
+		else if (arg == L"-lookahead" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.lookahead = value;
+		}
+		else {
+			return -1;
+		}
+	}
+
+	return RunVideoExport(argv[2], options);
+}
+
+static int RunWav(const int argc, wchar_t* argv[])
+{
+	if (argc < 4) {
+		return -1;
+	}
+
+	AudioExportOptions_t options;
+	options.output = argv[3];
+
+	for (int i = 4; i < argc; i++) {
+		const std::wstring_view arg = argv[i];
+
+		if (arg == L"-w64") {
+			options.bW64 = true;
+		}
+		else {
+			return -1;
+		}
+	}
+
+	return RunAudioExport(argv[2], options);
+}
+
+static int RunHash(const int argc, wchar_t* argv[])
+{
+	if (argc < 4) {
+		return -1;
+	}
+
+	HashOptions_t options;
+	options.output = argv[3];
+
+	for (int i = 4; i < argc; i++) {
+		const std::wstring_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		int value = 0;
+
+		if (arg == L"-start" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.start = value;
+		}
+		else if (arg == L"-count" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.count = value;
+		}
+		else if (arg == L"-lookahead" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.lookahead = value;
+		}
+		else if (arg == L"-novideo") {
+			options.bVideo = false;
+		}
+		else if (arg == L"-noaudio") {
+			options.bAudio = false;
+		}
+		else {
+			return -1;
+		}
+	}
+
+	return RunHashManifest(argv[2], options);
+}
+
+static int RunStress(const int argc, wchar_t* argv[])
+{
+	if (argc < 3) {
+		return -1;
+	}
+
+	std::vector<std::wstring> scripts;
+	if (!ReadListFile(argv[2], scripts)) {
+		PrintLine(std::format(L"failed to read {}", argv[2]));
+		return 1;
+	}
+
+	OpenStressOptions_t options;
+
+	for (int i = 3; i < argc; i++) {
+		const std::wstring_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		int value = 0;
+
+		if (arg == L"-rounds" && hasValue && ParseInt(argv[++i], value) && value > 0) {
+			options.rounds = value;
+		}
+		else if (arg == L"-jobs" && hasValue && ParseInt(argv[++i], value) && value >= 0) {
+			options.jobs = value;
+		}
+		else {
+			return -1;
+		}
+	}
+
+	return RunOpenStress(scripts, options);
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	PrintLine(GetNameAndVersion());
+
+	int ret = -1;
+	if (argc >= 2) {
+		const std::wstring_view command = argv[1];
+		if (command == L"thumbs") {
+			ret = RunThumbs(argc, argv);
+		}
+		else if (command == L"y4m" || command == L"raw") {
+			ret = RunExport(argc, argv, command == L"raw");
+		}
+		else if (command == L"wav") {
+			ret = RunWav(argc, argv);
+		}
+		else if (command == L"hash") {
+			ret = RunHash(argc, argv);
+		}
+		else if (command == L"stress") {
+			ret = RunStress(argc, argv);
+		}
+	}
+
+	if (ret < 0) {
+		fwprintf(stderr, L"%s", s_Usage);
+		return 2;
+	}
+
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include <fstream>
+#include <filesystem>
+#include "AviSynthStream.h"
+#include "VapourSynthStream.h"
+
+#include "ToolUtils.h"
+
+std::unique_ptr<CThumbnailRenderer> CreateThumbnailRenderer(const std::wstring& filepath, const Settings_t& settings, const UINT width)
+{
+	std::wstring ext = std::filesystem::path(filepath).extension().wstring();
+	str_tolower(ext);
+
+	HRESULT hr = E_FAIL;
+	std::unique_ptr<CThumbnailRenderer> pRenderer;
+	if (ext == L".avs") {
+		pRenderer.reset(new(std::nothrow) CAviSynthThumbnailRenderer(filepath.c_str(), settings, width, &hr));
+	}
+	else if (ext == L".vpy") {
+		pRenderer.reset(new(std::nothrow) CVapourSynthThumbnailRenderer(filepath.c_str(), settings, width, &hr));
+	}
+	if (FAILED(hr)) {
+		pRenderer.reset();
+	}
+
+	return pRenderer;
+}
+
+std::unique_ptr<CScriptReader> CreateScriptReader(const std::wstring& filepath, const Settings_t& settings, const int lookahead)
+{
+	std::wstring ext = std::filesystem::path(filepath).extension().wstring();
+	str_tolower(ext);
+
+	HRESULT hr = E_FAIL;
+	std::unique_ptr<CScriptReader> pReader;
+	if (ext == L".avs") {
+		pReader.reset(new(std::nothrow) CAviSynthReader(filepath.c_str(), settings, lookahead, &hr));
+	}
+	else if (ext == L".vpy") {
+		pReader.reset(new(std::nothrow) CVapourSynthReader(filepath.c_str(), settings, lookahead, &hr));
+	}
+	if (FAILED(hr)) {
+		pReader.reset();
+	}
+
+	return pReader;
+}
+
+std::unique_ptr<CScriptAudioReader> CreateScriptAudioReader(const std::wstring& filepath, const Settings_t& settings)
+{
+	std::wstring ext = std::filesystem::path(filepath).extension().wstring();
+	str_tolower(ext);
+
+	HRESULT hr = E_FAIL;
+	std::unique_ptr<CScriptAudioReader> pReader;
+	if (ext == L".avs") {
+		pReader.reset(new(std::nothrow) CAviSynthAudioReader(filepath.c_str(), settings, &hr));
+	}
+	else if (ext == L".vpy") {
+		pReader.reset(new(std::nothrow) CVapourSynthAudioReader(filepath.c_str(), settings, &hr));
+	}
+	if (FAILED(hr)) {
+		pReader.reset();
+	}
+
+	return pReader;
+}
+
+bool ReadListFile(const std::wstring& filepath, std::vector<std::wstring>& lines)
+{
+	std::ifstream file(std::filesystem::path(filepath));
+	if (!file) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (lines.empty() && line.starts_with("\xEF\xBB\xBF")) {
+			line.erase(0, 3); // UTF-8 BOM
+		}
+		std::wstring wline = str_trim(ConvertUtf8ToWide(line));
+		if (wline.size() && wline[0] != L'#') {
+			lines.emplace_back(std::move(wline));
+		}
+	}
+
+	return true;
+}
+
+bool WriteBitmapFile(const std::wstring& filepath, const BYTE* data, const UINT width, const UINT height)
+{
+	const DWORD imageSize = width * height * 4;
+
+	BITMAPFILEHEADER bfh = {};
+	bfh.bfType    = 0x4D42; // "BM"
+	bfh.bfOffBits = sizeof(BITMAPFILEHEADER) + sizeof(BITMAPINFOHEADER);
+	bfh.bfSize    = bfh.bfOffBits + imageSize;
+
+	BITMAPINFOHEADER bih = {};
+	bih.biSize        = sizeof(BITMAPINFOHEADER);
+	bih.biWidth       = width;
+	bih.biHeight      = -(LONG)height; // top-down
+	bih.biPlanes      = 1;
+	bih.biBitCount    = 32;
+	bih.biCompression = BI_RGB;
+	bih.biSizeImage   = imageSize;
+
+	std::ofstream file(std::filesystem::path(filepath), std::ios::binary);
+	file.write((const char*)&bfh, sizeof(bfh));
+	file.write((const char*)&bih, sizeof(bih));
+	file.write((const char*)data, imageSize);
+
+	return file.good();
+}
+
+std::string JsonString(const std::wstring_view str)
+{
+	const std::string utf8 = ConvertWideToUtf8(str);
+
+	std::string json;
+	json.reserve(utf8.size() + 2);
+	json += '"';
+	for (const char ch : utf8) {
+		switch (ch) {
+		case '"':  json += "\\\""; break;
+		case '\\': json += "\\\\"; break;
+		case '\n': json += "\\n";  break;
+		case '\r': json += "\\r";  break;
+		case '\t': json += "\\t";  break;
+		default:
+			if ((unsigned char)ch < 0x20) {
+				json += std::format("\\u{:04x}", (unsigned)ch);
+			} else {
+				json += ch;
+			}
+		}
+	}
+	json += '"';
+
+	return json;
+}
+
+void PrintLine(const std::wstring_view line)
+{
+	static std::mutex s_PrintMutex;
+	std::lock_guard<std::mutex> lock(s_PrintMutex);
+
+	fwprintf(stderr, L"%.*s\n", (int)line.size(), line.data());
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include "Helper.h"
+
+class CThumbnailRenderer;
+class CScriptReader;
+class CScriptAudioReader;
+
+// Opens a secondary script instance by the file extension (.avs or .vpy), or returns nullptr.
+std::unique_ptr<CThumbnailRenderer> CreateThumbnailRenderer(const std::wstring& filepath, const Settings_t& settings, const UINT width);
+std::unique_ptr<CScriptReader> CreateScriptReader(const std::wstring& filepath, const Settings_t& settings, const int lookahead);
+std::unique_ptr<CScriptAudioReader> CreateScriptAudioReader(const std::wstring& filepath, const Settings_t& settings);
+
+// Reads the non-empty lines of a UTF-8 text file, lines starting with '#' are skipped.
+bool ReadListFile(const std::wstring& filepath, std::vector<std::wstring>& lines);
+
+// Writes top-down 32-bit BGR pixels as a BMP file.
+bool WriteBitmapFile(const std::wstring& filepath, const BYTE* data, const UINT width, const UINT height);
+
+// Returns the string as a quoted and escaped UTF-8 JSON string.
+std::string JsonString(const std::wstring_view str);
+
+// Milliseconds since the time point.
+inline double GetElapsedMs(const std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Writes a line to stderr, the lines of several threads are not mixed.
+void PrintLine(const std::wstring_view line);
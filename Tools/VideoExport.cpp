@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "stdafx.h"
+#include "ScriptReader.h"
+#include "AsyncWriter.h"
+#include "ToolUtils.h"
+
+#include "VideoExport.h"
+
+static std::string GetY4MColorspace(const ScriptVideoInfo_t& vi, const MediaTypeProps_t& props)
+{
+	if (vi.bGray) {
+		return (vi.bitDepth == 8) ? "mono" : std::format("mono{}", vi.bitDepth);
+	}
+	if (vi.planes < 3) {
+		// packed YUV (YUY2) would have to be unpacked first
+		return {};
+	}
+
+	const char* subsampling = nullptr;
+	if (vi.subsamplingW == 1 && vi.subsamplingH == 1) {
+		if (vi.bitDepth == 8) {
+			switch (props.Get<FP_ChromaLocation>()) {
+			case 1:  return "420jpeg";  // center
+			case 2:  return "420paldv"; // top-left
+			default: return "420mpeg2"; // left
+			}
+		}
+		subsampling = "420";
+	}
+	else if (vi.subsamplingW == 1 && vi.subsamplingH == 0) {
+		subsampling = "422";
+	}
+	else if (vi.subsamplingW == 0 && vi.subsamplingH == 0) {
+		subsampling = "444";
+	}
+	else if (vi.subsamplingW == 2 && vi.subsamplingH == 0) {
+		subsampling = "411";
+	}
+	else {
+		return {};
+	}
+
+	return (vi.bitDepth == 8) ? subsampling : std::format("{}p{}", subsampling, vi.bitDepth);
+}
+
+static std::string GetY4MHeader(const ScriptVideoInfo_t& vi, const ScriptFrame_t& frame, const std::string& colorspace)
+{
+	char interlacing = 'p';
+	if (frame.fieldBased == 1) {
+		interlacing = 'b';
+	}
+	else if (frame.fieldBased == 2) {
+		interlacing = 't';
+	}
+
+	// the properties of the first frame are used for the whole stream
+	std::string header = std::format("YUV4MPEG2 W{} H{} F{}:{} I{} A{}:{} C{}",
+		vi.width, vi.height, vi.fpsNum, vi.fpsDen, interlacing,
+		frame.props.GetSarNum(), frame.props.GetSarDen(), colorspace);
+
+	const int64_t colorRange = frame.props.Get<FP_ColorRange>();
+	if (colorRange == 0) {
+		header.append(" XCOLORRANGE=FULL");
+	}
+	else if (colorRange == 1) {
+		header.append(" XCOLORRANGE=LIMITED");
+	}
+	header.push_back('\n');
+
+	return header;
+}
+
+static void WriteY4MFrame(CAsyncWriter& writer, const ScriptVideoInfo_t& vi, const ScriptFrame_t& frame)
+{
+	static const char frameHeader[] = "FRAME\n";
+	writer.Write(frameHeader, std::size(frameHeader) - 1);
+
+	const UINT sampleSize = (vi.bitDepth + 7) / 8;
+	for (int i = 0; i < vi.planes && i < 3; i++) {
+		const UINT rowSize = (i ? (vi.width >> vi.subsamplingW) : vi.width) * sampleSize;
+		const UINT rows    = i ? (vi.height >> vi.subsamplingH) : vi.height;
+
+		const BYTE* src = frame.data[i];
+		for (UINT y = 0; y < rows; y++) {
+			writer.Write(src, rowSize);
+			src += frame.pitch[i];
+		}
+	}
+}
+
+int RunVideoExport(const std::wstring& script, const VideoExportOptions_t& options)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto pReader = CreateScriptReader(script, Settings_t(), options.lookahead);
+	if (!pReader) {
+		PrintLine(std::format(L"failed to open {}", script));
+		return 1;
+	}
+	const double evalMs = GetElapsedMs(start);
+
+	const auto& vi = pReader->GetVideoInfo();
+
+	std::string colorspace;
+	if (!options.bRaw) {
+		if ((vi.bYUV || vi.bGray) && !vi.bFloat) {
+			colorspace = GetY4MColorspace(vi, {});
+		}
+		if (colorspace.empty()) {
+			PrintLine(std::format(L"{} can not be written as YUV4MPEG2, use the raw mode", vi.format.str));
+			return 1;
+		}
+		if (vi.fpsNum <= 0 || vi.fpsDen <= 0) {
+			// a VapourSynth clip with a variable frame rate has no rate for the header
+			PrintLine(L"a variable frame rate can not be written as YUV4MPEG2, use the raw mode");
+			return 1;
+		}
+	}
+
+	const int first = std::min(options.start, vi.numFrames);
+	const int end   = (options.count > 0) ? std::min(first + options.count, vi.numFrames) : vi.numFrames;
+
+	CAsyncWriter writer;
+	if (!writer.Open(options.output)) {
+		PrintLine(std::format(L"failed to open {}", options.output));
+		return 1;
+	}
+
+	// the raw frames are produced by the same transfer function as the output pins use
+	const UINT rawPitch = GetOutputPitch(vi.format, vi.width);
+	std::vector<BYTE> rawFrame;
+	if (options.bRaw) {
+		rawFrame.resize((size_t)rawPitch * vi.height * vi.format.buffCoeff / 2);
+	}
+
+	start = std::chrono::steady_clock::now();
+	int frames = 0;
+	bool ok = true;
+
+	for (int n = first; n < end && !writer.IsFailed(); n++) {
+		ScriptFrame_t frame;
+		if (!pReader->ReadFrame(n, frame)) {
+			PrintLine(std::format(L"failed to render frame {}", n));
+			ok = false;
+			break;
+		}
+
+		if (options.bRaw) {
+			const UINT size = vi.format.copyFrame(rawFrame.data(), rawPitch, frame.data, frame.pitch, vi.width, vi.height);
+			writer.Write(rawFrame.data(), size);
+		} else {
+			if (n == first) {
+				const std::string header = GetY4MHeader(vi, frame, GetY4MColorspace(vi, frame.props));
+				writer.Write(header.data(), header.size());
+			}
+			WriteY4MFrame(writer, vi, frame);
+		}
+		frames++;
+	}
+
+	if (!writer.Close()) {
+		PrintLine(std::format(L"failed to write {}", options.output));
+		ok = false;
+	}
+
+	const double renderMs = GetElapsedMs(start);
+	PrintLine(std::format(L"{}: {} {}x{} {}, {} frames, {:.1f} MB, eval {:.1f} ms, {:.1f} ms, {:.2f} fps",
+		script, options.bRaw ? L"raw" : L"y4m", vi.width, vi.height, vi.format.str,
+		frames, writer.GetWritten() / (1024.0 * 1024.0), evalMs, renderMs, renderMs > 0 ? frames * 1000.0 / renderMs : 0.0));
+
+	return ok ? 0 : 1;
+}
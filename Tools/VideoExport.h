@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2026 v0lt
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#pragma once
+
+struct VideoExportOptions_t {
+	std::wstring output;   // file path or "-" for stdout
+	bool bRaw      = false; // raw frames in the native output format of the filter instead of YUV4MPEG2
+	int  start     = 0;
+	int  count     = 0;     // 0 - up to the end
+	int  lookahead = 0;     // frames rendered ahead, 0 - default
+};
+
+// Writes the video frames of the script as YUV4MPEG2 or raw frames. Returns 0 on success.
+int RunVideoExport(const std::wstring& script, const VideoExportOptions_t& options);